@@ -0,0 +1,682 @@
+/**
+* @file archive.c
+* @brief Import et export d'archives tar (format ustar) entre l'hôte et le volume
+* @author jzy
+* @date 2025-4-18
+*/
+#include "filesystem.h"
+
+extern SuperBlock fs;
+
+#define TAR_BLOCK 512                    // Taille d'un bloc tar / tar 块大小
+#define TAR_IO_BUFFER (1 << 20)          // Tampon d'E/S de l'archive / 归档文件的 I/O 缓冲区
+#define MAX_FILE_SIZE ((size_t)MAX_FILE_PAGES * PAGE_SIZE)
+
+// En-tête ustar / ustar 头部
+typedef struct {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char padding[12];
+} TarHeader;
+
+/**
+ * @brief Lire un nombre octal d'un champ tar
+ * @param field Le champ
+ * @param len La longueur du champ
+ * @return La valeur lue
+ */
+static size_t tar_octal(const char *field, size_t len) {
+    size_t value = 0;
+    for (size_t i = 0; i < len && field[i]; i++) {
+        if (field[i] >= '0' && field[i] <= '7') value = value * 8 + (field[i] - '0');
+    }
+    return value;
+}
+
+/**
+ * @brief Calculer la somme de contrôle d'un en-tête tar (champ chksum compté comme des espaces)
+ * @param header L'en-tête
+ * @return La somme de contrôle
+ */
+static unsigned int tar_checksum(const TarHeader *header) {
+    const unsigned char *bytes = (const unsigned char *)header;
+    unsigned int sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK; i++) {
+        sum += (i >= 148 && i < 156) ? ' ' : bytes[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Sauter les données d'une entrée, complétées au bloc suivant
+ * @param tar L'archive
+ * @param size La taille des données
+ * @return 1 en cas de succès, 0 à la fin de l'archive
+ */
+static int tar_skip(FILE *tar, size_t size) {
+    size_t padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+    return fseek(tar, padded, SEEK_CUR) == 0;
+}
+
+/**
+ * @brief Lire les données d'une entrée, puis sauter le bourrage
+ * @param tar L'archive
+ * @param buffer Le tampon de destination
+ * @param size La taille des données
+ * @return 1 en cas de succès, 0 si l'archive est tronquée
+ */
+static int tar_read_data(FILE *tar, char *buffer, size_t size) {
+    if (size > 0 && fread(buffer, size, 1, tar) != 1) return 0;
+    return fseek(tar, (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK, SEEK_CUR) == 0;
+}
+
+// Attributs d'un en-tête étendu pax pour l'entrée suivante / pax 扩展头为下一个条目提供的属性
+typedef struct {
+    char path[MAX_PATH_LENGTH];      // Chemin, vide s'il est absent / 路径，缺省为空
+    char linkpath[MAX_PATH_LENGTH];  // Cible d'un lien, vide si absente / 链接目标，缺省为空
+    long long size;                  // Taille des données, -1 si absente / 数据大小，缺省为 -1
+    int too_long;                    // Un chemin dépasse MAX_PATH_LENGTH / 路径超过 MAX_PATH_LENGTH
+} PaxAttributes;
+
+/**
+ * @brief Lire les enregistrements "longueur clé=valeur\n" d'un en-tête étendu pax
+ * @details Seuls path, linkpath et size sont utilisés ; les autres clés (dates, propriétaires,
+ *          jeu de caractères) sont ignorées
+ * @param records Les données de l'en-tête
+ * @param len La longueur des données
+ * @param pax Reçoit les attributs
+ * @return Aucun
+ */
+static void pax_parse(const char *records, size_t len, PaxAttributes *pax) {
+    size_t pos = 0;
+    while (pos < len) {
+        // La longueur compte tout l'enregistrement, fin de ligne comprise / 长度包括整条记录和换行符
+        size_t record_len = 0, i = pos;
+        while (i < len && records[i] >= '0' && records[i] <= '9') record_len = record_len * 10 + (records[i++] - '0');
+        if (i >= len || records[i] != ' ' || record_len == 0 || record_len > len - pos) return;
+        const char *key = records + i + 1;
+        const char *end = records + pos + record_len - 1;  // Sur le '\n' final / 指向末尾的 '\n'
+        const char *equals = memchr(key, '=', end - key);
+        pos += record_len;
+        if (equals == NULL || *end != '\n') continue;
+
+        const char *value = equals + 1;
+        size_t value_len = end - value;
+        char *target = NULL;
+        if ((size_t)(equals - key) == 4 && memcmp(key, "path", 4) == 0) target = pax->path;
+        else if ((size_t)(equals - key) == 8 && memcmp(key, "linkpath", 8) == 0) target = pax->linkpath;
+        else if ((size_t)(equals - key) == 4 && memcmp(key, "size", 4) == 0) {
+            pax->size = 0;
+            for (size_t k = 0; k < value_len && value[k] >= '0' && value[k] <= '9'; k++) {
+                pax->size = pax->size * 10 + (value[k] - '0');
+            }
+        }
+        if (target == NULL) continue;
+        if (value_len >= MAX_PATH_LENGTH) {
+            pax->too_long = 1;
+            continue;
+        }
+        memcpy(target, value, value_len);
+        target[value_len] = '\0';
+    }
+}
+
+/**
+ * @brief Créer un répertoire dans un répertoire parent, sans charger ni sauvegarder le superbloc
+ * @param parent_inode L'inode du répertoire parent
+ * @param name Le nom du répertoire
+ * @return L'inode du nouveau répertoire, ou -1 s'il n'y a plus d'inode libre
+ */
+static int make_directory(int parent_inode, const char *name) {
+    int new_inode = allocate_inode();
+    if (new_inode == -1) return -1;
+
+    Inode *dir_inode = &fs.inodes[new_inode];
+    dir_inode->file_type = FILE_TYPE_DIR;
+    dir_inode->permissions = PERM_READ | PERM_WRITE | PERM_EXECUTE;
+    dir_inode->size = 2 * sizeof(DirectoryEntry);
+    dir_inode->ctime = dir_inode->mtime = dir_inode->atime = time(NULL);
+
+    add_directory_entry(parent_inode, name, new_inode);
+    add_directory_entry(new_inode, ".", new_inode);
+    add_directory_entry(new_inode, "..", parent_inode);
+    return new_inode;
+}
+
+/**
+ * @brief Résoudre le chemin d'une entrée de l'archive sous le répertoire d'import
+ * @details Avec create, crée les répertoires intermédiaires manquants ; l'appelant ne le demande
+ *          que pour une entrée qui sera extraite. Les composants '..' sont refusés.
+ * @param base_inode Le répertoire d'import
+ * @param base_path Le chemin absolu du répertoire d'import
+ * @param name Le chemin de l'entrée dans l'archive
+ * @param create 1 pour créer les répertoires intermédiaires manquants, 0 pour échouer
+ * @param leaf Reçoit le dernier composant (vide pour le répertoire d'import lui-même)
+ * @param parent_path Reçoit le chemin absolu du répertoire parent
+ * @return L'inode du répertoire parent, ou -1 en cas d'erreur
+ */
+static int resolve_entry_parent(int base_inode, const char *base_path, const char *name, int create,
+                                char *leaf, char *parent_path) {
+    char components[MAX_PATH_LENGTH][MAX_FILENAME_LENGTH];
+    int count = split_path(name, components);
+    int dir = base_inode;
+    strcpy(parent_path, base_path);
+    leaf[0] = '\0';
+
+    // Ignorer les composants vides et '.' / 忽略空分量和 '.'
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (components[i][0] == '\0' || strcmp(components[i], ".") == 0) continue;
+        if (strcmp(components[i], "..") == 0) return -1;
+        // Un composant déjà à sa place n'est pas recopié sur lui-même / 已在原位的分量不复制到自身
+        if (kept != i) strcpy(components[kept], components[i]);
+        kept++;
+    }
+    if (kept == 0) return dir;
+
+    for (int i = 0; i < kept - 1; i++) {
+        int child = find_in_directory(dir, components[i]);
+        if (child == -1) {
+            if (!create) return -1;
+            child = make_directory(dir, components[i]);
+            if (child == -1) return -1;
+        } else if (fs.inodes[child].file_type != FILE_TYPE_DIR) {
+            return -1;
+        }
+        dir = child;
+        if (strlen(parent_path) + strlen(components[i]) + 2 >= MAX_PATH_LENGTH) return -1;
+        if (strcmp(parent_path, "/") != 0) strcat(parent_path, "/");
+        strcat(parent_path, components[i]);
+    }
+    strcpy(leaf, components[kept - 1]);
+    return dir;
+}
+
+/**
+ * @brief Commande import : extraire une archive tar de l'hôte dans le volume
+ * @details L'archive est lue avec un grand tampon et toutes les métadonnées sont enregistrées en une
+ *          seule sauvegarde à la fin. Les fichiers réguliers, répertoires, liens symboliques et liens
+ *          durs sont pris en charge; les autres types sont ignorés sans rien créer. Les noms longs GNU
+ *          et les en-têtes étendus pax (path, linkpath, size) sont appliqués à l'entrée suivante ;
+ *          les en-têtes pax globaux ne portent que des dates et des jeux de caractères et sont ignorés.
+ * @param host_tar Le chemin de l'archive sur l'hôte
+ * @param dest_path Le répertoire de destination, ou NULL pour le répertoire courant
+ * @return Aucun
+ */
+void import_archive(const char *host_tar, const char *dest_path) {
+    load_superblock();
+
+    char base_path[MAX_PATH_LENGTH];
+    int base_inode = get_inode_from_path(dest_path ? dest_path : current_path);
+    if (base_inode == -1 || fs.inodes[base_inode].file_type != FILE_TYPE_DIR) {
+        command_error("Destination directory not found\n");
+        return;
+    }
+    if (!check_directory_permission(base_inode, PERM_READ | PERM_WRITE)) {
+        command_error("Permission denied\n");
+        return;
+    }
+    if (dest_path == NULL) {
+        strcpy(base_path, current_path);
+    } else if (dest_path[0] == '/') {
+        strncpy(base_path, dest_path, MAX_PATH_LENGTH - 1);
+        base_path[MAX_PATH_LENGTH - 1] = '\0';
+    } else {
+        snprintf(base_path, MAX_PATH_LENGTH, "%s%s%s", current_path, strcmp(current_path, "/") ? "/" : "", dest_path);
+    }
+
+    FILE *tar = fopen(host_tar, "rb");
+    if (!tar) {
+        perror("Failed to open archive");
+        return;
+    }
+    char *io_buffer = malloc(TAR_IO_BUFFER);
+    if (io_buffer) setvbuf(tar, io_buffer, _IOFBF, TAR_IO_BUFFER);
+
+    static char data[MAX_FILE_SIZE];
+    char long_name[MAX_PATH_LENGTH] = "";
+    PaxAttributes pax = { "", "", -1, 0 };
+    int files = 0, directories = 0, links = 0, skipped = 0;
+    TarHeader header;
+
+    while (fread(&header, sizeof(header), 1, tar) == 1) {
+        if (header.name[0] == '\0') break;  // Bloc de fin d'archive / 归档结束块
+        if (tar_octal(header.chksum, sizeof(header.chksum)) != tar_checksum(&header)) {
+            command_error("Archive header checksum mismatch, stopping\n");
+            break;
+        }
+        size_t size = tar_octal(header.size, sizeof(header.size));
+
+        // En-têtes étendus pax : x pour l'entrée suivante, g pour toute l'archive / pax 扩展头：x 作用于下一个条目，g 作用于整个归档
+        if (header.typeflag == 'x' || header.typeflag == 'g') {
+            if (size > MAX_FILE_SIZE) {
+                command_error("Skipping oversized extended header\n");
+                if (!tar_skip(tar, size)) break;
+                continue;
+            }
+            if (!tar_read_data(tar, data, size)) {
+                command_error("Archive is truncated\n");
+                break;
+            }
+            if (header.typeflag == 'x') pax_parse(data, size, &pax);
+            continue;
+        }
+
+        // Nom long GNU : le nom de l'entrée suivante est dans les données / GNU 长文件名：下一个条目的名字在数据中
+        if (header.typeflag == 'L') {
+            size_t keep = size < MAX_PATH_LENGTH ? size : MAX_PATH_LENGTH - 1;
+            if (!tar_read_data(tar, long_name, keep)) break;
+            long_name[keep] = '\0';
+            if (fseek(tar, (long)((size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK) - (long)((keep + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK), SEEK_CUR) != 0) break;
+            continue;
+        }
+
+        char name[MAX_PATH_LENGTH];
+        char target[MAX_PATH_LENGTH];
+        int too_long = pax.too_long;
+        if (pax.size >= 0) size = (size_t)pax.size;
+        if (pax.linkpath[0]) strcpy(target, pax.linkpath);
+        else snprintf(target, sizeof(target), "%.100s", header.linkname);
+        if (pax.path[0]) {
+            strcpy(name, pax.path);
+            long_name[0] = '\0';
+        } else if (long_name[0]) {
+            strcpy(name, long_name);
+            long_name[0] = '\0';
+        } else if (header.prefix[0] && memcmp(header.magic, "ustar", 5) == 0) {
+            snprintf(name, sizeof(name), "%.155s/%.100s", header.prefix, header.name);
+        } else {
+            snprintf(name, sizeof(name), "%.100s", header.name);
+        }
+
+        pax.path[0] = pax.linkpath[0] = '\0';
+        pax.size = -1;
+        pax.too_long = 0;
+
+        // Écarter l'entrée avant de résoudre son chemin, qui crée les répertoires manquants / 在解析路径（会创建缺失目录）之前先排除条目
+        int regular = header.typeflag == '0' || header.typeflag == '\0' || header.typeflag == '7';
+        const char *reason = NULL;
+        if (too_long) reason = "name too long";
+        else if (!regular && header.typeflag != '5' && header.typeflag != '1' && header.typeflag != '2') reason = "unsupported entry type";
+        else if (regular && size > MAX_FILE_SIZE) reason = "file too large";
+        if (reason != NULL) {
+            printf("Skipping %s: %s\n", name, reason);
+            skipped++;
+            if (!tar_skip(tar, size)) break;
+            continue;
+        }
+
+        char leaf[MAX_FILENAME_LENGTH], parent_path[MAX_PATH_LENGTH];
+        int parent = resolve_entry_parent(base_inode, base_path, name, 1, leaf, parent_path);
+        int existing = parent != -1 && leaf[0] ? find_in_directory(parent, leaf) : -1;
+        unsigned char perm = (tar_octal(header.mode, sizeof(header.mode)) >> 6) & 7;
+        time_t mtime = (time_t)tar_octal(header.mtime, sizeof(header.mtime));
+
+        if (parent == -1) {
+            printf("Skipping %s: invalid path\n", name);
+            skipped++;
+            if (!tar_skip(tar, size)) break;
+            continue;
+        }
+
+        if (header.typeflag == '5') {
+            // Répertoire / 目录
+            if (leaf[0] && existing == -1) {
+                existing = make_directory(parent, leaf);
+                if (existing == -1) {
+                    command_error("No free inodes, stopping\n");
+                    break;
+                }
+                directories++;
+            }
+            if (existing != -1 && fs.inodes[existing].file_type == FILE_TYPE_DIR) {
+                fs.inodes[existing].mtime = mtime;
+            }
+            if (!tar_skip(tar, size)) break;
+        } else if (regular) {
+            // Fichier régulier : remplacer un fichier existant du même nom / 普通文件：替换同名的已有文件
+            if (!leaf[0] || (existing != -1 && fs.inodes[existing].file_type != FILE_TYPE_REGULAR)) {
+                printf("Skipping %s: name in use\n", name);
+                skipped++;
+                if (!tar_skip(tar, size)) break;
+                continue;
+            }
+            if (!tar_read_data(tar, data, size)) {
+                command_error("Archive is truncated\n");
+                break;
+            }
+            int inode = existing;
+            if (inode == -1) {
+                inode = allocate_inode();
+                if (inode == -1) {
+                    command_error("No free inodes, stopping\n");
+                    break;
+                }
+                fs.inodes[inode].file_type = FILE_TYPE_REGULAR;
+                add_directory_entry(parent, leaf, inode);
+            }
+            if (set_file_contents(&fs.inodes[inode], data, size) != 0) {
+                command_error("No free pages, stopping\n");
+                break;
+            }
+            page_cache_invalidate(inode);
+            fs.inodes[inode].permissions = perm ? perm : PERM_READ | PERM_WRITE;
+            fs.inodes[inode].mtime = mtime;
+            files++;
+        } else if (!leaf[0] || existing != -1) {
+            // Lien sur un nom déjà utilisé / 链接名已被使用
+            printf("Skipping %s: name in use\n", name);
+            skipped++;
+            if (!tar_skip(tar, size)) break;
+        } else {
+            if (!tar_skip(tar, size)) break;
+
+            if (header.typeflag == '1') {
+                // Lien dur vers une entrée déjà extraite / 指向已解压条目的硬链接
+                char target_leaf[MAX_FILENAME_LENGTH], target_parent_path[MAX_PATH_LENGTH];
+                int target_parent = resolve_entry_parent(base_inode, base_path, target, 0, target_leaf, target_parent_path);
+                int target_inode = target_parent == -1 ? -1 : find_in_directory(target_parent, target_leaf);
+                if (target_inode == -1 || fs.inodes[target_inode].file_type != FILE_TYPE_REGULAR) {
+                    printf("Skipping %s: link target not found\n", name);
+                    skipped++;
+                    continue;
+                }
+                add_directory_entry(parent, leaf, target_inode);
+                fs.inodes[target_inode].link_count++;
+            } else {
+                // Lien symbolique : chemin stocké en absolu, comme ln -s / 符号链接：与 ln -s 一样存储绝对路径
+                char symlink_path[MAX_PATH_LENGTH];
+                int written = target[0] == '/' ?
+                    snprintf(symlink_path, sizeof(symlink_path), "%s", target) :
+                    snprintf(symlink_path, sizeof(symlink_path), "%s%s%s", parent_path,
+                             strcmp(parent_path, "/") ? "/" : "", target);
+                if (written < 0 || (size_t)written >= sizeof(symlink_path)) {
+                    printf("Skipping %s: link target too long\n", name);
+                    skipped++;
+                    continue;
+                }
+                int inode = allocate_inode();
+                if (inode == -1) {
+                    command_error("No free inodes, stopping\n");
+                    break;
+                }
+                Inode *symlink = &fs.inodes[inode];
+                symlink->file_type = FILE_TYPE_SYMLINK;
+                symlink->permissions = PERM_READ | PERM_WRITE;
+                symlink->link_count = 1;
+                symlink->mtime = symlink->atime = mtime;
+                strcpy(symlink->data.symlink_path, symlink_path);
+                symlink->size = strlen(symlink->data.symlink_path);
+                add_directory_entry(parent, leaf, inode);
+            }
+            links++;
+        }
+    }
+    fclose(tar);
+    free(io_buffer);
+
+    // Une seule sauvegarde pour toute l'archive / 整个归档只保存一次
+    save_superblock();
+    printf("Imported %d files, %d directories, %d links (%d skipped)\n", files, directories, links, skipped);
+}
+
+// Contexte d'un export en cours / 导出过程的上下文
+typedef struct {
+    FILE *tar;
+    int ok;
+    int files, directories, links;
+    char first_path[MAX_FILES][MAX_PATH_LENGTH / 4]; // Premier nom exporté de chaque fichier à liens multiples / 每个多链接文件第一次导出的名字
+    char base[MAX_PATH_LENGTH];  // Répertoire du volume qui correspond à la racine de l'archive / 与归档根目录对应的卷内目录
+    char data[MAX_FILE_SIZE];
+} TarExport;
+
+/**
+ * @brief Simplifier un chemin sans consulter le volume : '.' et les composants vides sont retirés, '..' remonte
+ * @param path Le chemin
+ * @param components Reçoit les composants restants
+ * @return Le nombre de composants
+ */
+static int normalize_components(const char *path, char components[][MAX_FILENAME_LENGTH]) {
+    int count = split_path(path, components);
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(components[i], ".") == 0) continue;
+        if (strcmp(components[i], "..") == 0) {
+            if (kept > 0) kept--;
+            continue;
+        }
+        if (kept != i) strcpy(components[kept], components[i]);
+        kept++;
+    }
+    return kept;
+}
+
+/**
+ * @brief Exprimer la cible d'un lien symbolique relativement au répertoire du lien
+ * @details Les liens du volume stockent un chemin absolu, qui ne désigne plus rien une fois l'archive
+ *          extraite sur l'hôte ; une cible relative reste valable partout où l'arborescence est extraite
+ * @param link_path Le chemin absolu du lien dans le volume
+ * @param target La cible stockée dans le lien
+ * @param relative Reçoit la cible relative (MAX_PATH_LENGTH octets)
+ * @return 0, ou -1 si la cible relative dépasse MAX_PATH_LENGTH
+ */
+static int relative_link_target(const char *link_path, const char *target, char *relative) {
+    static char link_parts[MAX_PATH_LENGTH][MAX_FILENAME_LENGTH];
+    static char target_parts[MAX_PATH_LENGTH][MAX_FILENAME_LENGTH];
+    if (target[0] != '/') {
+        int written = snprintf(relative, MAX_PATH_LENGTH, "%s", target);
+        return written < 0 || written >= MAX_PATH_LENGTH ? -1 : 0;
+    }
+
+    // Le dernier composant du lien est le lien lui-même / 链接路径的最后一个分量是链接本身
+    int link_count = normalize_components(link_path, link_parts) - 1;
+    int target_count = normalize_components(target, target_parts);
+    int common = 0;
+    while (common < link_count && common < target_count && strcmp(link_parts[common], target_parts[common]) == 0) {
+        common++;
+    }
+
+    size_t len = 0;
+    relative[0] = '\0';
+    for (int i = common; i < link_count + target_count - common; i++) {
+        const char *part = i < link_count ? ".." : target_parts[i - link_count + common];
+        int written = snprintf(relative + len, MAX_PATH_LENGTH - len, "%s%s", len ? "/" : "", part);
+        if (written < 0 || (size_t)written >= MAX_PATH_LENGTH - len) return -1;
+        len += written;
+    }
+    if (len == 0) strcpy(relative, ".");
+    return 0;
+}
+
+/**
+ * @brief Écrire un en-tête tar, précédé d'un enregistrement de nom long GNU si nécessaire
+ * @param ctx Le contexte d'export
+ * @param name Le chemin dans l'archive
+ * @param inode L'inode exporté
+ * @param typeflag Le type d'entrée
+ * @param size La taille des données qui suivent
+ * @param linkname La cible d'un lien, ou NULL
+ * @return Aucun
+ */
+static void tar_write_header(TarExport *ctx, const char *name, const Inode *inode, char typeflag,
+                             size_t size, const char *linkname) {
+    TarHeader header;
+    if (strlen(name) >= sizeof(header.name)) {
+        // Nom trop long pour ustar : enregistrement GNU ././@LongLink / 名字超出 ustar 长度：使用 GNU ././@LongLink 记录
+        // Au plus MAX_PATH_LENGTH octets : un unsigned tient dans les 11 chiffres octaux du champ / 最多 MAX_PATH_LENGTH 字节：unsigned 可放入字段的 11 位八进制数
+        unsigned int len = (unsigned int)strlen(name) + 1;
+        memset(&header, 0, sizeof(header));
+        strcpy(header.name, "././@LongLink");
+        strcpy(header.mode, "0000644");
+        snprintf(header.size, sizeof(header.size), "%011o", len);
+        strcpy(header.mtime, "00000000000");
+        header.typeflag = 'L';
+        memcpy(header.magic, "ustar ", 6);
+        memcpy(header.version, " ", 2);
+        snprintf(header.chksum, sizeof(header.chksum), "%06o", tar_checksum(&header));
+        header.chksum[7] = ' ';
+        char padding[TAR_BLOCK] = {0};
+        size_t padding_len = (TAR_BLOCK - len % TAR_BLOCK) % TAR_BLOCK;
+        ctx->ok = ctx->ok && fwrite(&header, sizeof(header), 1, ctx->tar) == 1 &&
+                  fwrite(name, len, 1, ctx->tar) == 1 &&
+                  (padding_len == 0 || fwrite(padding, padding_len, 1, ctx->tar) == 1);
+    }
+
+    unsigned char perm = inode->permissions & 7;
+    unsigned int mode = perm << 6 | (perm & ~PERM_WRITE) << 3 | (perm & ~PERM_WRITE);
+    memset(&header, 0, sizeof(header));
+    strncpy(header.name, name, sizeof(header.name) - 1);
+    snprintf(header.mode, sizeof(header.mode), "%07o", mode);
+    strcpy(header.uid, "0000000");
+    strcpy(header.gid, "0000000");
+    snprintf(header.size, sizeof(header.size), "%011zo", size);
+    snprintf(header.mtime, sizeof(header.mtime), "%011lo", (unsigned long)inode->mtime);
+    header.typeflag = typeflag;
+    if (linkname) strncpy(header.linkname, linkname, sizeof(header.linkname) - 1);
+    memcpy(header.magic, "ustar", 6);
+    memcpy(header.version, "00", 2);
+    snprintf(header.chksum, sizeof(header.chksum), "%06o", tar_checksum(&header));
+    header.chksum[7] = ' ';
+    ctx->ok = ctx->ok && fwrite(&header, sizeof(header), 1, ctx->tar) == 1;
+}
+
+/**
+ * @brief Exporter un inode et, pour un répertoire, son contenu
+ * @param ctx Le contexte d'export
+ * @param inode_number L'inode à exporter
+ * @param name Son chemin dans l'archive (vide pour la racine de l'export)
+ * @return Aucun
+ */
+static void export_inode(TarExport *ctx, int inode_number, const char *name) {
+    Inode *inode = &fs.inodes[inode_number];
+
+    if (inode->file_type == FILE_TYPE_DIR) {
+        char dir_name[MAX_PATH_LENGTH];
+        if (name[0]) {
+            snprintf(dir_name, sizeof(dir_name), "%s/", name);
+            tar_write_header(ctx, dir_name, inode, '5', 0, NULL);
+            ctx->directories++;
+        }
+        for (int i = 0; ctx->ok && i < MAX_FILES; i++) {
+            DirectoryEntry *entry = &fs.directory[i];
+            if (entry->parent_inode != inode_number || entry->inode_number == -1 ||
+                strcmp(entry->name, ".") == 0 || strcmp(entry->name, "..") == 0) {
+                continue;
+            }
+            char child_name[MAX_PATH_LENGTH];
+            snprintf(child_name, sizeof(child_name), "%s%s%s", name, name[0] ? "/" : "", entry->name);
+            export_inode(ctx, entry->inode_number, child_name);
+        }
+    } else if (inode->file_type == FILE_TYPE_SYMLINK) {
+        char link_path[MAX_PATH_LENGTH];
+        char target[MAX_PATH_LENGTH];
+        int written = snprintf(link_path, sizeof(link_path), "%s/%s", ctx->base, name);
+        if (written < 0 || (size_t)written >= sizeof(link_path) ||
+            relative_link_target(link_path, inode->data.symlink_path, target) != 0 ||
+            strlen(target) >= sizeof(((TarHeader *)NULL)->linkname)) {
+            printf("Skipping %s: link target too long\n", name);
+            return;
+        }
+        tar_write_header(ctx, name, inode, '2', 0, target);
+        ctx->links++;
+    } else if (inode->file_type == FILE_TYPE_REGULAR) {
+        // Les noms suivants d'un fichier à liens multiples deviennent des liens durs / 多链接文件的后续名字导出为硬链接
+        if (inode->link_count > 0 && ctx->first_path[inode_number][0]) {
+            tar_write_header(ctx, name, inode, '1', 0, ctx->first_path[inode_number]);
+            ctx->links++;
+            return;
+        }
+        if (inode->link_count > 0 && strlen(name) < sizeof(ctx->first_path[0])) {
+            strcpy(ctx->first_path[inode_number], name);
+        }
+
+        if (read_file_data(inode, 0, inode->size, ctx->data) != 0) {
+            printf("Skipping %s: file data is corrupted\n", name);
+            return;
+        }
+        tar_write_header(ctx, name, inode, '0', inode->size, NULL);
+        size_t padded = (inode->size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+        memset(ctx->data + inode->size, 0, padded - inode->size);
+        ctx->ok = ctx->ok && (padded == 0 || fwrite(ctx->data, padded, 1, ctx->tar) == 1);
+        ctx->files++;
+    }
+}
+
+/**
+ * @brief Commande export : écrire un fichier ou une arborescence du volume dans une archive tar de l'hôte
+ * @param path Le chemin à exporter dans le volume
+ * @param host_tar Le chemin de l'archive sur l'hôte
+ * @return Aucun
+ */
+void export_archive(const char *path, const char *host_tar) {
+    load_superblock();
+
+    int inode = get_inode_from_path(path);
+    if (inode == -1) {
+        command_error("Path not found\n");
+        return;
+    }
+    int readable = fs.inodes[inode].file_type == FILE_TYPE_DIR ? check_directory_permission(inode, PERM_READ)
+                                                                : check_file_permission(inode, PERM_READ);
+    if (!readable) {
+        command_error("Permission denied\n");
+        return;
+    }
+
+    TarExport *ctx = calloc(1, sizeof(TarExport));
+    if (!ctx) {
+        command_error("Out of memory\n");
+        return;
+    }
+    ctx->tar = fopen(host_tar, "wb");
+    if (!ctx->tar) {
+        perror("Failed to create archive");
+        free(ctx);
+        return;
+    }
+    char *io_buffer = malloc(TAR_IO_BUFFER);
+    if (io_buffer) setvbuf(ctx->tar, io_buffer, _IOFBF, TAR_IO_BUFFER);
+    ctx->ok = 1;
+
+    // Un répertoire est exporté sous son propre nom, la racine sans préfixe / 目录以自身名字导出，根目录不加前缀
+    char name[MAX_FILENAME_LENGTH] = "";
+    if (strcmp(path, "/") != 0) extract_last_path_component(path, name);
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) name[0] = '\0';
+    if (!name[0] && fs.inodes[inode].file_type != FILE_TYPE_DIR) strcpy(name, "file");
+
+    // Les noms de l'archive sont relatifs au répertoire qui contient le chemin exporté / 归档中的名字相对于包含导出路径的目录
+    if (absolute_path(path, ctx->base) != 0) strcpy(ctx->base, "/");
+    if (name[0]) {
+        char *slash = strrchr(ctx->base, '/');
+        if (slash == ctx->base) slash[1] = '\0';
+        else if (slash) *slash = '\0';
+    }
+    export_inode(ctx, inode, name);
+
+    // Deux blocs nuls terminent l'archive / 两个全零块结束归档
+    char end[2 * TAR_BLOCK] = {0};
+    ctx->ok = ctx->ok && fwrite(end, sizeof(end), 1, ctx->tar) == 1;
+    if (fclose(ctx->tar) != 0) ctx->ok = 0;
+    free(io_buffer);
+
+    if (ctx->ok) {
+        printf("Exported %d files, %d directories, %d links\n", ctx->files, ctx->directories, ctx->links);
+    } else {
+        command_error("Failed to write archive\n");
+    }
+    free(ctx);
+}
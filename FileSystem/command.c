@@ -0,0 +1,516 @@
+/**
+* @file command.c
+* @brief Découpage des lignes de commande et table de répartition des commandes
+* @author jzy
+* @date 2025-4-20
+*/
+#include "filesystem.h"
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+
+extern SuperBlock fs;
+
+// Ligne du script en cours d'exécution, pour préfixer les erreurs / 正在执行的脚本行，用于给错误加前缀
+static const char *error_source = NULL;  // NULL en interactif / 交互模式下为 NULL
+static int error_line = 0;
+static int command_failed = 0;           // La commande en cours a signalé une erreur / 当前命令已报告错误
+
+#define COMMAND_TABLE_SIZE 128  // Taille de la table de hachage des commandes (puissance de 2) / 命令哈希表大小（2 的幂）
+#define NEEDS_FS 1               // Le disque doit être formaté / 需要已格式化的磁盘
+#define READ_ONLY 2              // Ne modifie pas le volume (hors dates d'accès) / 不修改卷（访问时间除外）
+#define LOCK_INODES 4            // Ne modifie que ses cibles et leur parent : verrous d'inodes exclusifs / 只修改目标及其父目录：独占 inode 锁
+#define LOCKLESS 8               // Ne lit que des métadonnées, sans verrou (compteurs de séquence) / 只读元数据，无锁（序列计数器）
+#define LOCK_SUBTREE 16          // Lit toute la sous-arborescence de la cible / 读取目标的整个子树
+#define NO_WRITE 32              // Ne modifie pas le volume mais s'exécute dans le processus principal / 不修改卷，但在主进程中执行
+#define DISK_STATE 64            // Lit ou écrit directement le fichier disque : interdite dans une transaction / 直接读写磁盘文件：事务中禁止
+#define LOCAL_ONLY 128           // Indisponible par le serveur (transactions) / 不能通过服务器执行（事务）
+#define REPAIRS 256              // Autorisée sur des métadonnées corrompues (mkfs, fsck) / 元数据损坏时仍允许执行（mkfs、fsck）
+
+// Une commande : mot-clé (avec une éventuelle option), nombre d'arguments et fonction à appeler / 一条命令：关键字（可带选项）、参数个数和处理函数
+typedef struct {
+    const char *key;                               // "ls", "ls -l", "rm -rf"...
+    int min_args, max_args;                        // Arguments après le mot-clé / 关键字之后的参数个数
+    int flags;                                     // NEEDS_FS, READ_ONLY, LOCK_*, NO_WRITE
+    int paths;                                     // Arguments qui sont des chemins du volume (bit i : argument i) / 作为卷内路径的参数（第 i 位：第 i 个参数）
+    void (*run0)(void);                            // Commande sans argument / 无参数命令
+    void (*run1)(const char *);                    // Un argument (NULL s'il est absent) / 一个参数（缺省为 NULL）
+    void (*run2)(const char *, const char *);      // Deux arguments (le second peut être NULL) / 两个参数（第二个可以为 NULL）
+    int (*custom)(int argc, char **argv);          // Analyse propre à la commande / 命令自己的参数解析
+} Command;
+
+/**
+ * @brief Lire un entier décimal qui occupe tout l'argument
+ * @param arg L'argument
+ * @param value La valeur lue
+ * @return 1 si l'argument est un entier valide, 0 sinon
+ */
+static int parse_long(const char *arg, long *value) {
+    char *end;
+    *value = strtol(arg, &end, 10);
+    return end != arg && *end == '\0';
+}
+
+static int fs_initialized = -1;  // État du disque mis en cache, -1 si inconnu / 缓存的磁盘状态，-1 表示未知
+
+static int cmd_mkfs(int argc, char **argv) {
+    (void)argc; (void)argv;
+    format_partition();
+    fs_initialized = 1;
+    return COMMAND_OK;
+}
+
+static int cmd_ls_l(int argc, char **argv) {
+    if (argc == 0) show_list();
+    else show_list_one(argv[0]);
+    return COMMAND_OK;
+}
+
+static int cmd_head_tail(int argc, char **argv, void (*run)(const char *, int)) {
+    long lines;
+    if (argc != 2 || !parse_long(argv[1], &lines)) return COMMAND_INVALID;
+    run(argv[0], (int)lines);
+    return COMMAND_OK;
+}
+
+static int cmd_head(int argc, char **argv) {
+    return cmd_head_tail(argc, argv, head_file);
+}
+
+static int cmd_tail(int argc, char **argv) {
+    return cmd_head_tail(argc, argv, tail_file);
+}
+
+static int cmd_lines(int argc, char **argv) {
+    long first, last;
+    if (!parse_long(argv[1], &first) || !parse_long(argv[2], &last)) return COMMAND_INVALID;
+    (void)argc;
+    print_lines(argv[0], (int)first, (int)last);
+    return COMMAND_OK;
+}
+
+static int cmd_echo(int argc, char **argv) {
+    (void)argc;
+    if (strcmp(argv[1], ">>") == 0) {
+        append_to_file(argv[2], argv[0]);
+    } else if (strcmp(argv[1], ">") == 0) {
+        write_file(argv[2], argv[0]);
+    } else {
+        return COMMAND_INVALID;
+    }
+    return COMMAND_OK;
+}
+
+static int cmd_truncate(int argc, char **argv) {
+    long size;
+    (void)argc;
+    if (!parse_long(argv[1], &size) || size < 0) return COMMAND_INVALID;
+    truncate_file(argv[0], (size_t)size);
+    return COMMAND_OK;
+}
+
+static int cmd_mkdir_p(int argc, char **argv) {
+    create_directories(argc, argv);
+    return COMMAND_OK;
+}
+
+static int cmd_touch(int argc, char **argv) {
+    create_files(argc, argv);
+    return COMMAND_OK;
+}
+
+static int cmd_rm(int argc, char **argv) {
+    delete_files(argc, argv);
+    return COMMAND_OK;
+}
+
+static int cmd_begin(int argc, char **argv) {
+    (void)argc; (void)argv;
+    if (begin_transaction() != 0) command_error("Transaction already in progress\n");
+    else printf("Transaction started\n");
+    return COMMAND_OK;
+}
+
+static int cmd_commit(int argc, char **argv) {
+    (void)argc; (void)argv;
+    // Les tampons d'ajout ont déjà été appliqués avant la commande / 追加缓冲区已在命令执行前应用
+    int status = commit_transaction();
+    if (status == -1) command_error("No transaction in progress\n");
+    else if (status != 0) command_error("Transaction not committed\n");
+    else printf("Transaction committed\n");
+    return COMMAND_OK;
+}
+
+static int cmd_abort(int argc, char **argv) {
+    (void)argc; (void)argv;
+    if (abort_transaction() != 0) command_error("No transaction in progress\n");
+    else printf("Transaction aborted\n");
+    return COMMAND_OK;
+}
+
+static int cmd_sync(int argc, char **argv) {
+    (void)argc; (void)argv;
+    // Les tampons d'ajout ont déjà été écrits avant la commande / 追加缓冲区已在命令执行前写回
+    commit_session();
+    printf("Pending writes flushed\n");
+    return COMMAND_OK;
+}
+
+// Table des commandes / 命令表
+static const Command commands[] = {
+    { "mkfs",     0, 0, DISK_STATE | REPAIRS, 0, .custom = cmd_mkfs },
+    { "help",     0, 0, READ_ONLY, 0, .run0 = show_help },
+    { "ls",       0, 0, NEEDS_FS | READ_ONLY | LOCKLESS, 0, .run0 = show_ls },
+    { "ls -a",    0, 0, NEEDS_FS | READ_ONLY | LOCKLESS, 0, .run0 = show_ls_all },
+    { "ls -l",    0, 1, NEEDS_FS | READ_ONLY | LOCKLESS, 1, .custom = cmd_ls_l },
+    { "ls -la",   0, 0, NEEDS_FS | READ_ONLY | LOCKLESS, 0, .run0 = show_list_all },
+    { "ls -it",   0, 0, NEEDS_FS | READ_ONLY | LOCKLESS, 0, .run0 = list_file_dir },
+    { "ls -i",    1, 1, NEEDS_FS | READ_ONLY | LOCKLESS, 1, .run1 = show_inode },
+    { "tree",     0, 0, NEEDS_FS | READ_ONLY | LOCK_SUBTREE, 0, .run0 = show_tree },
+    { "tree -i",  0, 0, NEEDS_FS | READ_ONLY | LOCK_SUBTREE, 0, .run0 = show_tree_inodes },
+    { "pwd",      0, 0, NEEDS_FS | READ_ONLY | LOCKLESS, 0, .run0 = print_working_directory },
+    { "cd",       1, 1, NEEDS_FS | NO_WRITE, 0, .run1 = change_directory },
+    { "mkdir",    1, 1, NEEDS_FS, 0, .run1 = create_directory },
+    { "mkdir -p", 1, MAX_COMMAND_ARGS, NEEDS_FS, 0, .custom = cmd_mkdir_p },
+    { "rmdir",    1, 1, NEEDS_FS, 0, .run1 = delete_directory },
+    { "rm -rf",   1, 1, NEEDS_FS, 0, .run1 = delete_directory_force },
+    { "mvdir",    2, 2, NEEDS_FS, 0, .run2 = move_directory },
+    { "du",       1, 1, NEEDS_FS | READ_ONLY | LOCK_SUBTREE, 1, .run1 = du_command },
+    { "touch",    1, MAX_COMMAND_ARGS, NEEDS_FS, 0, .custom = cmd_touch },
+    { "rm",       1, MAX_COMMAND_ARGS, NEEDS_FS, 0, .custom = cmd_rm },
+    { "cat",      1, 1, NEEDS_FS | READ_ONLY, 1, .run1 = open_file },
+    { "head",     2, 2, NEEDS_FS | READ_ONLY, 1, .custom = cmd_head },
+    { "tail",     2, 2, NEEDS_FS | READ_ONLY, 1, .custom = cmd_tail },
+    { "lines",    3, 3, NEEDS_FS | READ_ONLY, 1, .custom = cmd_lines },
+    { "echo",     3, 3, NEEDS_FS | LOCK_INODES, 4, .custom = cmd_echo },
+    { "truncate", 2, 2, NEEDS_FS | LOCK_INODES, 1, .custom = cmd_truncate },
+    { "mv",       2, 2, NEEDS_FS, 0, .run2 = move_file },
+    { "cp",       2, 2, NEEDS_FS, 0, .run2 = copy_file },
+    { "perm",     1, 1, NEEDS_FS | READ_ONLY, 1, .run1 = show_permissions },
+    { "chmod",    2, 2, NEEDS_FS | LOCK_INODES, 1, .run2 = change_permissions },
+    { "ln",       2, 2, NEEDS_FS, 0, .run2 = link_file },
+    { "link",     2, 2, NEEDS_FS, 0, .run2 = create_symlink },
+    { "unlink",   1, 1, NEEDS_FS, 0, .run1 = delete_symlink },
+    { "dedup",    0, 1, NEEDS_FS, 0, .run1 = dedup_command },
+    { "compress", 0, 1, NEEDS_FS, 0, .run1 = compress_command },
+    { "snapshot", 1, 2, NEEDS_FS | DISK_STATE, 0, .run2 = snapshot_command },
+    { "send",     1, 2, NEEDS_FS | DISK_STATE, 0, .run2 = send_command },
+    { "receive",  1, 1, NEEDS_FS | DISK_STATE, 0, .run1 = receive_command },
+    { "import",   1, 2, NEEDS_FS, 0, .run2 = import_archive },
+    { "export",   2, 2, NEEDS_FS | READ_ONLY | LOCK_SUBTREE, 1, .run2 = export_archive },
+    { "put",      2, 2, NEEDS_FS, 0, .run2 = put_file },
+    { "get",      2, 2, NEEDS_FS | NO_WRITE | DISK_STATE, 0, .run2 = get_file },
+    { "fsck",     0, 1, NEEDS_FS | DISK_STATE | REPAIRS, 0, .run1 = fsck_command },
+    { "sync",     0, 0, NEEDS_FS | NO_WRITE | DISK_STATE, 0, .custom = cmd_sync },
+    { "begin",    0, 0, NEEDS_FS | NO_WRITE | LOCAL_ONLY, 0, .custom = cmd_begin },
+    { "commit",   0, 0, NEEDS_FS | NO_WRITE | LOCAL_ONLY, 0, .custom = cmd_commit },
+    { "abort",    0, 0, NEEDS_FS | NO_WRITE | LOCAL_ONLY, 0, .custom = cmd_abort },
+};
+
+static const Command *command_table[COMMAND_TABLE_SIZE];  // Hachage ouvert des mots-clés / 关键字的开放寻址哈希表
+
+/**
+ * @brief Calculer le hachage FNV-1a d'un mot-clé
+ * @param key Le mot-clé
+ * @return La valeur de hachage
+ */
+static unsigned int command_hash(const char *key) {
+    unsigned int hash = 2166136261u;
+    for (; *key; key++) {
+        hash = (hash ^ (unsigned char)*key) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Rechercher une commande par son mot-clé, en construisant la table au premier appel
+ * @param key Le mot-clé
+ * @return La commande, ou NULL si elle n'existe pas
+ */
+static const Command *find_command(const char *key) {
+    static int built = 0;
+    if (!built) {
+        for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+            unsigned int slot = command_hash(commands[i].key) & (COMMAND_TABLE_SIZE - 1);
+            while (command_table[slot]) slot = (slot + 1) & (COMMAND_TABLE_SIZE - 1);
+            command_table[slot] = &commands[i];
+        }
+        built = 1;
+    }
+    unsigned int slot = command_hash(key) & (COMMAND_TABLE_SIZE - 1);
+    while (command_table[slot]) {
+        if (strcmp(command_table[slot]->key, key) == 0) return command_table[slot];
+        slot = (slot + 1) & (COMMAND_TABLE_SIZE - 1);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Trouver la commande correspondant aux premiers mots d'une ligne
+ * @details Une option (mot commençant par '-') placée après le verbe est d'abord cherchée avec lui
+ *          ("ls -l"), sinon elle est traitée comme un argument
+ * @param argc Le nombre de mots (au moins 1)
+ * @param argv Les mots
+ * @param first Reçoit l'indice du premier argument
+ * @return La commande, ou NULL si elle n'existe pas
+ */
+static const Command *lookup_command(int argc, char *argv[], int *first) {
+    if (argc > 1 && argv[1][0] == '-' && strlen(argv[0]) + strlen(argv[1]) < 32) {
+        char key[32];
+        snprintf(key, sizeof(key), "%s %s", argv[0], argv[1]);
+        const Command *command = find_command(key);
+        if (command) {
+            *first = 2;
+            return command;
+        }
+    }
+    *first = 1;
+    return find_command(argv[0]);
+}
+
+/**
+ * @brief Indiquer si une commande ne fait que lire le volume
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @return 1 si la commande existe et ne modifie pas le volume, 0 sinon
+ */
+int command_is_read_only(int argc, char *argv[]) {
+    if (argc > 0 && is_pipeline(argc, argv)) return pipeline_read_only(argc, argv);
+    int first;
+    const Command *command = argc > 0 ? lookup_command(argc, argv, &first) : NULL;
+    return command != NULL && (command->flags & READ_ONLY);
+}
+
+/**
+ * @brief Indiquer si une commande ne peut pas être exécutée par le serveur
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @return 1 si la commande existe et n'est disponible que localement, 0 sinon
+ */
+int command_is_local_only(int argc, char *argv[]) {
+    int first;
+    const Command *command = argc > 0 ? lookup_command(argc, argv, &first) : NULL;
+    return command != NULL && (command->flags & LOCAL_ONLY);
+}
+
+/**
+ * @brief Ajouter à un ensemble les verrous nécessaires pour un chemin
+ * @param set L'ensemble de verrous
+ * @param path Le chemin (la cible d'un lien symbolique est aussi verrouillée)
+ * @param flags Les drapeaux de la commande
+ * @return Aucun
+ */
+static void add_path_locks(LockSet *set, const char *path, int flags) {
+    int exclusive = !(flags & READ_ONLY);
+    int inode_number = get_inode_from_path(path);
+    if (exclusive) lock_set_add(set, get_parent_directory_inode(path), 1);
+    if (inode_number == -1) return;
+    lock_set_add(set, inode_number, exclusive);
+    if (fs.inodes[inode_number].file_type == FILE_TYPE_SYMLINK) {
+        inode_number = resolve_symlink(inode_number);
+        if (inode_number == -1) return;
+        lock_set_add(set, inode_number, exclusive);
+    }
+    if ((flags & LOCK_SUBTREE) && fs.inodes[inode_number].file_type == FILE_TYPE_DIR) {
+        lock_set_add_children(set, inode_number, 1);
+    }
+}
+
+/**
+ * @brief Prendre les verrous d'une commande
+ * @details Les chemins sont résolus sous le verrou partagé du volume : l'arborescence ne peut pas
+ *          changer avant que les verrous d'inodes soient pris
+ * @param command La commande
+ * @param nargs Le nombre d'arguments
+ * @param args Les arguments
+ * @param whole_volume 1 si la commande doit avoir le volume entier (arborescence, ajouts en tampon...)
+ * @param set Reçoit les verrous d'inodes pris
+ * @return 1 si le verrou exclusif du volume a été pris, 0 sinon
+ */
+static int acquire_command_locks(const Command *command, int nargs, char **args, int whole_volume, LockSet *set) {
+    lock_set_init(set);
+    if (!(command->flags & NEEDS_FS)) whole_volume = !(command->flags & READ_ONLY);
+    else if (!(command->flags & (READ_ONLY | LOCK_INODES))) whole_volume = 1;
+
+    lock_volume(whole_volume);
+    if (whole_volume || !(command->flags & NEEDS_FS)) return whole_volume;
+
+    int targets = 0;
+    for (int i = 0; i < nargs; i++) {
+        if (command->paths & (1 << i)) {
+            add_path_locks(set, args[i], command->flags);
+            targets++;
+        }
+    }
+    if (targets == 0) add_path_locks(set, current_path, command->flags);
+
+    if (set->overflow) {
+        unlock_volume();
+        lock_set_init(set);
+        lock_volume(1);
+        return 1;
+    }
+    lock_set_acquire(set);
+    return 0;
+}
+
+/**
+ * @brief Découper une ligne de commande en mots, sur place
+ * @param line La ligne (modifiée : les séparateurs sont remplacés par '\0')
+ * @param argv Le tableau des mots
+ * @param max_args La taille du tableau
+ * @return Le nombre de mots, ou -1 s'il y en a trop
+ */
+int tokenize_command(char *line, char *argv[], int max_args) {
+    int argc = 0;
+    char *p = line;
+    while (1) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0') break;
+        if (argc == max_args) return -1;
+        argv[argc++] = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+        if (*p) *p++ = '\0';
+    }
+    return argc;
+}
+
+/**
+ * @brief Appeler la fonction d'une commande
+ * @param command La commande
+ * @param nargs Le nombre d'arguments, déjà vérifié
+ * @param args Les arguments
+ * @return COMMAND_OK, ou COMMAND_INVALID si les arguments sont invalides
+ */
+static int run_command(const Command *command, int nargs, char **args) {
+    const char *arg0 = nargs > 0 ? args[0] : NULL;
+    const char *arg1 = nargs > 1 ? args[1] : NULL;
+
+    if (command->custom) return command->custom(nargs, args);
+    if (command->run0) command->run0();
+    else if (command->run1) command->run1(arg0);
+    else command->run2(arg0, arg1);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Indiquer la ligne de script des commandes suivantes
+ * @param source Le nom du script, ou NULL en interactif (pas de préfixe)
+ * @param line Le numéro de ligne
+ * @return Aucun
+ */
+void set_command_location(const char *source, int line) {
+    error_source = source;
+    error_line = line;
+}
+
+/**
+ * @brief Afficher l'échec de la commande en cours et la marquer comme échouée
+ * @details En mode script, le message est préfixé par source:ligne, comme les erreurs d'analyse
+ * @param format Le format du message, comme printf
+ * @return Aucun
+ */
+void command_error(const char *format, ...) {
+    command_failed = 1;
+    if (error_source != NULL) printf("%s:%d: ", error_source, error_line);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/**
+ * @brief Exécuter une commande déjà découpée en mots
+ * @details Les tampons d'ajout sont fermés avant toute commande autre qu'un ajout. Si locking_enabled
+ *          est actif, la commande s'exécute sous ses verrous (voir lock.c). Une commande qui peut
+ *          écrire attend d'être le processus rédacteur ; sur un montage en lecture seule, ou tant que
+ *          des métadonnées corrompues n'ont pas été réparées par fsck, elle est refusée
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @return COMMAND_OK, COMMAND_EXIT, COMMAND_INVALID ou COMMAND_NOT_INIT
+ */
+static int dispatch_command(int argc, char *argv[]) {
+    if (argc == 0) return COMMAND_INVALID;
+
+    // L'état du disque n'est vérifié qu'une fois / 磁盘状态只检查一次
+    if (fs_initialized == -1) {
+        struct stat buffer;
+        fs_initialized = stat(DISK_FILE, &buffer) == 0;
+    }
+
+    // Toute commande autre qu'un ajout ferme les tampons d'ajout ouverts / 除追加外的任何命令都会关闭已打开的追加缓冲区
+    int is_append = argc == 4 && strcmp(argv[0], "echo") == 0 && strcmp(argv[2], ">>") == 0;
+    if (fs_initialized && !locking_enabled) {
+        sync_append_buffers(!is_append);
+    }
+    if (strcmp(argv[0], "exit") == 0) return argc == 1 ? COMMAND_EXIT : COMMAND_INVALID;
+
+    // Un pipeline enchaîne plusieurs commandes / 管道串联多个命令
+    if (is_pipeline(argc, argv)) {
+        if (!fs_initialized) return COMMAND_NOT_INIT;
+        return run_pipeline(argc, argv);
+    }
+
+    int first;
+    const Command *command = lookup_command(argc, argv, &first);
+    if (command == NULL) return COMMAND_INVALID;
+    if ((command->flags & NEEDS_FS) && !fs_initialized) return COMMAND_NOT_INIT;
+
+    int nargs = argc - first;
+    if (nargs < command->min_args || nargs > command->max_args) return COMMAND_INVALID;
+    char **args = argv + first;
+
+    // Entre processus, seul le rédacteur modifie le volume ; les autres rechargent l'image republiée / 进程之间只有写者修改卷，其他进程重新加载已发布的镜像
+    if (read_only_mount && !(command->flags & (READ_ONLY | NO_WRITE))) {
+        command_error("Read-only file system\n");
+        return COMMAND_OK;
+    }
+    if (metadata_damaged() && !(command->flags & (READ_ONLY | NO_WRITE | REPAIRS))) {
+        command_error("Metadata checksum mismatch, run 'fsck repair'\n");
+        return COMMAND_OK;
+    }
+    if ((command->flags & DISK_STATE) && in_transaction()) {
+        command_error("Not allowed in a transaction\n");
+        return COMMAND_OK;
+    }
+    // Les lectures sur le volume écrivent aussi les dates d'accès, sauf les listes sans verrou / 卷上的读命令也会写访问时间，无锁列表除外
+    int writes = !(command->flags & LOCKLESS) && ((command->flags & NEEDS_FS) || !(command->flags & READ_ONLY));
+    if (writes) acquire_disk_writer();
+    else refresh_session();
+
+    int status;
+    if (!locking_enabled || (command->flags & LOCKLESS)) {
+        status = run_command(command, nargs, args);
+        release_disk_writer();
+        return status;
+    }
+
+    // Avec les verrous, un ajout est écrit avant de rendre la main : les tampons sont partagés / 加锁时追加在返回前写回：缓冲区是共享的
+    LockSet locks;
+    int whole_volume = acquire_command_locks(command, nargs, args, is_append, &locks);
+    if (whole_volume) namespace_write_begin();
+    status = run_command(command, nargs, args);
+    if (is_append) sync_append_buffers(1);
+    if (whole_volume) namespace_write_end();
+    else lock_set_release(&locks);
+    unlock_volume();
+    release_disk_writer();
+    return status;
+}
+
+/**
+ * @brief Exécuter une commande et indiquer si elle a échoué
+ * @details Une commande qui a appelé command_error() renvoie COMMAND_FAILED. Les commandes
+ *          imbriquées (source d'un pipeline) comptent pour la commande qui les contient
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @return COMMAND_OK, COMMAND_FAILED, COMMAND_EXIT, COMMAND_INVALID ou COMMAND_NOT_INIT
+ */
+int execute_command(int argc, char *argv[]) {
+    int outer_failed = command_failed;
+    command_failed = 0;
+    int status = dispatch_command(argc, argv);
+    if (status == COMMAND_OK && command_failed) status = COMMAND_FAILED;
+    command_failed |= outer_failed;
+    return status;
+}
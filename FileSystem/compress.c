@@ -0,0 +1,326 @@
+/**
+* @file compress.c
+* @brief Compression des pages de fichiers (codec LZ) et cache des pages décompressées
+* @author jzy
+* @date 2025-4-13
+*/
+#include "filesystem.h"
+#include <stdint.h>
+
+extern SuperBlock fs;
+
+#define LZ_MIN_MATCH 4  // Longueur minimale d'une correspondance / 最短匹配长度
+#define LZ_HASH_BITS 12  // Taille de la table de hachage du compresseur (2^12) / 压缩器哈希表大小 (2^12)
+#define LZ_MAX_OFFSET 65535  // Distance maximale d'une correspondance / 最大匹配距离
+#define PAGE_CACHE_SLOTS 16  // Nombre de pages décompressées gardées en mémoire / 缓存的解压页面数量
+
+// Page décompressée en cache / 缓存的解压页面
+typedef struct {
+    int valid;
+    int inode;                   // Inode du fichier / 文件 inode
+    int page_index;              // Indice de la page dans le fichier / 文件中的页索引
+    time_t mtime;                // Temps de modification du fichier au décodage / 解码时文件的修改时间
+    size_t size;                 // Taille du fichier au décodage / 解码时文件大小
+    unsigned short comp_end;     // Fin de la page compressée au décodage / 解码时压缩页的结束位置
+    unsigned int epoch;          // Génération du fichier au décodage / 解码时文件的版本
+    unsigned int last_use;       // Horloge LRU / LRU 时钟
+    char data[PAGE_SIZE];
+} CachedPage;
+
+// Un cache par thread, les lecteurs parallèles ne se partagent pas les emplacements / 每个线程一个缓存，并行读者不共享槽位
+static __thread CachedPage page_cache[PAGE_CACHE_SLOTS];
+static __thread unsigned int cache_clock = 0;
+static unsigned int cache_epoch[MAX_FILES];  // Incrémentée à chaque modification d'un fichier / 文件每次修改时递增
+
+/**
+ * @brief Écrire une longueur étendue (suite d'octets 255 puis le reste)
+ * @return La nouvelle position de sortie, ou 0 si le tampon est trop petit
+ */
+static size_t lz_write_length(unsigned char *dst, size_t op, size_t cap, size_t length) {
+    while (length >= 255) {
+        if (op >= cap) return 0;
+        dst[op++] = 255;
+        length -= 255;
+    }
+    if (op >= cap) return 0;
+    dst[op++] = (unsigned char)length;
+    return op;
+}
+
+/**
+ * @brief Émettre une séquence : littéraux puis, si match_len > 0, une correspondance
+ * @return La nouvelle position de sortie, ou 0 si le tampon est trop petit
+ */
+static size_t lz_emit(unsigned char *dst, size_t op, size_t cap, const unsigned char *literals,
+                      size_t literal_len, size_t offset, size_t match_len) {
+    if (op >= cap) return 0;
+    size_t token = op++;
+    size_t match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+    dst[token] = (unsigned char)(((literal_len < 15 ? literal_len : 15) << 4) |
+                                 (match_code < 15 ? match_code : 15));
+
+    if (literal_len >= 15 && (op = lz_write_length(dst, op, cap, literal_len - 15)) == 0) return 0;
+    if (op + literal_len > cap) return 0;
+    memcpy(dst + op, literals, literal_len);
+    op += literal_len;
+
+    if (match_len == 0) return op;
+    if (op + 2 > cap) return 0;
+    dst[op++] = (unsigned char)(offset & 0xff);
+    dst[op++] = (unsigned char)(offset >> 8);
+    if (match_code >= 15 && (op = lz_write_length(dst, op, cap, match_code - 15)) == 0) return 0;
+    return op;
+}
+
+/**
+ * @brief Compresser un bloc avec un codec LZ77 (format proche de LZ4)
+ * @details Chaque séquence : jeton (4 bits littéraux, 4 bits correspondance), littéraux,
+ *          distance sur 2 octets, longueurs étendues par octets 255. La dernière séquence n'a que des littéraux.
+ * @param src Les données à compresser
+ * @param len La longueur des données
+ * @param dst Le tampon de sortie
+ * @param cap La capacité du tampon de sortie
+ * @return La taille compressée, ou 0 si elle dépasse cap
+ */
+size_t lz_compress(const char *src, size_t len, char *dst, size_t cap) {
+    const unsigned char *in = (const unsigned char *)src;
+    unsigned char *out = (unsigned char *)dst;
+    int table[1 << LZ_HASH_BITS];
+    memset(table, -1, sizeof(table));
+
+    size_t ip = 0, anchor = 0, op = 0;
+    while (ip + LZ_MIN_MATCH <= len) {
+        uint32_t seq;
+        memcpy(&seq, in + ip, sizeof(seq));
+        uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        int ref = table[h];
+        table[h] = (int)ip;
+
+        uint32_t ref_seq;
+        if (ref < 0 || ip - ref > LZ_MAX_OFFSET ||
+            (memcpy(&ref_seq, in + ref, sizeof(ref_seq)), ref_seq != seq)) {
+            ip++;
+            continue;
+        }
+
+        // Étendre la correspondance / 扩展匹配
+        size_t match_len = LZ_MIN_MATCH;
+        while (ip + match_len < len && in[ref + match_len] == in[ip + match_len]) {
+            match_len++;
+        }
+
+        op = lz_emit(out, op, cap, in + anchor, ip - anchor, ip - ref, match_len);
+        if (op == 0) return 0;
+        ip += match_len;
+        anchor = ip;
+    }
+
+    op = lz_emit(out, op, cap, in + anchor, len - anchor, 0, 0);
+    return op;
+}
+
+/**
+ * @brief Décompresser un bloc produit par lz_compress
+ * @param src Les données compressées
+ * @param len La longueur des données compressées
+ * @param dst Le tampon de sortie
+ * @param cap La capacité du tampon de sortie
+ * @return La taille décompressée, ou -1 si les données sont invalides
+ */
+long lz_decompress(const char *src, size_t len, char *dst, size_t cap) {
+    const unsigned char *in = (const unsigned char *)src;
+    unsigned char *out = (unsigned char *)dst;
+    size_t ip = 0, op = 0;
+
+    while (ip < len) {
+        unsigned char token = in[ip++];
+
+        // Littéraux / 字面量
+        size_t literal_len = token >> 4;
+        if (literal_len == 15) {
+            unsigned char b;
+            do {
+                if (ip >= len) return -1;
+                b = in[ip++];
+                literal_len += b;
+            } while (b == 255);
+        }
+        if (ip + literal_len > len || op + literal_len > cap) return -1;
+        memcpy(out + op, in + ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+        if (ip == len) break;
+
+        // Correspondance / 匹配
+        if (ip + 2 > len) return -1;
+        size_t offset = in[ip] | ((size_t)in[ip + 1] << 8);
+        ip += 2;
+        size_t match_len = token & 0x0f;
+        if (match_len == 15) {
+            unsigned char b;
+            do {
+                if (ip >= len) return -1;
+                b = in[ip++];
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || op + match_len > cap) return -1;
+
+        // Copie octet par octet : la source peut chevaucher la destination / 逐字节复制：源和目标可能重叠
+        for (size_t i = 0; i < match_len; i++, op++) {
+            out[op] = out[op - offset];
+        }
+    }
+    return (long)op;
+}
+
+/**
+ * @brief Compresser le contenu d'un fichier page par page en un flux continu
+ * @param data Le contenu du fichier
+ * @param len La taille du contenu
+ * @param stream Le tampon du flux compressé (MAX_FILE_PAGES * PAGE_SIZE octets)
+ * @param comp_end Position de fin de chaque page compressée dans le flux
+ * @return La taille du flux, ou 0 si la compression ne fait pas gagner de page
+ */
+size_t compress_file_data(const char *data, size_t len, char *stream, unsigned short *comp_end) {
+    size_t pages = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+    size_t cap = (pages - 1) * PAGE_SIZE;  // Il faut économiser au moins une page / 至少要节省一页
+    size_t stream_len = 0;
+
+    for (size_t i = 0; i < pages; i++) {
+        size_t page_len = (len - i * PAGE_SIZE > PAGE_SIZE) ? PAGE_SIZE : len - i * PAGE_SIZE;
+        if (stream_len >= cap) return 0;
+        size_t room = (cap - stream_len > PAGE_SIZE) ? PAGE_SIZE : cap - stream_len;
+        size_t n = lz_compress(data + i * PAGE_SIZE, page_len, stream + stream_len, room);
+        if (n == 0) return 0;
+        stream_len += n;
+        comp_end[i] = (unsigned short)stream_len;
+    }
+    return stream_len;
+}
+
+/**
+ * @brief Oublier les pages décompressées en cache d'un fichier
+ * @details La génération du fichier change, ce qui périme ses pages dans le cache de chaque thread
+ * @param inode_number Le numéro d'inode du fichier modifié
+ * @return Aucun
+ */
+void page_cache_invalidate(int inode_number) {
+    __atomic_add_fetch(&cache_epoch[inode_number], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Obtenir une page décompressée d'un fichier compressé, via le cache
+ * @param inode L'inode du fichier (compressed != 0)
+ * @param page_index L'indice de la page dans le fichier
+ * @return Les données décompressées de la page, ou NULL si une page physique ne correspond pas à son checksum
+ */
+const char *compressed_page_data(const Inode *inode, int page_index) {
+    // Rechercher dans le cache / 在缓存中查找
+    unsigned int epoch = __atomic_load_n(&cache_epoch[inode->inode_number], __ATOMIC_ACQUIRE);
+    CachedPage *slot = &page_cache[0];
+    for (int i = 0; i < PAGE_CACHE_SLOTS; i++) {
+        CachedPage *entry = &page_cache[i];
+        if (entry->valid && entry->inode == inode->inode_number && entry->epoch == epoch &&
+            entry->page_index == page_index && entry->mtime == inode->mtime &&
+            entry->size == inode->size && entry->comp_end == inode->comp_end[page_index]) {
+            entry->last_use = ++cache_clock;
+            return entry->data;
+        }
+        if (!entry->valid || (slot->valid && entry->last_use < slot->last_use)) {
+            slot = entry;
+        }
+    }
+
+    // Rassembler la page compressée, qui peut chevaucher deux pages physiques / 收集压缩页数据，可能跨越两个物理页
+    char packed[PAGE_SIZE];
+    size_t start = page_index ? inode->comp_end[page_index - 1] : 0;
+    size_t end = inode->comp_end[page_index];
+    size_t copied = 0;
+    while (start + copied < end) {
+        size_t pos = start + copied;
+        size_t chunk = PAGE_SIZE - pos % PAGE_SIZE;
+        if (chunk > end - pos) chunk = end - pos;
+        if (!verify_page_checksum(inode->pages[pos / PAGE_SIZE])) return NULL;
+        memcpy(packed + copied, fs.page_table[inode->pages[pos / PAGE_SIZE]].data + pos % PAGE_SIZE, chunk);
+        copied += chunk;
+    }
+
+    if (lz_decompress(packed, copied, slot->data, PAGE_SIZE) < 0) {
+        command_error("Corrupted compressed page %d of inode %d\n", page_index, inode->inode_number);
+        memset(slot->data, 0, PAGE_SIZE);
+    }
+    slot->valid = 1;
+    slot->inode = inode->inode_number;
+    slot->page_index = page_index;
+    slot->mtime = inode->mtime;
+    slot->size = inode->size;
+    slot->comp_end = inode->comp_end[page_index];
+    slot->epoch = epoch;
+    slot->last_use = ++cache_clock;
+    return slot->data;
+}
+
+/**
+ * @brief Réécrire les fichiers paginés selon le mode de compression courant
+ * @return Le nombre de fichiers réécrits
+ */
+static int recompress_files() {
+    int rewritten = 0;
+    for (int i = 0; i < MAX_FILES; i++) {
+        Inode *inode = &fs.inodes[i];
+        if (inode->inode_number != i || inode->file_type != FILE_TYPE_REGULAR || inode->page_count == 0) {
+            continue;
+        }
+        if (inode->compressed == fs.compress_enabled) continue;
+
+        char content[MAX_FILE_PAGES * PAGE_SIZE];
+        if (read_file_data(inode, 0, inode->size, content) != 0) {
+            command_error("Data of inode %d is corrupted, left unchanged\n", i);
+            continue;
+        }
+        if (store_file_data(inode, content, inode->size) != 0) {
+            command_error("No free pages available for inode %d\n", i);
+            continue;
+        }
+        rewritten++;
+    }
+    return rewritten;
+}
+
+/**
+ * @brief Commande compress : activer, désactiver ou afficher l'état de la compression
+ * @details Le changement de mode réécrit aussitôt les fichiers existants
+ * @param arg "on", "off" ou NULL pour afficher l'état
+ * @return Aucun
+ */
+void compress_command(const char *arg) {
+    load_superblock();
+
+    if (arg != NULL && (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0)) {
+        fs.compress_enabled = (strcmp(arg, "on") == 0);
+        int rewritten = recompress_files();
+        save_superblock();
+        printf("Compression %s (%d files rewritten)\n", fs.compress_enabled ? "enabled" : "disabled", rewritten);
+        return;
+    }
+
+    if (arg != NULL) {
+        command_error("Usage: compress [on|off]\n");
+        return;
+    }
+
+    // Afficher l'état / 显示状态
+    int files = 0;
+    size_t logical = 0, stored = 0;
+    for (int i = 0; i < MAX_FILES; i++) {
+        Inode *inode = &fs.inodes[i];
+        if (inode->inode_number != i || !inode->compressed) continue;
+        files++;
+        logical += inode->size;
+        stored += (size_t)inode->page_count * PAGE_SIZE;
+    }
+    printf("Compression: %s\n", fs.compress_enabled ? "on" : "off");
+    printf("Compressed files: %d, %zu bytes in %zu bytes of pages\n", files, logical, stored);
+}
@@ -0,0 +1,124 @@
+/**
+* @file crc32c.c
+* @brief Calcul de CRC32C (instruction SSE4.2 si disponible, sinon slicing-by-8)
+* @author jzy
+* @date 2025-4-14
+*/
+#include "filesystem.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC32C_HAVE_SSE42 1
+#endif
+
+#define CRC32C_POLY 0x82f63b78u  // Polynôme de Castagnoli (forme réfléchie) / Castagnoli 多项式（反射形式）
+
+static uint32_t crc_table[8][256];
+static int crc_table_ready = 0;
+
+/**
+ * @brief Construire les tables du calcul logiciel slicing-by-8
+ * @return Aucun
+ */
+static void crc32c_init_tables() {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc_table[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        for (int k = 1; k < 8; k++) {
+            crc_table[k][n] = (crc_table[k - 1][n] >> 8) ^ crc_table[0][crc_table[k - 1][n] & 0xff];
+        }
+    }
+    crc_table_ready = 1;
+}
+
+/**
+ * @brief CRC32C logiciel, 8 octets par itération (petit-boutiste)
+ * @param crc La valeur courante (déjà inversée)
+ * @param p Les données
+ * @param len La longueur des données
+ * @return La nouvelle valeur courante
+ */
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len) {
+    if (!crc_table_ready) crc32c_init_tables();
+
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = crc_table[7][lo & 0xff] ^ crc_table[6][(lo >> 8) & 0xff] ^
+              crc_table[5][(lo >> 16) & 0xff] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xff] ^ crc_table[2][(hi >> 8) & 0xff] ^
+              crc_table[1][(hi >> 16) & 0xff] ^ crc_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HAVE_SSE42
+/**
+ * @brief CRC32C matériel avec l'instruction crc32 de SSE4.2
+ * @param crc La valeur courante (déjà inversée)
+ * @param p Les données
+ * @param len La longueur des données
+ * @return La nouvelle valeur courante
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len) {
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (len >= 4) {
+        uint32_t word;
+        memcpy(&word, p, 4);
+        crc = _mm_crc32_u32(crc, word);
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+/**
+ * @brief Calculer le CRC32C d'un bloc de données
+ * @details Utilise l'instruction SSE4.2 quand le processeur la fournit, sinon le calcul slicing-by-8
+ * @param data Les données
+ * @param len La longueur des données
+ * @return Le CRC32C des données
+ */
+unsigned int crc32c(const void *data, size_t len) {
+    static int use_hw = -1;
+    if (use_hw < 0) {
+#ifdef CRC32C_HAVE_SSE42
+        use_hw = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+#else
+        use_hw = 0;
+#endif
+    }
+
+#ifdef CRC32C_HAVE_SSE42
+    if (use_hw) return ~crc32c_hw(~0u, (const unsigned char *)data, len);
+#endif
+    return ~crc32c_sw(~0u, (const unsigned char *)data, len);
+}
@@ -0,0 +1,164 @@
+/**
+* @file dedup.c
+* @brief Déduplication des pages par empreinte de contenu
+* @author jzy
+* @date 2025-4-12
+*/
+#include "filesystem.h"
+#include <stdint.h>
+
+extern SuperBlock fs;
+
+#define DEDUP_BUCKETS 8192  // Taille de la table de hachage (puissance de 2) / 哈希表大小（2的幂）
+
+// Index des empreintes : chaque case contient un numéro de page ou -1 / 指纹索引：每个槽存放一个页号或-1
+// L'index n'est qu'un indice, chaque correspondance est vérifiée octet par octet / 索引只是提示，每次匹配都会逐字节验证
+static int dedup_index[DEDUP_BUCKETS];
+static uint64_t page_hash[MAX_FILES * MAX_FILE_PAGES];
+static int dedup_index_entries = -1;  // -1 : index pas encore construit / -1：索引尚未建立
+
+/**
+ * @brief Calculer l'empreinte du contenu d'une page
+ * @details Hachage non cryptographique traitant 8 octets à la fois
+ * @param data Les données de la page
+ * @return L'empreinte sur 64 bits
+ */
+static uint64_t page_fingerprint(const char *data) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < PAGE_SIZE; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+/**
+ * @brief Insérer une page dans l'index, en remplaçant une entrée périmée de même empreinte
+ * @param page_number Le numéro de la page
+ * @param hash L'empreinte de la page
+ * @return Aucun
+ */
+static void dedup_index_insert(int page_number, uint64_t hash) {
+    page_hash[page_number] = hash;
+    size_t slot = hash & (DEDUP_BUCKETS - 1);
+    while (dedup_index[slot] != -1) {
+        int other = dedup_index[slot];
+        if (other == page_number) return;
+        if (!fs.page_table[other].is_used) break;  // Réutiliser une entrée de page libérée / 复用已释放页面的条目
+        slot = (slot + 1) & (DEDUP_BUCKETS - 1);
+    }
+    if (dedup_index[slot] == -1) dedup_index_entries++;
+    dedup_index[slot] = page_number;
+}
+
+/**
+ * @brief Reconstruire l'index à partir des pages utilisées
+ * @return Aucun
+ */
+static void dedup_index_rebuild() {
+    memset(dedup_index, -1, sizeof(dedup_index));
+    dedup_index_entries = 0;
+    for (int i = 0; i < MAX_FILES * MAX_FILE_PAGES; i++) {
+        if (fs.page_table[i].is_used && dedup_index_entries < DEDUP_BUCKETS * 3 / 4) {
+            dedup_index_insert(i, page_fingerprint(fs.page_table[i].data));
+        }
+    }
+}
+
+/**
+ * @brief Remplacer une page par une page identique déjà présente, si le mode dédup est actif
+ * @details La page doit être complète (octets au-delà de la fin du fichier mis à zéro)
+ * @param page_number Le numéro de la page qui vient d'être écrite
+ * @return Le numéro de page à utiliser : la page existante partagée, ou page_number
+ */
+int dedup_page(int page_number) {
+    if (!fs.dedup_enabled) return page_number;
+    lock_pages();
+
+    // Construire l'index au premier usage, le reconstruire quand il est trop plein / 首次使用时建立索引，过满时重建
+    if (dedup_index_entries < 0 || dedup_index_entries >= DEDUP_BUCKETS * 3 / 4) {
+        dedup_index_rebuild();
+    }
+
+    const char *data = fs.page_table[page_number].data;
+    uint64_t hash = page_fingerprint(data);
+    size_t slot = hash & (DEDUP_BUCKETS - 1);
+    while (dedup_index[slot] != -1) {
+        int other = dedup_index[slot];
+        // Vérifier l'empreinte puis les octets : l'index peut être périmé / 先比较指纹再比较字节：索引可能已过期
+        if (other != page_number && page_hash[other] == hash &&
+            fs.page_table[other].is_used &&
+            memcmp(fs.page_table[other].data, data, PAGE_SIZE) == 0) {
+            share_page(other);
+            free_page(page_number);
+            unlock_pages();
+            return other;
+        }
+        slot = (slot + 1) & (DEDUP_BUCKETS - 1);
+    }
+
+    dedup_index_insert(page_number, hash);
+    unlock_pages();
+    return page_number;
+}
+
+/**
+ * @brief Commande dedup : activer, désactiver ou afficher l'état de la déduplication
+ * @details L'activation déduplique aussi les pages complètes des fichiers existants
+ * @param arg "on", "off" ou NULL pour afficher l'état
+ * @return Aucun
+ */
+void dedup_command(const char *arg) {
+    load_superblock();
+
+    if (arg != NULL && strcmp(arg, "off") == 0) {
+        fs.dedup_enabled = 0;
+        save_superblock();
+        printf("Deduplication disabled\n");
+        return;
+    }
+
+    if (arg != NULL && strcmp(arg, "on") == 0) {
+        fs.dedup_enabled = 1;
+        dedup_index_entries = -1;
+
+        // Dédupliquer les pages complètes des fichiers existants / 对现有文件的完整页面进行去重
+        int merged = 0;
+        for (int i = 0; i < MAX_FILES; i++) {
+            Inode *inode = &fs.inodes[i];
+            if (inode->inode_number != i || inode->file_type != FILE_TYPE_REGULAR) continue;
+            size_t stored = inode->compressed ? inode->comp_end[(inode->size - 1) / PAGE_SIZE] : inode->size;
+            for (int j = 0; j < inode->page_count; j++) {
+                if ((size_t)(j + 1) * PAGE_SIZE > stored) break;
+                if (inode->pages[j] == PAGE_HOLE) continue;
+                int page = dedup_page(inode->pages[j]);
+                if (page != inode->pages[j]) {
+                    inode->pages[j] = page;
+                    merged++;
+                }
+            }
+        }
+        save_superblock();
+        printf("Deduplication enabled (%d pages merged)\n", merged);
+        return;
+    }
+
+    if (arg != NULL) {
+        command_error("Usage: dedup [on|off]\n");
+        return;
+    }
+
+    // Afficher l'état / 显示状态
+    int used = 0, shared = 0, references = 0;
+    for (int i = 0; i < MAX_FILES * MAX_FILE_PAGES; i++) {
+        if (!fs.page_table[i].is_used) continue;
+        used++;
+        int holders = fs.page_table[i].ref_count + fs.snapshot_pins[i];  // Fichiers et instantanés / 文件和快照
+        references += holders;
+        if (holders > 1) shared++;
+    }
+    printf("Deduplication: %s\n", fs.dedup_enabled ? "on" : "off");
+    printf("Pages used: %d, shared: %d, saved: %d\n", used, shared, references - used);
+}
@@ -10,40 +10,36 @@
 extern SuperBlock fs;
 
 /**
- * @brief Crée un nouveau répertoire
+ * @brief Créer un répertoire dans le superbloc en mémoire, sans affichage
  * @param[in] path Chemin complet du répertoire à créer
- * @return void
+ * @return Le numéro d'inode du répertoire, ou VFS_ERR_NOT_FOUND, VFS_ERR_PERMISSION, VFS_ERR_EXISTS, VFS_ERR_NO_SPACE
  */
-void create_directory(const char *path) {
-    load_superblock();
-    
+int add_directory(const char *path) {
     // Analyser le répertoire parent / 解析父目录
-    int parent_inode = get_parent_directory_inode(path);
-    if (parent_inode == -1) {
-        printf("Parent directory not found\n");
-        return;
-    }
+    int parent_inode = find_parent_directory_inode(path);
+    if (parent_inode == -1) return VFS_ERR_NOT_FOUND;
 
+    char dirname[MAX_FILENAME_LENGTH];
+    extract_last_path_component(path, dirname);
+    return add_directory_at(parent_inode, dirname);
+}
+
+/**
+ * @brief Créer un répertoire dans un répertoire parent déjà résolu, sans affichage
+ * @param[in] parent_inode Inode du répertoire parent
+ * @param[in] dirname Nom du nouveau répertoire
+ * @return Le numéro d'inode du répertoire, ou VFS_ERR_PERMISSION, VFS_ERR_EXISTS, VFS_ERR_NO_SPACE
+ */
+int add_directory_at(int parent_inode, const char *dirname) {
     // Vérifier les permissions de lecture et d'écriture / 检查是否有读写权限
-    if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) {
-        printf("Permission denied\n");
-        return;
-    }
+    if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) return VFS_ERR_PERMISSION;
 
     // Vérifier si le répertoire existe déjà / 检查目录是否已存在
-    char dirname[MAX_FILENAME_LENGTH];
-    extract_last_path_component(path, dirname);
-    if (find_in_directory(parent_inode, dirname) != -1) {
-        printf("Directory already exists\n");
-        return;
-    }
+    if (find_in_directory(parent_inode, dirname) != -1) return VFS_ERR_EXISTS;
 
     // Allouer un inode / 分配inode
     int new_inode = allocate_inode();
-    if (new_inode == -1) {
-        printf("No free inodes\n");
-        return;
-    }
+    if (new_inode == -1) return VFS_ERR_NO_SPACE;
 
     // Initialiser l'inode du répertoire / 初始化目录inode
     Inode *dir_inode = &fs.inodes[new_inode];
@@ -61,11 +57,65 @@ void create_directory(const char *path) {
     // Créer les entrées par défaut '.' et '..' / 创建默认的 . 和 .. 条目
     add_directory_entry(new_inode, ".", new_inode);
     add_directory_entry(new_inode, "..", parent_inode);
+    return new_inode;
+}
+
+/**
+ * @brief Crée un nouveau répertoire
+ * @param[in] path Chemin complet du répertoire à créer
+ * @return void
+ */
+void create_directory(const char *path) {
+    load_superblock();
+
+    switch (add_directory(path)) {
+        case VFS_ERR_NOT_FOUND:
+            get_parent_directory_inode(path);  // Afficher le chemin fautif / 输出出错的路径
+            command_error("Parent directory not found\n");
+            return;
+        case VFS_ERR_PERMISSION: command_error("Permission denied\n"); return;
+        case VFS_ERR_EXISTS: command_error("Directory already exists\n"); return;
+        case VFS_ERR_NO_SPACE: command_error("No free inodes\n"); return;
+    }
 
     save_superblock();
     printf("Directory created successfully\n");
 }
 
+/**
+ * @brief Créer des répertoires avec leurs parents manquants (mkdir -p)
+ * @details Un seul chargement et une seule sauvegarde ; les préfixes communs ne sont résolus qu'une fois
+ * @param[in] count Nombre de chemins
+ * @param[in] paths Chemins des répertoires
+ * @return void
+ */
+void create_directories(int count, char **paths) {
+    load_superblock();
+
+    DirectoryCache *cache = directory_cache_new();
+    if (cache == NULL) {
+        command_error("Out of memory\n");
+        return;
+    }
+    int created = 0;
+    for (int i = 0; i < count; i++) {
+        char dir_path[MAX_PATH_LENGTH];
+        if (absolute_path(paths[i], dir_path) != 0) {
+            command_error("%s: Path too long\n", paths[i]);
+            continue;
+        }
+        switch (resolve_directory_cached(cache, dir_path, &created)) {
+            case VFS_ERR_NOT_DIR: command_error("%s: Not a directory\n", paths[i]); break;
+            case VFS_ERR_PERMISSION: command_error("%s: Permission denied\n", paths[i]); break;
+            case VFS_ERR_NO_SPACE: command_error("%s: No free inodes\n", paths[i]); break;
+        }
+    }
+    directory_cache_free(cache);
+
+    if (created > 0) save_superblock();
+    printf("%d directories created\n", created);
+}
+
 
 
 
@@ -80,20 +130,20 @@ void delete_directory(const char *path) {
     
     // Vérifier s'il s'agit du répertoire racine / 检查是否为根目录
     if (strcmp(path, "/") == 0 || (strcmp(path, ".") == 0 && strcmp(current_path, "/") == 0)) {
-        printf("Cannot delete root directory\n");
+        command_error("Cannot delete root directory\n");
         return;
     }
 
     // Obtenir l'inode du répertoire / 获取目录的 inode
     int dir_inode = get_inode_from_path(path);
     if (dir_inode == -1) {
-        printf("Directory not found\n");
+        command_error("Directory not found\n");
         return;
     }
 
     // Vérifier s'il s'agit d'un répertoire / 检查是否为目录
     if (fs.inodes[dir_inode].file_type != FILE_TYPE_DIR) {
-        printf("Not a directory\n");
+        command_error("Not a directory\n");
         return;
     }
 
@@ -105,7 +155,7 @@ void delete_directory(const char *path) {
             entry_count++;
             // Si le nombre d'entrées dépasse 2 ('.' et '..'), le répertoire n'est pas vide / 如果条目数超过2（. 和 ..），说明目录非空
             if (entry_count > 2) {
-                printf("Directory not empty\n");
+                command_error("Directory not empty\n");
                 return;
             }
         }
@@ -114,13 +164,13 @@ void delete_directory(const char *path) {
     // Obtenir l'inode du répertoire parent / 获取父目录 inode
     int parent_inode = get_parent_directory_inode(path);
     if (parent_inode == -1) {
-        printf("Parent directory not found\n");
+        command_error("Parent directory not found\n");
         return;
     }
 
     // Vérifier les permissions de lecture et d'écriture / 检查是否有读写权限
     if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
@@ -200,47 +250,49 @@ void delete_directory_force(const char *path) {
     
     // 检查是否为根目录
     if (strcmp(path, "/") == 0 || (strcmp(path, ".") == 0 && strcmp(current_path, "/") == 0)) {
-        printf("Cannot delete root directory\n");
+        command_error("Cannot delete root directory\n");
         return;
     }
 
     // 获取目录的 inode
     int dir_inode = get_inode_from_path(path);
     if (dir_inode == -1) {
-        printf("Directory not found\n");
+        command_error("Directory not found\n");
         return;
     }
 
     // 检查是否为目录
     if (fs.inodes[dir_inode].file_type != FILE_TYPE_DIR) {
-        printf("Not a directory\n");
+        command_error("Not a directory\n");
         return;
     }
 
     // 获取父目录 inode
     int parent_inode = get_parent_directory_inode(path);
     if (parent_inode == -1) {
-        printf("Parent directory not found\n");
+        command_error("Parent directory not found\n");
         return;
     }
 
     // 检查权限
     if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
-    // 提示用户确认
-    printf("Warning: This will recursively delete '%s' and all its contents.\n", path);
-    printf("Are you sure you want to continue? (yes/no): ");
-    
-    char response[10];
-    fgets(response, sizeof(response), stdin);
-    response[strcspn(response, "\n")] = 0;  // 删除换行符
-    
-    if (strcmp(response, "yes") != 0) {
-        printf("Operation cancelled\n");
-        return;
+    // 提示用户确认（脚本模式下不询问）
+    if (!batch_mode) {
+        printf("Warning: This will recursively delete '%s' and all its contents.\n", path);
+        printf("Are you sure you want to continue? (yes/no): ");
+
+        char response[10];
+        if (fgets(response, sizeof(response), stdin) == NULL) response[0] = '\0';
+        response[strcspn(response, "\n")] = 0;  // 删除换行符
+
+        if (strcmp(response, "yes") != 0) {
+            printf("Operation cancelled\n");
+            return;
+        }
     }
 
     // 递归删除目录及其内容
@@ -280,7 +332,7 @@ void change_directory(const char *path) {
     // Obtenir l'inode du répertoire cible / 获取目标目录的 inode
     int dir_inode = get_inode_from_path(path);
     if (dir_inode == -1) {
-        printf("Directory not found\n");
+        command_error("Directory not found\n");
         return;
     }
 
@@ -290,7 +342,7 @@ void change_directory(const char *path) {
         const char *real_path = fs.inodes[dir_inode].data.symlink_path;
         dir_inode = resolve_symlink(dir_inode);
         if (dir_inode == -1) {
-            printf("Source directory does not exist or has been deleted\n");
+            command_error("Source directory does not exist or has been deleted\n");
             return;
         }
         // Utiliser le chemin réel du répertoire / 使用实际目录的路径
@@ -299,13 +351,13 @@ void change_directory(const char *path) {
 
     // Vérifier s'il s'agit d'un répertoire / 检查是否为目录
     if (fs.inodes[dir_inode].file_type != FILE_TYPE_DIR) {
-        printf("Not a directory\n");
+        command_error("Not a directory\n");
         return;
     }
 
     // Vérifier les permissions de lecture et d'exécution / 检查是否有读和执行权限
     if (!check_directory_permission(dir_inode, PERM_READ | PERM_EXECUTE)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
@@ -375,34 +427,34 @@ void move_directory(const char *source, const char *destination) {
     
     // Vérifier s'il s'agit du répertoire racine / 检查是否为根目录
     if (strcmp(source, "/") == 0 || (strcmp(source, ".") == 0 && strcmp(current_path, "/") == 0)) {
-        printf("Cannot move root directory\n");
+        command_error("Cannot move root directory\n");
         return;
     }
     
     // Obtenir l'inode du répertoire source / 获取源目录的 inode
     int src_inode = get_inode_from_path(source);
     if (src_inode == -1) {
-        printf("Source directory not found\n");
+        command_error("Source directory not found\n");
         return;
     }
     
     // Vérifier si la source est un répertoire / 检查源是否为目录
     if (fs.inodes[src_inode].file_type != FILE_TYPE_DIR) {
-        printf("Source is not a directory\n");
+        command_error("Source is not a directory\n");
         return;
     }
     
     // Obtenir l'inode du répertoire parent de destination / 获取目标父目录的 inode
     int dest_parent_inode = get_parent_directory_inode(destination);
     if (dest_parent_inode == -1) {
-        printf("Destination parent directory not found\n");
+        command_error("Destination parent directory not found\n");
         return;
     }
     
     // Obtenir l'inode du répertoire parent source / 获取源目录的父目录 inode
     int src_parent_inode = get_parent_directory_inode(source);
     if (src_parent_inode == -1) {
-        printf("Source parent directory not found\n");
+        command_error("Source parent directory not found\n");
         return;
     }
     
@@ -410,7 +462,7 @@ void move_directory(const char *source, const char *destination) {
     char dest_name[MAX_FILENAME_LENGTH];
     extract_last_path_component(destination, dest_name);
     if (find_in_directory(dest_parent_inode, dest_name) != -1) {
-        printf("Destination already exists\n");
+        command_error("Destination already exists\n");
         return;
     }
     
@@ -418,7 +470,7 @@ void move_directory(const char *source, const char *destination) {
     int temp_inode = dest_parent_inode;
     while (temp_inode != 0) { // 0 est l'inode du répertoire racine / 0 是根目录的 inode
         if (temp_inode == src_inode) {
-            printf("Cannot move a directory to its subdirectory\n");
+            command_error("Cannot move a directory to its subdirectory\n");
             return;
         }
         // Obtenir l'inode du répertoire parent / 获取父目录的 inode
@@ -477,12 +529,13 @@ int split_path(const char *path, char components[][MAX_FILENAME_LENGTH]) {
     strncpy(path_copy, path, MAX_PATH_LENGTH);
     
     int count = 0;
-    char *token = strtok(path_copy, "/");
+    char *saveptr;  // strtok_r : les lecteurs parallèles résolvent des chemins / strtok_r：并行读者也会解析路径
+    char *token = strtok_r(path_copy, "/", &saveptr);
     
     while (token != NULL && count < MAX_PATH_LENGTH) {
         strncpy(components[count], token, MAX_FILENAME_LENGTH);
         count++;
-        token = strtok(NULL, "/");
+        token = strtok_r(NULL, "/", &saveptr);
     }
     return count;
 }
@@ -532,26 +585,29 @@ void du_command(const char *path) {
     // 获取目标inode
     int target_inode = get_inode_from_path(path);
     if (target_inode == -1) {
-        printf("Path not found: %s\n", path);
+        command_error("Path not found: %s\n", path);
         return;
     }
 
     // 验证文件类型
     Inode *inode = &fs.inodes[target_inode];
     if (inode->file_type != FILE_TYPE_DIR) {
-        printf("Not a directory: %s\n", path);
+        command_error("Not a directory: %s\n", path);
         return;
     }
 
     // 验证读取权限
     if (!check_directory_permission(target_inode, PERM_READ)) {
-        printf("Permission denied: %s\n", path);
+        command_error("Permission denied: %s\n", path);
         return;
     }
 
     // 计算目录大小
     int total_size = get_dir_size(target_inode);
-    if (total_size == -1) return;
+    if (total_size < 0) {
+        command_error("%s: %s\n", path, vfs_strerror(total_size));
+        return;
+    }
 
     // 自动选择合适单位
     const char* units[] = {"B", "KB", "MB"};
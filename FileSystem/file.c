@@ -6,55 +6,251 @@
 */
 #include "filesystem.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 extern SuperBlock fs;
 
 /**
- * @brief Créer un nouveau fichier régulier dans le système de fichiers
- * @param path Le chemin où le fichier doit être créé
+ * @brief Obtenir les données d'une page d'un fichier
+ * @param inode L'inode du fichier
+ * @param page_index L'indice de la page dans le fichier
+ * @return Les données de la page (décompressées si besoin), les données stockées dans l'inode pour un petit
+ *         fichier, ou NULL si la page ne correspond pas à son checksum
+ */
+const char *file_page_data(const Inode *inode, int page_index) {
+    if (inode->compressed) {
+        return compressed_page_data(inode, page_index);
+    }
+    if (inode->page_count == 0) {
+        return inode->data.file.inline_data;
+    }
+    if (inode->pages[page_index] == PAGE_HOLE) {
+        static const char zero_page[PAGE_SIZE];
+        return zero_page;
+    }
+    if (!verify_page_checksum(inode->pages[page_index])) return NULL;
+    return fs.page_table[inode->pages[page_index]].data;
+}
+
+/**
+ * @brief Vérifier les checksums de toutes les pages d'un fichier avant de le lire
+ * @details Les pages déjà vérifiées depuis le chargement ne sont pas relues
+ * @param inode L'inode du fichier
+ * @return 0 si toutes les pages sont intègres, -1 sinon
+ */
+int verify_file_pages(const Inode *inode) {
+    for (int i = 0; i < inode->page_count; i++) {
+        if (inode->pages[i] != PAGE_HOLE && !verify_page_checksum(inode->pages[i])) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Rechercher à rebours la n-ième fin de ligne dans un tampon
+ * @param buf Le tampon à parcourir
+ * @param len La longueur du tampon
+ * @param count Nombre de fins de ligne encore recherchées, décrémenté à chaque '\n' trouvé
+ * @return La position de la fin de ligne qui amène count à 0, ou -1 si elle n'est pas dans le tampon
+ */
+static long find_newline_backward(const char *buf, size_t len, int *count) {
+    size_t pos = len;
+
+#ifdef __SSE2__
+    // Comparer 16 octets à la fois et compter les fins de ligne par masque / 每次比较16字节，用掩码统计换行符
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (pos >= 16) {
+        pos -= 16;
+        __m128i block = _mm_loadu_si128((const __m128i *)(buf + pos));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        if (mask == 0) continue;
+
+        int found = __builtin_popcount(mask);
+        if (found < *count) {
+            *count -= found;
+            continue;
+        }
+
+        // La cible est dans ce bloc : parcourir les bits du plus haut au plus bas / 目标在此块中：从高位到低位遍历
+        while (mask) {
+            int bit = 31 - __builtin_clz(mask);
+            if (--(*count) == 0) return (long)(pos + bit);
+            mask &= ~(1u << bit);
+        }
+    }
+#endif
+
+    while (pos > 0) {
+        pos--;
+        if (buf[pos] == '\n' && --(*count) == 0) return (long)pos;
+    }
+    return -1;
+}
+
+/**
+ * @brief Afficher une plage d'octets d'un fichier, page par page
+ * @param inode L'inode du fichier
+ * @param start Position de début (incluse)
+ * @param end Position de fin (exclue)
  * @return Aucun
  */
-void create_file(const char *path) {
-    load_superblock();
+static void print_file_range(const Inode *inode, size_t start, size_t end) {
+    while (start < end) {
+        size_t in_page = start % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page;
+        if (chunk > end - start) chunk = end - start;
+        const char *data = file_page_data(inode, start / PAGE_SIZE);
+        if (data == NULL) return;  // L'appelant a vérifié les pages / 调用者已校验页面
+        fwrite(data + in_page, 1, chunk, stdout);
+        start += chunk;
+    }
+}
 
-    // 新增：处理根目录路径的特殊情况
-    if (strcmp(path, "/") == 0) {
-        printf("Cannot create root directory\n");
-        return;
+/**
+ * @brief Copier une plage d'octets d'un fichier dans un tampon
+ * @param inode L'inode du fichier
+ * @param start Position de début (incluse)
+ * @param end Position de fin (exclue)
+ * @param buffer Le tampon de destination (au moins end - start octets)
+ * @return 0, ou -1 si une page lue ne correspond pas à son checksum
+ */
+int read_file_data(const Inode *inode, size_t start, size_t end, char *buffer) {
+    while (start < end) {
+        size_t in_page = start % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page;
+        if (chunk > end - start) chunk = end - start;
+        const char *data = file_page_data(inode, start / PAGE_SIZE);
+        if (data == NULL) return -1;
+        memcpy(buffer, data + in_page, chunk);
+        buffer += chunk;
+        start += chunk;
     }
-    
-    // Analyser le répertoire parent / 解析父目录
-    int parent_inode = get_parent_directory_inode(path);
-    if (parent_inode == -1) {
-        printf("Parent directory not found\n");
-        return;
+    return 0;
+}
+
+/**
+ * @brief Réinitialiser l'index des lignes pour un fichier vide
+ * @param index L'index à réinitialiser
+ * @return Aucun
+ */
+static void line_index_reset(LineIndex *index) {
+    memset(index, 0, sizeof(LineIndex));
+    index->valid = 1;
+    index->stride = LINE_INDEX_STRIDE;
+}
+
+/**
+ * @brief Ajouter à l'index les fins de ligne d'un bloc écrit dans le fichier
+ * @param index L'index à mettre à jour
+ * @param data Les données écrites
+ * @param len La longueur des données
+ * @param base La position des données dans le fichier
+ * @return Aucun
+ */
+static void line_index_feed(LineIndex *index, const char *data, size_t len, size_t base) {
+    if (!index->valid) return;
+
+    const char *end = data + len;
+    const char *p = data;
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+        p++;
+        index->line_count++;
+        if (index->line_count % index->stride != 0) continue;
+
+        // Index plein : doubler l'intervalle et garder une entrée sur deux / 索引已满：间隔加倍，每两个条目保留一个
+        if (index->entry_count == LINE_INDEX_SLOTS) {
+            for (int i = 0; i < LINE_INDEX_SLOTS / 2; i++) {
+                index->offsets[i] = index->offsets[2 * i + 1];
+            }
+            index->entry_count = LINE_INDEX_SLOTS / 2;
+            index->stride *= 2;
+            if (index->line_count % index->stride != 0) continue;
+        }
+        index->offsets[index->entry_count++] = (unsigned int)(base + (p - data));
     }
+}
 
-    // Vérifier les permissions de lecture et d'écriture du répertoire parent / 检查父目录的读写权限
-    if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) {
-        printf("Permission denied\n");
-        return;
+/**
+ * @brief Obtenir la position juste après la k-ième fin de ligne d'un fichier
+ * @details Saute directement à l'entrée d'index la plus proche puis parcourt au plus stride lignes
+ * @param inode L'inode du fichier
+ * @param k Le numéro de la fin de ligne (à partir de 1)
+ * @return La position après cette fin de ligne, 0 si k <= 0, ou la taille du fichier si elle n'existe pas
+ */
+static size_t line_offset(const Inode *inode, int k) {
+    if (k <= 0) return 0;
+
+    size_t pos = 0;
+    int seen = 0;
+    const LineIndex *index = &inode->data.file.line_index;
+    if (index->valid) {
+        if (k > index->line_count) return inode->size;
+        int entry = k / index->stride;
+        if (entry > index->entry_count) entry = index->entry_count;
+        if (entry > 0) {
+            pos = index->offsets[entry - 1];
+            seen = entry * index->stride;
+        }
     }
+    if (seen == k) return pos;
+
+    // Avancer jusqu'à la fin de ligne voulue / 向前扫描到目标换行符
+    while (pos < inode->size) {
+        size_t in_page = pos % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page;
+        if (chunk > inode->size - pos) chunk = inode->size - pos;
+        const char *data = file_page_data(inode, pos / PAGE_SIZE);
+        if (data == NULL) break;  // L'appelant a vérifié les pages / 调用者已校验页面
+        const char *base = data + in_page;
+        const char *p = base;
+        while ((p = memchr(p, '\n', chunk - (p - base))) != NULL) {
+            p++;
+            if (++seen == k) return pos + (p - base);
+        }
+        pos += chunk;
+    }
+    return inode->size;
+}
+
+/**
+ * @brief Créer un fichier régulier vide dans le superbloc en mémoire, sans affichage
+ * @param path Le chemin où le fichier doit être créé
+ * @return Le numéro d'inode du fichier, ou VFS_ERR_NOT_FOUND, VFS_ERR_PERMISSION, VFS_ERR_EXISTS, VFS_ERR_NO_SPACE
+ */
+int add_regular_file(const char *path) {
+    // Analyser le répertoire parent / 解析父目录
+    int parent_inode = find_parent_directory_inode(path);
+    if (parent_inode == -1) return VFS_ERR_NOT_FOUND;
 
-    // Vérifier si le fichier existe déjà / 检查文件是否已存在
     char filename[MAX_FILENAME_LENGTH];
     extract_last_path_component(path, filename);
-    if (find_in_directory(parent_inode, filename) != -1) {
-        printf("File already exists\n");
-        return;
-    }
+    return add_regular_file_at(parent_inode, filename);
+}
+
+/**
+ * @brief Créer un fichier régulier vide dans un répertoire parent déjà résolu, sans affichage
+ * @param parent_inode Le numéro d'inode du répertoire parent
+ * @param filename Le nom du fichier
+ * @return Le numéro d'inode du fichier, ou VFS_ERR_PERMISSION, VFS_ERR_EXISTS, VFS_ERR_NO_SPACE
+ */
+int add_regular_file_at(int parent_inode, const char *filename) {
+    // Vérifier les permissions de lecture et d'écriture du répertoire parent / 检查父目录的读写权限
+    if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) return VFS_ERR_PERMISSION;
+
+    // Vérifier si le fichier existe déjà / 检查文件是否已存在
+    if (find_in_directory(parent_inode, filename) != -1) return VFS_ERR_EXISTS;
 
     // Allouer un inode / 分配inode
     int new_inode = allocate_inode();
-    if (new_inode == -1) {
-        printf("No free inodes\n");
-        return;
-    }
+    if (new_inode == -1) return VFS_ERR_NO_SPACE;
 
     // Initialiser l'inode du fichier / 初始化文件inode
     Inode *file_inode = &fs.inodes[new_inode];
     file_inode->file_type = FILE_TYPE_REGULAR;  // Définir comme fichier régulier / 设置为普通文件
     file_inode->permissions = PERM_READ | PERM_WRITE;  // Permissions de lecture et d'écriture par défaut / 默认读写权限
     file_inode->size = 0;  // Taille initiale du fichier est 0 / 新文件大小为0
+    line_index_reset(&file_inode->data.file.line_index);
     //初始化文件时间
     time_t now = time(NULL);
     file_inode->ctime = now;
@@ -67,11 +263,68 @@ void create_file(const char *path) {
 
     //更新父目录大小（每个目录项固定为32字节）
     fs.inodes[parent_inode].size += sizeof(DirectoryEntry);
+    return new_inode;
+}
+
+/**
+ * @brief Créer un nouveau fichier régulier dans le système de fichiers
+ * @param path Le chemin où le fichier doit être créé
+ * @return Aucun
+ */
+void create_file(const char *path) {
+    load_superblock();
+
+    // 新增：处理根目录路径的特殊情况
+    if (strcmp(path, "/") == 0) {
+        command_error("Cannot create root directory\n");
+        return;
+    }
+
+    switch (add_regular_file(path)) {
+        case VFS_ERR_NOT_FOUND:
+            get_parent_directory_inode(path);  // Afficher le chemin fautif / 输出出错的路径
+            command_error("Parent directory not found\n");
+            return;
+        case VFS_ERR_PERMISSION: command_error("Permission denied\n"); return;
+        case VFS_ERR_EXISTS: command_error("File already exists\n"); return;
+        case VFS_ERR_NO_SPACE: command_error("No free inodes\n"); return;
+    }
 
     save_superblock();
     printf("File created successfully\n");
 }
 
+/**
+ * @brief Retirer un fichier régulier de son répertoire, et le libérer s'il n'a plus de lien dur
+ * @param parent_inode Le numéro d'inode du répertoire parent
+ * @param filename Le nom du fichier dans ce répertoire
+ * @param file_inode Le numéro d'inode du fichier
+ * @return 1 si le fichier est supprimé, 0 s'il garde d'autres liens durs, ou VFS_ERR_PERMISSION
+ */
+static int remove_regular_file(int parent_inode, const char *filename, int file_inode) {
+    // Vérifier les permissions de lecture et d'écriture du répertoire parent / 检查父目录的读写权限
+    if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) return VFS_ERR_PERMISSION;
+
+    Inode *inode = &fs.inodes[file_inode];
+
+    // Supprimer l'entrée du fichier du répertoire parent / 从父目录中删除文件条目
+    remove_directory_entry(filename, parent_inode);
+
+    // Libérer l'inode du fichier / 释放文件的 inode
+    // si le nombre de hard link est 0 /只有当硬链接数为0时才真正删除文件
+    if (inode->link_count == 0) {
+        // 释放文件占用的所有数据页
+        for (int i = 0; i < inode->page_count; i++) {
+            free_page(inode->pages[i]);
+        }
+        // 释放文件的 inode
+        free_inode(file_inode);
+        return 1;
+    }
+    inode->link_count--;
+    return 0;
+}
+
 /**
  * @brief Supprimer un fichier régulier du système de fichiers
  * @param path Le chemin du fichier à supprimer
@@ -83,55 +336,297 @@ void delete_file(const char *path) {
     // Obtenir l'inode du fichier / 获取文件的 inode
     int file_inode = get_inode_from_path(path);
     if (file_inode == -1) {
-        printf("File not found\n");
+        command_error("File not found\n");
         return;
     }
 
     // Vérifier s'il s'agit d'un fichier régulier / 检查是否为普通文件
     if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Not a regular file\n");
+        command_error("Not a regular file\n");
         return;
     }
 
     // Obtenir l'inode du répertoire parent / 获取父目录 inode
     int parent_inode = get_parent_directory_inode(path);
     if (parent_inode == -1) {
-        printf("Parent directory not found\n");
+        command_error("Parent directory not found\n");
         return;
     }
 
-    // Vérifier les permissions de lecture et d'écriture du répertoire parent / 检查父目录的读写权限
-    if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) {
-        printf("Permission denied\n");
+    char filename[MAX_FILENAME_LENGTH];
+    extract_last_path_component(path, filename);
+    int freed = remove_regular_file(parent_inode, filename, file_inode);
+    if (freed == VFS_ERR_PERMISSION) {
+        command_error("Permission denied\n");
         return;
     }
+    if (freed) printf("File deleted successfully\n");
+    else printf("File unlinked successfully (hard links remaining: %d)\n", fs.inodes[file_inode].link_count);
+    save_superblock();
+}
 
-    // Libérer toutes les pages de données utilisées par le fichier / 释放文件占用的所有数据页
-    Inode *inode = &fs.inodes[file_inode];
-    for (int i = 0; i < inode->page_count; i++) {
-        free_page(inode->pages[i]);
+/**
+ * @brief Résoudre le répertoire parent et le nom d'un chemin avec un cache de répertoires
+ * @param cache Le cache
+ * @param path Le chemin
+ * @param filename Reçoit le dernier composant
+ * @return Le numéro d'inode du parent, ou un code VFS_ERR_* négatif
+ */
+static int resolve_parent_cached(DirectoryCache *cache, const char *path, char *filename) {
+    char parent_path[MAX_PATH_LENGTH];
+    if (absolute_path(path, parent_path) != 0) return VFS_ERR_INVALID;
+    char *last_slash = strrchr(parent_path, '/');
+    if (last_slash == NULL || last_slash[1] == '\0') return VFS_ERR_INVALID;
+    snprintf(filename, MAX_FILENAME_LENGTH, "%s", last_slash + 1);
+    if (last_slash == parent_path) last_slash++;  // Parent racine / 父目录为根
+    *last_slash = '\0';
+    return resolve_directory_cached(cache, parent_path, NULL);
+}
+
+/**
+ * @brief Créer plusieurs fichiers réguliers vides (touch a b c)
+ * @details Un seul chargement et une seule sauvegarde ; chaque répertoire parent n'est résolu qu'une fois
+ * @param count Le nombre de chemins
+ * @param paths Les chemins
+ * @return Aucun
+ */
+void create_files(int count, char **paths) {
+    if (count == 1) {
+        create_file(paths[0]);
+        return;
     }
+    load_superblock();
 
-    // Supprimer l'entrée du fichier du répertoire parent / 从父目录中删除文件条目
-    char filename[MAX_FILENAME_LENGTH];
-    extract_last_path_component(path, filename);
-    remove_directory_entry(filename, parent_inode);
+    DirectoryCache *cache = directory_cache_new();
+    if (cache == NULL) {
+        command_error("Out of memory\n");
+        return;
+    }
+    int created = 0;
+    for (int i = 0; i < count; i++) {
+        char filename[MAX_FILENAME_LENGTH];
+        int status = resolve_parent_cached(cache, paths[i], filename);
+        if (status >= 0) status = add_regular_file_at(status, filename);
+        switch (status) {
+            case VFS_ERR_INVALID: command_error("%s: Cannot create root directory\n", paths[i]); break;
+            case VFS_ERR_NOT_FOUND: case VFS_ERR_NOT_DIR: command_error("%s: Parent directory not found\n", paths[i]); break;
+            case VFS_ERR_PERMISSION: command_error("%s: Permission denied\n", paths[i]); break;
+            case VFS_ERR_EXISTS: command_error("%s: File already exists\n", paths[i]); break;
+            case VFS_ERR_NO_SPACE: command_error("%s: No free inodes\n", paths[i]); break;
+            default: created++; break;
+        }
+    }
+    directory_cache_free(cache);
 
-   
-    // Libérer l'inode du fichier / 释放文件的 inode
-    // si le nombre de hard link est 0 /只有当硬链接数为0时才真正删除文件
-    if (inode->link_count == 0) {
-        // 释放文件占用的所有数据页
-        for (int i = 0; i < inode->page_count; i++) {
+    if (created > 0) save_superblock();
+    printf("%d files created\n", created);
+}
+
+/**
+ * @brief Supprimer plusieurs fichiers réguliers (rm a b c)
+ * @details Un seul chargement et une seule sauvegarde ; chaque répertoire parent n'est résolu qu'une fois
+ * @param count Le nombre de chemins
+ * @param paths Les chemins
+ * @return Aucun
+ */
+void delete_files(int count, char **paths) {
+    if (count == 1) {
+        delete_file(paths[0]);
+        return;
+    }
+    load_superblock();
+
+    DirectoryCache *cache = directory_cache_new();
+    if (cache == NULL) {
+        command_error("Out of memory\n");
+        return;
+    }
+    int deleted = 0;
+    for (int i = 0; i < count; i++) {
+        char filename[MAX_FILENAME_LENGTH];
+        int status = resolve_parent_cached(cache, paths[i], filename);
+        int file_inode = status >= 0 ? find_in_directory(status, filename) : -1;
+        if (status >= 0 && file_inode == -1) {
+            status = VFS_ERR_NOT_FOUND;
+        } else if (status >= 0 && fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
+            status = VFS_ERR_IS_DIR;
+        } else if (status >= 0) {
+            status = remove_regular_file(status, filename, file_inode);
+        }
+        switch (status) {
+            case VFS_ERR_IS_DIR: command_error("%s: Not a regular file\n", paths[i]); break;
+            case VFS_ERR_PERMISSION: command_error("%s: Permission denied\n", paths[i]); break;
+            default:
+                if (status < 0) command_error("%s: File not found\n", paths[i]);
+                else deleted++;
+                break;
+        }
+    }
+    directory_cache_free(cache);
+
+    if (deleted > 0) save_superblock();
+    printf("%d files deleted\n", deleted);
+}
+
+/**
+ * @brief Indiquer si un bloc de données ne contient que des zéros
+ * @param data Les données
+ * @param len La longueur des données
+ * @return 1 si tous les octets sont nuls, 0 sinon
+ */
+static int is_zero_block(const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (data[i]) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Enregistrer le contenu complet d'un fichier dans ses pages, ou dans l'inode s'il est petit
+ * @details Les pages existantes sont réutilisées en place et seules celles qui changent sont écrites ;
+ *          une page partagée n'est copiée que si son contenu change. En mode compression, le contenu
+ *          est compressé page par page s'il économise au moins une page. Sinon, une page entièrement
+ *          nulle devient un trou (PAGE_HOLE) qui n'occupe aucune page. La taille et l'index des lignes
+ *          sont laissés à l'appelant.
+ * @param inode L'inode du fichier
+ * @param content Le nouveau contenu
+ * @param content_len La longueur du contenu (au plus MAX_FILE_PAGES * PAGE_SIZE)
+ * @return 0 en cas de succès, -1 s'il n'y a plus de pages libres (le contenu précédent est conservé)
+ */
+int store_file_data(Inode *inode, const char *content, size_t content_len) {
+    // Choisir la représentation : dans l'inode, compressée ou brute / 选择存储方式：inode 内、压缩或原始
+    char stream[MAX_FILE_PAGES * PAGE_SIZE];
+    unsigned short comp_end[MAX_FILE_PAGES];
+    const char *stored = content;
+    size_t stored_len = content_len;
+    int compressed = 0;
+    if (content_len <= INLINE_DATA_SIZE) {
+        stored_len = 0;
+    } else if (fs.compress_enabled) {
+        size_t stream_len = compress_file_data(content, content_len, stream, comp_end);
+        if (stream_len > 0) {
+            stored = stream;
+            stored_len = stream_len;
+            compressed = 1;
+        }
+    }
+
+    // Calculer le nombre de pages nécessaires / 计算需要的页面数量
+    int pages_needed = (stored_len + PAGE_SIZE - 1) / PAGE_SIZE;
+    unsigned char hole[MAX_FILE_PAGES];
+    for (int i = 0; i < pages_needed; i++) {
+        size_t offset = (size_t)i * PAGE_SIZE;
+        size_t write_size = (stored_len - offset > PAGE_SIZE) ? PAGE_SIZE : stored_len - offset;
+        hole[i] = !compressed && is_zero_block(stored + offset, write_size);
+    }
+
+    // Les références des pages ne doivent pas changer entre le test de partage et l'écriture / 在共享检测与写入之间页面引用不能改变
+    lock_pages();
+
+    // Allouer d'abord les pages manquantes, pour ne rien modifier en cas d'échec / 先分配缺少的页面，失败时不修改原有内容
+    for (int i = inode->page_count; i < pages_needed; i++) {
+        int new_page = hole[i] ? PAGE_HOLE : allocate_page();
+        if (new_page == -1 && !hole[i]) {
+            for (int j = inode->page_count; j < i; j++) {
+                free_page(inode->pages[j]);
+            }
+            unlock_pages();
+            return -1;
+        }
+        inode->pages[i] = new_page;
+    }
+
+    // Copier les pages partagées dont le contenu va changer, remplir les trous / 复制内容将被修改的共享页面，填补空洞
+    for (int i = 0; i < inode->page_count && i < pages_needed; i++) {
+        size_t offset = (size_t)i * PAGE_SIZE;
+        size_t write_size = (stored_len - offset > PAGE_SIZE) ? PAGE_SIZE : stored_len - offset;
+        if (hole[i]) continue;
+        if (inode->pages[i] == PAGE_HOLE ||
+            (page_is_shared(inode->pages[i]) &&
+             memcmp(fs.page_table[inode->pages[i]].data, stored + offset, write_size) != 0)) {
+            int private_page = unshare_page(inode->pages[i]);
+            if (private_page == -1) {
+                for (int j = inode->page_count; j < pages_needed; j++) {
+                    free_page(inode->pages[j]);
+                }
+                unlock_pages();
+                return -1;
+            }
+            inode->pages[i] = private_page;
+        }
+    }
+
+    // Libérer seulement les pages en trop à la fin / 只释放末尾多余的页面
+    for (int i = pages_needed; i < inode->page_count; i++) {
+        free_page(inode->pages[i]);
+    }
+    inode->page_count = pages_needed;
+    if (pages_needed == 0) {
+        memcpy(inode->data.file.inline_data, content, content_len);
+    }
+
+    // Réécrire les pages en place, en sautant celles dont le contenu est identique / 原地重写页面，跳过内容相同的页面
+    size_t remaining = stored_len;
+    size_t offset = 0;
+    
+    for (int i = 0; i < pages_needed; i++) {
+        // Calculer la taille des données à écrire sur la page actuelle / 计算当前页面要写入的数据大小
+        size_t write_size = (remaining > PAGE_SIZE) ? PAGE_SIZE : remaining;
+        if (hole[i]) {
             free_page(inode->pages[i]);
+            inode->pages[i] = PAGE_HOLE;
+            remaining -= write_size;
+            offset += write_size;
+            continue;
         }
-        // 释放文件的 inode
-        free_inode(file_inode);
-        printf("File deleted successfully\n");
-    } else {
-        printf("File unlinked successfully (hard links remaining: %d)\n", inode->link_count);
+        char *page_data = fs.page_table[inode->pages[i]].data;
+        
+        // Écrire les données, la fin de page est remise à zéro / 写入数据，页面剩余部分清零
+        if (memcmp(page_data, stored + offset, write_size) != 0) {
+            memcpy(page_data, stored + offset, write_size);
+            memset(page_data + write_size, 0, PAGE_SIZE - write_size);
+            mark_page_dirty(inode->pages[i]);
+            inode->pages[i] = dedup_page(inode->pages[i]);
+        }
+        
+        remaining -= write_size;
+        offset += write_size;
     }
-    save_superblock();
+    unlock_pages();
+
+    inode->compressed = (unsigned char)compressed;
+    if (compressed) {
+        memcpy(inode->comp_end, comp_end, sizeof(comp_end));
+    }
+    page_cache_invalidate(inode->inode_number);
+    return 0;
+}
+
+/**
+ * @brief Remplacer le contenu d'un fichier désigné par un chemin, sans affichage
+ * @details Les liens symboliques sont suivis ; la date du répertoire parent est mise à jour
+ * @param path Le chemin du fichier
+ * @param content Le nouveau contenu
+ * @param content_len La longueur du contenu
+ * @return Le numéro d'inode du fichier, ou VFS_ERR_NOT_FOUND, VFS_ERR_INVALID (boucle de liens),
+ *         VFS_ERR_IS_DIR, VFS_ERR_PERMISSION, VFS_ERR_TOO_LARGE, VFS_ERR_NO_SPACE
+ */
+int replace_file_contents(const char *path, const char *content, size_t content_len) {
+    int file_inode = lookup_path(path);
+    if (file_inode < 0) return file_inode;
+    if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) return VFS_ERR_IS_DIR;
+
+    // Vérifier les permissions de lecture et d'écriture du fichier / 检查文件的读写权限
+    if (!check_file_permission(file_inode, PERM_READ | PERM_WRITE)) return VFS_ERR_PERMISSION;
+    if (content_len > (size_t)MAX_FILE_PAGES * PAGE_SIZE) return VFS_ERR_TOO_LARGE;
+
+    Inode *inode = &fs.inodes[file_inode];
+    if (set_file_contents(inode, content, content_len) != 0) return VFS_ERR_NO_SPACE;
+    int parent_inode = find_parent_directory_inode(path);
+    if (parent_inode != -1) {
+        fs.inodes[parent_inode].mtime = inode->mtime;
+    }
+    return file_inode;
 }
 
 /**
@@ -142,98 +637,456 @@ void delete_file(const char *path) {
  */
 void write_file(const char *path, const char *content) {
     load_superblock();
-    
-    // Obtenir l'inode du fichier / 获取文件的 inode
-    int file_inode = get_inode_from_path(path);
-    if (file_inode == -1) {
-        printf("File not found\n");
-        return;
+
+    switch (replace_file_contents(path, content, strlen(content))) {
+        case VFS_ERR_NOT_FOUND: command_error("File not found\n"); return;
+        case VFS_ERR_INVALID: command_error("Too many levels of symbolic links\n"); return;
+        case VFS_ERR_IS_DIR: command_error("Not a regular file\n"); return;
+        case VFS_ERR_PERMISSION: command_error("Permission denied\n"); return;
+        case VFS_ERR_TOO_LARGE: command_error("File size exceeds maximum limit\n"); return;
+        case VFS_ERR_NO_SPACE: command_error("No free pages available\n"); return;
     }
 
-    // Résoudre le lien symbolique / 解析符号链接
-    if (fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
-        file_inode = resolve_symlink(file_inode);
-        if (file_inode == -1) {
-            printf("Source file does not exist or has been deleted\n");
-            return;
+    save_superblock();
+    printf("File written successfully\n");
+}
+
+/**
+ * @brief Remplacer le contenu d'un fichier régulier en mémoire, sans charger ni sauvegarder le superbloc
+ * @details Met aussi à jour l'index des lignes, la taille et les dates du fichier
+ * @param inode L'inode du fichier
+ * @param content Le nouveau contenu
+ * @param content_len La longueur du contenu (au plus MAX_FILE_PAGES pages)
+ * @return 0 en cas de succès, -1 s'il n'y a plus de pages libres
+ */
+int set_file_contents(Inode *inode, const char *content, size_t content_len) {
+    if (store_file_data(inode, content, content_len) != 0) {
+        return -1;
+    }
+    line_index_reset(&inode->data.file.line_index);
+    line_index_feed(&inode->data.file.line_index, content, content_len, 0);
+
+    // Mettre à jour les informations du fichier / 更新文件信息
+    inode->size = content_len;
+    time_t now = time(NULL);
+    inode->mtime = now;
+    inode->atime = now;
+    return 0;
+}
+
+/**
+ * @brief Écrire une plage d'octets d'un fichier en mémoire, sans charger ni sauvegarder le superbloc
+ * @details Seules les pages couvertes par la plage sont copiées (si partagées) et modifiées ; une écriture
+ *          au-delà de la fin laisse des trous. Un petit fichier stocké dans l'inode ou un fichier compressé
+ *          est réenregistré en entier. Met à jour la taille, l'index des lignes et la date de modification.
+ * @param inode L'inode du fichier
+ * @param start La position de début de l'écriture
+ * @param content Les données
+ * @param content_len La longueur des données (start + content_len au plus MAX_FILE_PAGES pages)
+ * @return 0 en cas de succès, -1 s'il n'y a plus de pages libres (le fichier est inchangé),
+ *         -2 si une page partiellement réécrite ne correspond pas à son checksum
+ */
+int write_file_data(Inode *inode, size_t start, const char *content, size_t content_len) {
+    if (content_len == 0) return 0;
+    size_t end = start + content_len;
+    size_t new_size = end > inode->size ? end : inode->size;
+
+    if (inode->compressed || inode->page_count == 0) {
+        if (!inode->compressed && new_size <= INLINE_DATA_SIZE) {
+            // Rester dans l'inode : la fin au-delà de la taille n'est pas forcément nulle / 留在 inode 内：超出大小的部分不一定为零
+            if (start > inode->size) memset(inode->data.file.inline_data + inode->size, 0, start - inode->size);
+            memcpy(inode->data.file.inline_data + start, content, content_len);
+        } else {
+            // Reconstruire le contenu : au plus une page pour un fichier dans l'inode / 重建内容：inode 内的文件最多一页
+            char whole[MAX_FILE_PAGES * PAGE_SIZE];
+            if (read_file_data(inode, 0, inode->size, whole) != 0) return -2;
+            if (start > inode->size) memset(whole + inode->size, 0, start - inode->size);
+            memcpy(whole + start, content, content_len);
+            if (store_file_data(inode, whole, new_size) != 0) return -1;
         }
+    } else {
+        int first = start / PAGE_SIZE;
+        int last = (end - 1) / PAGE_SIZE;
+        int old_count = inode->page_count;
+
+        // Les pages partiellement réécrites gardent d'anciennes données : elles doivent être intègres / 部分重写的页面保留旧数据：它们必须完好
+        if (first < old_count && start % PAGE_SIZE != 0 && !verify_page_checksum(inode->pages[first])) return -2;
+        if (last < old_count && end % PAGE_SIZE != 0 && !verify_page_checksum(inode->pages[last])) return -2;
+
+        // Obtenir d'abord toutes les pages modifiables, pour ne rien changer en cas d'échec / 先获取所有可写页面，失败时不做任何修改
+        lock_pages();
+        for (int i = old_count; i <= last; i++) {
+            inode->pages[i] = PAGE_HOLE;
+        }
+        int was_hole[MAX_FILE_PAGES];
+        for (int i = first; i <= last; i++) {
+            was_hole[i] = inode->pages[i] == PAGE_HOLE;
+            int page = unshare_page(inode->pages[i]);
+            if (page == -1) {
+                // Une copie de page partagée a le même contenu : seules les nouvelles pages sont rendues / 共享页的副本内容相同：只归还新分配的页面
+                for (int j = first; j < i; j++) {
+                    if (was_hole[j]) {
+                        free_page(inode->pages[j]);
+                        inode->pages[j] = PAGE_HOLE;
+                    }
+                }
+                unlock_pages();
+                return -1;
+            }
+            inode->pages[i] = page;
+        }
+
+        // Copier les données ; une page qui n'est plus la dernière est dédupliquée / 复制数据；不再是最后一页的页面进行去重
+        for (int i = first; i <= last; i++) {
+            size_t page_start = (size_t)i * PAGE_SIZE;
+            size_t from = start > page_start ? start - page_start : 0;
+            size_t to = end < page_start + PAGE_SIZE ? end - page_start : PAGE_SIZE;
+            memcpy(fs.page_table[inode->pages[i]].data + from, content + (page_start + from - start), to - from);
+            mark_page_dirty(inode->pages[i]);
+            if (page_start + PAGE_SIZE <= new_size) {
+                inode->pages[i] = dedup_page(inode->pages[i]);
+            }
+        }
+        if (last + 1 > old_count) inode->page_count = last + 1;
+        unlock_pages();
     }
 
-    // Vérifier s'il s'agit d'un fichier régulier / 检查是否为普通文件
+    // Une écriture à la fin prolonge l'index ; une réécriture peut déplacer des fins de ligne / 末尾写入延长索引；覆盖写可能移动换行符
+    if (start >= inode->size) {
+        line_index_feed(&inode->data.file.line_index, content, content_len, start);
+    } else {
+        inode->data.file.line_index.valid = 0;
+    }
+    inode->size = new_size;
+    inode->mtime = time(NULL);
+    return 0;
+}
+
+/**
+ * @brief Changer la taille d'un fichier sans écrire de données
+ * @details Une extension est lue comme des zéros et ne consomme aucune page (trous) ;
+ *          une réduction libère les pages au-delà de la nouvelle fin
+ * @param path Le chemin du fichier
+ * @param size La nouvelle taille
+ * @return Aucun
+ */
+void truncate_file(const char *path, size_t size) {
+    load_superblock();
+
+    int file_inode = get_inode_from_path(path);
+    if (file_inode != -1 && fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
+        file_inode = resolve_symlink(file_inode);
+    }
+    if (file_inode == -1) {
+        command_error("File not found\n");
+        return;
+    }
     if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Not a regular file\n");
+        command_error("Not a regular file\n");
         return;
     }
-
-    // Vérifier les permissions de lecture et d'écriture du fichier / 检查文件的读写权限
-    if (!check_file_permission(file_inode, PERM_READ | PERM_WRITE)) {
-        printf("Permission denied\n");
+    if (!check_file_permission(file_inode, PERM_WRITE)) {
+        command_error("Permission denied\n");
+        return;
+    }
+    if (size > (size_t)MAX_FILE_PAGES * PAGE_SIZE) {
+        command_error("File size exceeds maximum limit\n");
         return;
     }
 
-    // Calculer le nombre de pages nécessaires / 计算需要的页面数量
-    size_t content_len = strlen(content);
-    int pages_needed = (content_len + PAGE_SIZE - 1) / PAGE_SIZE;
-    
-    // Libérer les pages existantes / 释放原有的页面
+    // Les pages nulles deviennent des trous dans store_file_data / 全零页面在 store_file_data 中成为空洞
     Inode *inode = &fs.inodes[file_inode];
+    char content[MAX_FILE_PAGES * PAGE_SIZE];
+    size_t kept = inode->size < size ? inode->size : size;
+    if (read_file_data(inode, 0, kept, content) != 0) {
+        command_error("File data is corrupted\n");
+        return;
+    }
+    memset(content + kept, 0, size - kept);
+    if (set_file_contents(inode, content, size) != 0) {
+        command_error("No free pages available\n");
+        return;
+    }
+
+    int allocated = 0;
     for (int i = 0; i < inode->page_count; i++) {
-        free_page(inode->pages[i]);
+        if (inode->pages[i] != PAGE_HOLE) allocated++;
     }
-    inode->page_count = 0;
+    save_superblock();
+    printf("File size set to %zu bytes (%d pages allocated)\n", size, allocated);
+}
 
-    // Allouer de nouvelles pages et écrire le contenu / 分配新的页面并写入内容
+// Tampon d'ajout d'un fichier ouvert en ajout / 以追加方式打开的文件的缓冲区
+typedef struct {
+    int in_use;                     // Emplacement utilisé / 是否被使用
+    int inode;                      // Inode du fichier / 文件的 inode
+    char path[MAX_PATH_LENGTH];     // Chemin utilisé pour ouvrir le fichier / 打开文件时使用的路径
+    size_t base_size;               // Taille du fichier sur le disque / 磁盘上的文件大小
+    size_t length;                  // Octets en attente / 待写回的字节数
+    time_t opened;                  // Date du premier ajout en attente / 第一次缓冲追加的时间
+    char data[APPEND_BUFFER_SIZE];  // Données en attente / 待写回的数据
+} AppendBuffer;
+
+static AppendBuffer append_buffers[APPEND_BUFFER_SLOTS];
+
+/**
+ * @brief Écrire des données à la fin d'un fichier, en complétant d'abord la dernière page
+ * @details Ne charge ni ne sauvegarde le superbloc ; l'appelant vérifie la taille maximale
+ * @param inode L'inode du fichier
+ * @param content Les données à ajouter
+ * @param content_len La longueur des données
+ * @return 0 en cas de succès, -1 s'il n'y a plus de pages libres ou si le fichier compressé est corrompu
+ */
+int append_data(Inode *inode, const char *content, size_t content_len) {
     size_t remaining = content_len;
     size_t offset = 0;
+
+    // Fichier compressé : ajouter au contenu décompressé puis tout recompresser / 压缩文件：在解压后的内容后追加，再整体重新压缩
+    if (inode->compressed) {
+        char whole[MAX_FILE_PAGES * PAGE_SIZE];
+        if (read_file_data(inode, 0, inode->size, whole) != 0) {
+            command_error("File data is corrupted\n");
+            return -1;
+        }
+        memcpy(whole + inode->size, content, content_len);
+        if (store_file_data(inode, whole, inode->size + content_len) != 0) {
+            command_error("No free pages available\n");
+            return -1;
+        }
+        line_index_feed(&inode->data.file.line_index, content, content_len, inode->size);
+        inode->size += content_len;
+        return 0;
+    }
+
+    // Le contenu est dans l'inode : y rester tant qu'il tient, sinon le déplacer dans une page / 内容在 inode 内：放得下就继续留在 inode，否则迁移到页面
+    if (inode->page_count == 0) {
+        if (inode->size + content_len <= INLINE_DATA_SIZE) {
+            memcpy(inode->data.file.inline_data + inode->size, content, content_len);
+            line_index_feed(&inode->data.file.line_index, content, content_len, inode->size);
+            inode->size += content_len;
+            return 0;
+        }
+        if (inode->size > 0) {
+            int first_page = allocate_page();
+            if (first_page == -1) {
+                command_error("No free pages available\n");
+                return -1;
+            }
+            memcpy(fs.page_table[first_page].data, inode->data.file.inline_data, inode->size);
+            // La page libre contient encore le chaînage et d'anciennes données / 空闲页仍含有链表指针和旧数据
+            memset(fs.page_table[first_page].data + inode->size, 0, PAGE_SIZE - inode->size);
+            inode->pages[0] = first_page;
+            inode->page_count = 1;
+        }
+    }
     
-    for (int i = 0; i < pages_needed; i++) {
+    // Fill existing page space / 填充现有页面剩余空间
+    size_t existing_used = inode->size % PAGE_SIZE;
+    if (inode->page_count > 0 && existing_used > 0) {
+        // La page complétée recevra un nouveau checksum : elle doit être intègre / 被补全的页面将获得新的校验和：它必须完好
+        if (!verify_page_checksum(inode->pages[inode->page_count - 1])) {
+            command_error("File data is corrupted\n");
+            return -1;
+        }
+        int last_page = unshare_page(inode->pages[inode->page_count - 1]);
+        if (last_page == -1) {
+            command_error("No free pages available\n");
+            return -1;
+        }
+        inode->pages[inode->page_count - 1] = last_page;
+        size_t free_space = PAGE_SIZE - existing_used;
+        size_t write_size = (remaining < free_space) ? remaining : free_space;
+        char* page_ptr = fs.page_table[last_page].data + existing_used;
+        
+        memcpy(page_ptr, content, write_size);
+        mark_page_dirty(last_page);
+        line_index_feed(&inode->data.file.line_index, content, write_size, inode->size);
+        offset += write_size;
+        remaining -= write_size;
+        inode->size += write_size;
+
+        // Page désormais complète : chercher une copie identique / 页面已写满：查找相同的页面
+        if (inode->size % PAGE_SIZE == 0) {
+            inode->pages[inode->page_count - 1] = dedup_page(last_page);
+        }
+    }
+
+    // Allocate new pages / 分配新页面
+    while (remaining > 0) {
         int new_page = allocate_page();
         if (new_page == -1) {
-            printf("No free pages available\n");
-            save_superblock();
-            return;
+            command_error("No free pages available\n");
+            return -1;
         }
         
-        inode->pages[i] = new_page;
-        inode->page_count++;
-        
-        // Calculer la taille des données à écrire sur la page actuelle / 计算当前页面要写入的数据大小
+        inode->pages[inode->page_count++] = new_page;
         size_t write_size = (remaining > PAGE_SIZE) ? PAGE_SIZE : remaining;
         
-        // Écrire les données / 写入数据
         memcpy(fs.page_table[new_page].data, content + offset, write_size);
-        
-        remaining -= write_size;
+        memset(fs.page_table[new_page].data + write_size, 0, PAGE_SIZE - write_size);
+        line_index_feed(&inode->data.file.line_index, content + offset, write_size, inode->size);
         offset += write_size;
+        remaining -= write_size;
+        inode->size += write_size;
+
+        if (write_size == PAGE_SIZE) {
+            inode->pages[inode->page_count - 1] = dedup_page(new_page);
+        }
     }
+    return 0;
+}
 
-    // Mettre à jour les informations du fichier / 更新文件信息
-    inode->size = content_len;
+/**
+ * @brief Mettre à jour les temps du fichier et de son répertoire parent après un ajout
+ * @param inode L'inode du fichier
+ * @param path Le chemin du fichier
+ * @return Aucun
+ */
+static void touch_after_append(Inode *inode, const char *path) {
+    // Update metadata / 更新元数据
     time_t now = time(NULL);
     inode->mtime = now;
     inode->atime = now;
-    int dest_parent_inode = get_parent_directory_inode(path);
-    if (dest_parent_inode == -1) {
-        fs.inodes[dest_parent_inode].mtime = now;
-    }
     
+    // Update parent directory / 更新父目录
+    int parent_inode = get_parent_directory_inode(path);
+    if (parent_inode != -1) {
+        fs.inodes[parent_inode].mtime = now;
+    }
+}
+
+/**
+ * @brief Écrire le contenu d'un tampon d'ajout dans le superbloc en mémoire
+ * @param buffer Le tampon à écrire, vidé en cas de succès
+ * @return 0 en cas de succès, -1 si le fichier n'existe plus ou si les pages manquent
+ */
+static int apply_append_buffer(AppendBuffer *buffer) {
+    Inode *inode = &fs.inodes[buffer->inode];
+    if (inode->inode_number != buffer->inode || inode->file_type != FILE_TYPE_REGULAR) {
+        command_error("Buffered append to %s lost: file no longer exists\n", buffer->path);
+        return -1;
+    }
+    if (buffer->length == 0) return 0;
+
+    int result = append_data(inode, buffer->data, buffer->length);
+    touch_after_append(inode, buffer->path);
+    buffer->base_size = inode->size;
+    buffer->length = 0;
+    buffer->opened = time(NULL);
+    return result;
+}
+
+/**
+ * @brief Écrire les ajouts en attente et fermer leurs tampons
+ * @details Tous les tampons expirés sont écrits avec un seul chargement et une seule sauvegarde
+ * @param force 1 pour écrire tous les tampons, 0 pour seulement ceux plus vieux que APPEND_FLUSH_SECONDS
+ * @return Aucun
+ */
+void sync_append_buffers(int force) {
+    time_t now = time(NULL);
+    int pending = 0;
+    for (int i = 0; i < APPEND_BUFFER_SLOTS; i++) {
+        if (append_buffers[i].in_use &&
+            (force || now - append_buffers[i].opened >= APPEND_FLUSH_SECONDS)) {
+            pending = 1;
+        }
+    }
+    if (!pending) return;
+
+    acquire_disk_writer();
+    load_superblock();
+    for (int i = 0; i < APPEND_BUFFER_SLOTS; i++) {
+        if (append_buffers[i].in_use &&
+            (force || now - append_buffers[i].opened >= APPEND_FLUSH_SECONDS)) {
+            apply_append_buffer(&append_buffers[i]);
+            append_buffers[i].in_use = 0;
+        }
+    }
     save_superblock();
-    printf("File written successfully\n");
+}
+
+/**
+ * @brief Rechercher le tampon d'ajout ouvert pour un chemin ou un inode
+ * @param path Le chemin du fichier, ou NULL pour rechercher par inode
+ * @param inode Le numéro d'inode, utilisé si path vaut NULL
+ * @return Le tampon trouvé, ou NULL
+ */
+static AppendBuffer *find_append_buffer(const char *path, int inode) {
+    for (int i = 0; i < APPEND_BUFFER_SLOTS; i++) {
+        if (!append_buffers[i].in_use) continue;
+        if (path ? strcmp(append_buffers[i].path, path) == 0 : append_buffers[i].inode == inode) {
+            return &append_buffers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Ouvrir un tampon d'ajout pour un fichier, en fermant le plus ancien si tous sont pris
+ * @param path Le chemin du fichier
+ * @param file_inode Le numéro d'inode du fichier
+ * @return Le tampon ouvert
+ */
+static AppendBuffer *open_append_buffer(const char *path, int file_inode) {
+    AppendBuffer *buffer = NULL;
+    for (int i = 0; i < APPEND_BUFFER_SLOTS; i++) {
+        if (!append_buffers[i].in_use) {
+            buffer = &append_buffers[i];
+            break;
+        }
+        if (buffer == NULL || append_buffers[i].opened < buffer->opened) {
+            buffer = &append_buffers[i];
+        }
+    }
+
+    // Fermer le tampon le plus ancien / 关闭最旧的缓冲区
+    if (buffer->in_use) {
+        apply_append_buffer(buffer);
+        save_superblock();
+    }
+
+    buffer->in_use = 1;
+    buffer->inode = file_inode;
+    strncpy(buffer->path, path, MAX_PATH_LENGTH - 1);
+    buffer->path[MAX_PATH_LENGTH - 1] = '\0';
+    buffer->base_size = fs.inodes[file_inode].size;
+    buffer->length = 0;
+    buffer->opened = time(NULL);
+    return buffer;
 }
 
 /**
  * @brief Ajouter du contenu à la fin d'un fichier
+ * @details Les ajouts successifs sont accumulés dans un tampon par fichier, écrit quand il est plein,
+ *          après APPEND_FLUSH_SECONDS, ou par sync_append_buffers()
  * @param path Le chemin du fichier à modifier
  * @param content Le contenu à ajouter au fichier
  * @return Aucun
  */
 void append_to_file(const char *path, const char *content) {
+    size_t content_len = strlen(content);
+
+    // Fichier déjà ouvert en ajout : accumuler sans relire le disque / 文件已打开追加：直接累积，无需读取磁盘
+    AppendBuffer *buffer = find_append_buffer(path, -1);
+    if (buffer != NULL) {
+        if (buffer->base_size + buffer->length + content_len > (size_t)MAX_FILE_PAGES * PAGE_SIZE) {
+            command_error("File size exceeds maximum limit\n");
+            return;
+        }
+        if (content_len <= APPEND_BUFFER_SIZE - buffer->length) {
+            memcpy(buffer->data + buffer->length, content, content_len);
+            buffer->length += content_len;
+            printf("Content appended successfully\n");
+            return;
+        }
+    }
+
     load_superblock();
     
     // Get file inode / 获取文件inode
     int file_inode = get_inode_from_path(path);
     if (file_inode == -1) {
-        printf("File not found\n");
+        command_error("File not found\n");
         return;
     }
 
@@ -241,82 +1094,60 @@ void append_to_file(const char *path, const char *content) {
     if (fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
         file_inode = resolve_symlink(file_inode);
         if (file_inode == -1) {
-            printf("Source file does not exist or has been deleted\n");
+            command_error("Source file does not exist or has been deleted\n");
             return;
         }
     }
 
     // Check file type / 检查文件类型
     if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Not a regular file\n");
+        command_error("Not a regular file\n");
         return;
     }
 
     // Verify write permission / 检查写权限
     if (!check_file_permission(file_inode, PERM_WRITE)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
+    // Écrire d'abord les ajouts déjà en attente pour ce fichier / 先写回该文件已缓冲的追加内容
     Inode *inode = &fs.inodes[file_inode];
-    size_t content_len = strlen(content);
+    if (buffer == NULL) {
+        buffer = find_append_buffer(NULL, file_inode);
+    }
+    if (buffer != NULL) {
+        apply_append_buffer(buffer);
+        buffer->in_use = 0;
+    }
+
     size_t total_needed = inode->size + content_len;
     int total_pages_needed = (total_needed + PAGE_SIZE - 1) / PAGE_SIZE;
 
     // Check max pages limit / 检查最大页数限制
     if (total_pages_needed > MAX_FILE_PAGES) {
-        printf("File size exceeds maximum limit\n");
+        command_error("File size exceeds maximum limit\n");
+        save_superblock();
         return;
     }
 
-    size_t remaining = content_len;
-    size_t offset = 0;
-    
-    // Fill existing page space / 填充现有页面剩余空间
-    if (inode->page_count > 0) {
-        int last_page = inode->pages[inode->page_count - 1];
-        size_t existing_used = inode->size % PAGE_SIZE;
-        size_t free_space = PAGE_SIZE - existing_used;
-        
-        if (free_space > 0) {
-            size_t write_size = (remaining < free_space) ? remaining : free_space;
-            char* page_ptr = fs.page_table[last_page].data + existing_used;
-            
-            memcpy(page_ptr, content, write_size);
-            offset += write_size;
-            remaining -= write_size;
-            inode->size += write_size;
-        }
-    }
-
-    // Allocate new pages / 分配新页面
-    while (remaining > 0) {
-        int new_page = allocate_page();
-        if (new_page == -1) {
-            printf("No free pages available\n");
+    // Petit ajout : le garder dans un tampon plutôt que de sauvegarder tout de suite / 小的追加：先放入缓冲区，不立即保存
+    if (content_len <= APPEND_BUFFER_SIZE) {
+        if (buffer != NULL) {
             save_superblock();
-            return;
         }
-        
-        inode->pages[inode->page_count++] = new_page;
-        size_t write_size = (remaining > PAGE_SIZE) ? PAGE_SIZE : remaining;
-        
-        memcpy(fs.page_table[new_page].data, content + offset, write_size);
-        offset += write_size;
-        remaining -= write_size;
-        inode->size += write_size;
+        buffer = open_append_buffer(path, file_inode);
+        memcpy(buffer->data, content, content_len);
+        buffer->length = content_len;
+        printf("Content appended successfully\n");
+        return;
     }
 
-    // Update metadata / 更新元数据
-    time_t now = time(NULL);
-    inode->mtime = now;
-    inode->atime = now;
-    
-    // Update parent directory / 更新父目录
-    int parent_inode = get_parent_directory_inode(path);
-    if (parent_inode != -1) {
-        fs.inodes[parent_inode].mtime = now;
+    if (append_data(inode, content, content_len) != 0) {
+        save_superblock();
+        return;
     }
+    touch_after_append(inode, path);
     
     save_superblock();
     printf("Content appended successfully\n");
@@ -333,7 +1164,7 @@ void open_file(const char *path) {
     // Obtenir l'inode du fichier / 获取文件的 inode
     int file_inode = get_inode_from_path(path);
     if (file_inode == -1) {
-        printf("File not found\n");
+        command_error("File not found\n");
         return;
     }
 
@@ -341,45 +1172,34 @@ void open_file(const char *path) {
     if (fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
         file_inode = resolve_symlink(file_inode);
         if (file_inode == -1) {
-            printf("Source file does not exist or has been deleted\n");
+            command_error("Source file does not exist or has been deleted\n");
             return;
         }
     }
 
     // Vérifier les permissions de lecture / 检查文件的读权限
     if (!check_file_permission(file_inode, PERM_READ)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
     // Vérifier s'il s'agit d'un fichier régulier / 检查是否为普通文件
     if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Not a regular file\n");
+        command_error("Not a regular file\n");
         return;
     }
 
-    Inode *inode = &fs.inodes[file_inode];
-    
     // Lire et afficher le contenu du fichier / 读取并打印文件内容
-    char buffer[PAGE_SIZE];
-    size_t remaining = inode->size;
-
-    for (int i = 0; i < inode->page_count && remaining > 0; i++) {
-        size_t read_size = (remaining > PAGE_SIZE) ? PAGE_SIZE : remaining;
-        
-        // Lire les données de la page / 读取页面数据
-        memcpy(buffer, fs.page_table[inode->pages[i]].data, read_size);
-        buffer[read_size] = '\0';
-        
-        // Afficher le contenu / 打印内容
-        printf("%s", buffer);
-        
-        remaining -= read_size;
+    Inode *inode = &fs.inodes[file_inode];
+    if (verify_file_pages(inode) != 0) {
+        command_error("File data is corrupted\n");
+        return;
     }
+    print_file_range(inode, 0, inode->size);
     printf("\n");
 
     // Mettre à jour le temps d'accès / 更新访问时间
-    inode->atime = time(NULL);
+    touch_access_time(inode);
     
     save_superblock();
 }
@@ -396,7 +1216,7 @@ void head_file(const char *path, int lines) {
     // Obtenir l'inode du fichier / 获取文件的 inode
     int file_inode = get_inode_from_path(path);
     if (file_inode == -1) {
-        printf("File not found\n");
+        command_error("File not found\n");
         return;
     }
 
@@ -404,48 +1224,34 @@ void head_file(const char *path, int lines) {
     if (fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
         file_inode = resolve_symlink(file_inode);
         if (file_inode == -1) {
-            printf("Source file does not exist or has been deleted\n");
+            command_error("Source file does not exist or has been deleted\n");
             return;
         }
     }
 
     // Vérifier s'il s'agit d'un fichier régulier / 检查是否为普通文件
     if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Not a regular file\n");
+        command_error("Not a regular file\n");
         return;
     }
 
     // Vérifier les permissions de lecture / 检查文件的读权限
     if (!check_file_permission(file_inode, PERM_READ)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
+    // Trouver la fin de la n-ième ligne via l'index, puis afficher jusqu'à elle / 通过索引找到第 n 行末尾，然后输出到该位置
     Inode *inode = &fs.inodes[file_inode];
-    char buffer[PAGE_SIZE];
-    size_t remaining = inode->size;
-    int line_count = 0;
-
-    // Lire et afficher page par page jusqu'à atteindre le nombre de lignes spécifié / 逐页读取并打印，直到达到指定行数
-    for (int i = 0; i < inode->page_count && remaining > 0 && line_count < lines; i++) {
-        size_t read_size = (remaining > PAGE_SIZE) ? PAGE_SIZE : remaining;
-        memcpy(buffer, fs.page_table[inode->pages[i]].data, read_size);
-        buffer[read_size] = '\0';
-        
-        // Traiter caractère par caractère et compter les lignes / 逐字符处理，计数行数
-        for (size_t j = 0; j < read_size && line_count < lines; j++) {
-            putchar(buffer[j]);
-            if (buffer[j] == '\n') {
-                line_count++;
-            }
-        }
-        
-        remaining -= read_size;
+    if (verify_file_pages(inode) != 0) {
+        command_error("File data is corrupted\n");
+        return;
     }
+    print_file_range(inode, 0, line_offset(inode, lines));
     printf("\n");
 
     // Mettre à jour le temps d'accès / 更新访问时间
-    inode->atime = time(NULL);
+    touch_access_time(inode);
     save_superblock();
 }
 
@@ -461,7 +1267,7 @@ void tail_file(const char *path, int lines) {
     // Obtenir l'inode du fichier / 获取文件的 inode
     int file_inode = get_inode_from_path(path);
     if (file_inode == -1) {
-        printf("File not found\n");
+        command_error("File not found\n");
         return;
     }
 
@@ -469,67 +1275,123 @@ void tail_file(const char *path, int lines) {
     if (fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
         file_inode = resolve_symlink(file_inode);
         if (file_inode == -1) {
-            printf("Source file does not exist or has been deleted\n");
+            command_error("Source file does not exist or has been deleted\n");
             return;
         }
     }
 
     // Vérifier s'il s'agit d'un fichier régulier / 检查是否为普通文件
     if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Not a regular file\n");
+        command_error("Not a regular file\n");
         return;
     }
 
     // Vérifier les permissions de lecture / 检查文件的读权限
     if (!check_file_permission(file_inode, PERM_READ)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
     Inode *inode = &fs.inodes[file_inode];
-    char buffer[PAGE_SIZE];
-    
-    // Premier passage : compter le nombre total de lignes / 第一次遍历：计算总行数
-    size_t remaining = inode->size;
-    int total_lines = 0;
-    
-    for (int i = 0; i < inode->page_count && remaining > 0; i++) {
-        size_t read_size = (remaining > PAGE_SIZE) ? PAGE_SIZE : remaining;
-        memcpy(buffer, fs.page_table[inode->pages[i]].data, read_size);
-        
-        for (size_t j = 0; j < read_size; j++) {
-            if (buffer[j] == '\n') {
-                total_lines++;
+    size_t start = 0;
+    if (verify_file_pages(inode) != 0) {
+        command_error("File data is corrupted\n");
+        return;
+    }
+
+    if (lines > 0 && inode->size > 0) {
+        // Ignorer le saut de ligne final, il termine la dernière ligne / 忽略末尾换行符，它只是最后一行的结束
+        size_t scan_end = inode->size;
+        if (file_page_data(inode, (scan_end - 1) / PAGE_SIZE)[(scan_end - 1) % PAGE_SIZE] == '\n') {
+            scan_end--;
+        }
+
+        const LineIndex *index = &inode->data.file.line_index;
+        if (index->valid) {
+            // Sauter directement au début de la ligne voulue grâce à l'index / 利用索引直接跳到目标行开头
+            int total_lines = index->line_count + (scan_end == inode->size ? 1 : 0);
+            start = line_offset(inode, total_lines - lines);
+        } else {
+            // Parcourir les pages à rebours jusqu'à trouver n fins de ligne / 从最后一页向前扫描，直到找到 n 个换行符
+            int wanted = lines;
+            for (int i = (int)((scan_end + PAGE_SIZE - 1) / PAGE_SIZE) - 1; i >= 0; i--) {
+                size_t page_start = (size_t)i * PAGE_SIZE;
+                size_t len = (scan_end - page_start > PAGE_SIZE) ? PAGE_SIZE : scan_end - page_start;
+                long pos = find_newline_backward(file_page_data(inode, i), len, &wanted);
+                if (pos >= 0) {
+                    start = page_start + (size_t)pos + 1;
+                    break;
+                }
             }
         }
-        remaining -= read_size;
+    } else {
+        start = inode->size;
     }
+
+    // Afficher à partir du point trouvé / 从找到的位置开始输出
+    print_file_range(inode, start, inode->size);
+    printf("\n");
+
+    // Mettre à jour le temps d'accès / 更新访问时间
+    touch_access_time(inode);
+    save_superblock();
+}
+
+/**
+ * @brief Afficher une plage de lignes d'un fichier
+ * @param path Le chemin du fichier à afficher
+ * @param first Le numéro de la première ligne à afficher (à partir de 1)
+ * @param last Le numéro de la dernière ligne à afficher (incluse)
+ * @return Aucun
+ */
+void print_lines(const char *path, int first, int last) {
+    load_superblock();
     
-    // Deuxième passage : afficher les dernières lignes / 第二次遍历：打印最后几行
-    remaining = inode->size;
-    int current_line = 0;
-    int start_line = total_lines - lines;
-    if (start_line < 0) start_line = 0;
-    
-    for (int i = 0; i < inode->page_count && remaining > 0; i++) {
-        size_t read_size = (remaining > PAGE_SIZE) ? PAGE_SIZE : remaining;
-        memcpy(buffer, fs.page_table[inode->pages[i]].data, read_size);
-        buffer[read_size] = '\0';
-        
-        for (size_t j = 0; j < read_size; j++) {
-            if (current_line >= start_line) {
-                putchar(buffer[j]);
-            }
-            if (buffer[j] == '\n') {
-                current_line++;
-            }
+    // Obtenir l'inode du fichier / 获取文件的 inode
+    int file_inode = get_inode_from_path(path);
+    if (file_inode == -1) {
+        command_error("File not found\n");
+        return;
+    }
+
+    // Résoudre le lien symbolique / 解析符号链接
+    if (fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
+        file_inode = resolve_symlink(file_inode);
+        if (file_inode == -1) {
+            command_error("Source file does not exist or has been deleted\n");
+            return;
         }
-        remaining -= read_size;
     }
+
+    // Vérifier s'il s'agit d'un fichier régulier / 检查是否为普通文件
+    if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
+        command_error("Not a regular file\n");
+        return;
+    }
+
+    // Vérifier les permissions de lecture / 检查文件的读权限
+    if (!check_file_permission(file_inode, PERM_READ)) {
+        command_error("Permission denied\n");
+        return;
+    }
+
+    if (first < 1) first = 1;
+    if (last < first) {
+        command_error("Invalid line range\n");
+        return;
+    }
+
+    // La ligne first commence après la (first-1)-ième fin de ligne / 第 first 行从第 first-1 个换行符之后开始
+    Inode *inode = &fs.inodes[file_inode];
+    if (verify_file_pages(inode) != 0) {
+        command_error("File data is corrupted\n");
+        return;
+    }
+    print_file_range(inode, line_offset(inode, first - 1), line_offset(inode, last));
     printf("\n");
 
     // Mettre à jour le temps d'accès / 更新访问时间
-    inode->atime = time(NULL);
+    touch_access_time(inode);
     save_superblock();
 }
 
@@ -545,19 +1407,19 @@ void move_file(const char *source, const char *destination) {
     // Obtenir l'inode du fichier source / 获取源文件的 inode
     int src_inode = get_inode_from_path(source);
     if (src_inode == -1) {
-        printf("Source file not found\n");
+        command_error("Source file not found\n");
         return;
     }
 
     // Vérifier s'il s'agit d'un fichier régulier / 检查是否为普通文件
     if (fs.inodes[src_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Source is not a regular file\n");
+        command_error("Source is not a regular file\n");
         return;
     }
 
     // Vérifier les permissions de lecture / 检查文件的读权限
     if (!check_file_permission(src_inode, PERM_READ)) {
-        printf("Permission denied: cannot read source file\n");
+        command_error("Permission denied: cannot read source file\n");
         return;
     }
 
@@ -586,14 +1448,14 @@ void move_file(const char *source, const char *destination) {
     
 
     if (dest_parent_inode == -1) {
-        printf("Destination parent directory not found\n");
+        command_error("Destination parent directory not found\n");
         return;
     }
 
     // Obtenir l'inode du répertoire parent source / 获取源文件的父目录 inode
     int src_parent_inode = get_parent_directory_inode(source);
     if (src_parent_inode == -1) {
-        printf("Source parent directory not found\n");
+        command_error("Source parent directory not found\n");
         return;
     }
 
@@ -602,17 +1464,17 @@ void move_file(const char *source, const char *destination) {
     if (is_rename) {
         // 重命名操作只需要检查源目录的写权限
         if (!check_directory_permission(src_parent_inode, PERM_WRITE)) {
-            printf("Permission denied: cannot modify source directory\n");
+            command_error("Permission denied: cannot modify source directory\n");
             return;
         }
     }else {
         // 移动操作需要检查源目录和目标目录的写权限
         if (!check_directory_permission(src_parent_inode, PERM_WRITE)) {
-            printf("Permission denied: cannot modify source directory\n");
+            command_error("Permission denied: cannot modify source directory\n");
             return;
         }
         if (!check_directory_permission(dest_parent_inode, PERM_WRITE)) {
-            printf("Permission denied: cannot modify destination directory\n");
+            command_error("Permission denied: cannot modify destination directory\n");
             return;
         }
     }
@@ -621,7 +1483,7 @@ void move_file(const char *source, const char *destination) {
 
     // Vérifier si le fichier de destination existe déjà / 检查目标文件是否已存在
     if (find_in_directory(dest_parent_inode, dest_name) != -1) {
-        printf("Destination already exists\n");
+        command_error("Destination already exists\n");
         return;
     }
 
@@ -653,19 +1515,19 @@ void copy_file(const char *source, const char *destination) {
     // Obtenir l'inode du fichier source / 获取源文件的 inode
     int src_inode = get_inode_from_path(source);
     if (src_inode == -1) {
-        printf("Source file not found\n");
+        command_error("Source file not found\n");
         return;
     }
 
     // Vérifier s'il s'agit d'un fichier régulier / 检查是否为普通文件
     if (fs.inodes[src_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Source is not a regular file\n");
+        command_error("Source is not a regular file\n");
         return;
     }
 
     // Vérifier les permissions de lecture du fichier source / 检查源文件的读权限
     if (!check_file_permission(src_inode, PERM_READ)) {
-        printf("Permission denied: cannot read source file\n");
+        command_error("Permission denied: cannot read source file\n");
         return;
     }
 
@@ -685,26 +1547,26 @@ void copy_file(const char *source, const char *destination) {
     }
 
     if (dest_parent_inode == -1) {
-        printf("Destination parent directory not found\n");
+        command_error("Destination parent directory not found\n");
         return;
     }
 
     // Vérifier les permissions de lecture et d'écriture du répertoire parent de destination / 检查目标父目录的读写权限
     if (!check_directory_permission(dest_parent_inode, PERM_READ | PERM_WRITE)) {
-        printf("Permission denied: cannot write to destination directory\n");
+        command_error("Permission denied: cannot write to destination directory\n");
         return;
     }
 
     // Vérifier si le fichier de destination existe déjà / 检查目标文件是否已存在
     if (find_in_directory(dest_parent_inode, dest_name) != -1) {
-        printf("Destination already exists\n");
+        command_error("Destination already exists\n");
         return;
     }
 
     // Allouer un nouvel inode / 分配新的 inode
     int new_inode = allocate_inode();
     if (new_inode == -1) {
-        printf("No free inodes available\n");
+        command_error("No free inodes available\n");
         return;
     }
 
@@ -718,29 +1580,16 @@ void copy_file(const char *source, const char *destination) {
     dest->ctime = time(NULL);
     dest->mtime = dest->ctime;
     dest->atime = dest->ctime;
+    dest->data.file = src->data.file;
+    dest->compressed = src->compressed;
+    memcpy(dest->comp_end, src->comp_end, sizeof(dest->comp_end));
 
-    // Copier le contenu du fichier / 复制文件内容
+    // Partager les pages de la source, copiées seulement à la première écriture / 共享源文件的页面，首次写入时才复制
     for (int i = 0; i < src->page_count; i++) {
-        // Allouer une nouvelle page / 分配新页面
-        int new_page = allocate_page();
-        if (new_page == -1) {
-            printf("No free pages available\n");
-            // Nettoyer les ressources allouées / 清理已分配的资源
-            for (int j = 0; j < dest->page_count; j++) {
-                free_page(dest->pages[j]);
-            }
-            free_inode(new_inode);
-            save_superblock();
-            return;
-        }
-
-        // Copier le contenu de la page / 复制页面内容
-        memcpy(fs.page_table[new_page].data, 
-               fs.page_table[src->pages[i]].data, 
-               PAGE_SIZE);
-        
-        dest->pages[dest->page_count++] = new_page;
+        share_page(src->pages[i]);
+        dest->pages[i] = src->pages[i];
     }
+    dest->page_count = src->page_count;
 
     // Ajouter l'entrée dans le répertoire / 添加目录项
     add_directory_entry(dest_parent_inode, dest_name, new_inode);
@@ -6,13 +6,25 @@
 #include <stdio.h>  
 #include <string.h>
 #include <stdlib.h>
+#include "vfs.h"
 
 // 大约20MB
 #define MAX_FILES 500  // Nombre maximum de fichiers / 文件数量上限
 #define MAX_FILENAME_LENGTH 256  // Longueur maximale du nom de fichier / 文件名最大长度
 #define MAX_PATH_LENGTH 1024  // Longueur maximale d'un chemin / 路径最大长度
 #define PAGE_SIZE 4096  //4KB per page / 每页4KB
+#define DISK_FILE "virtual_disk.dat"  // Fichier du disque virtuel / 虚拟磁盘文件
+#define JOURNAL_FILE DISK_FILE ".journal"  // Journal des transactions en cours de validation / 正在提交的事务日志
 #define MAX_FILE_PAGES 10  // Nombre maximum de pages par fichier / 文件最大页数
+#define PAGE_HOLE -1  // Page non allouée d'un fichier creux, lue comme des zéros / 稀疏文件中未分配的页面，读出为零
+#define LINE_INDEX_SLOTS 64  // Nombre d'entrées de l'index des lignes / 行索引条目数
+#define LINE_INDEX_STRIDE 16  // Intervalle initial (en lignes) entre deux entrées / 索引条目之间的初始行数间隔
+#define META_BLOCK_ENTRIES 32  // Nombre d'entrées par bloc de métadonnées vérifié / 每个校验元数据块的条目数
+#define META_BLOCKS ((MAX_FILES + META_BLOCK_ENTRIES - 1) / META_BLOCK_ENTRIES)  // Nombre de blocs de métadonnées / 元数据块数量
+#define MAX_SNAPSHOTS 16  // Nombre maximal d'instantanés / 快照最大数量
+#define APPEND_BUFFER_SLOTS 8  // Nombre de fichiers avec des ajouts en attente / 可同时缓冲追加内容的文件数
+#define APPEND_BUFFER_SIZE PAGE_SIZE  // Taille du tampon d'ajout par fichier / 每个文件的追加缓冲区大小
+#define APPEND_FLUSH_SECONDS 5  // Délai maximal avant l'écriture d'un ajout / 追加内容写回前的最长延迟(秒)
 
 // Définition des permissions / 权限定义
 #define PERM_READ    4
@@ -24,6 +36,17 @@
 #define FILE_TYPE_DIR     2    // Répertoire / 目录
 #define FILE_TYPE_SYMLINK 3    // Lien symbolique / 符号链接
 
+// Index clairsemé des lignes d'un fichier régulier / 普通文件的稀疏行索引
+typedef struct {
+    int valid;                   // Index à jour / 索引是否有效
+    int stride;                  // Nombre de lignes entre deux entrées / 两个条目之间的行数
+    int line_count;              // Nombre total de fins de ligne / 换行符总数
+    int entry_count;             // Nombre d'entrées utilisées / 已使用的条目数
+    unsigned int offsets[LINE_INDEX_SLOTS]; // Position après la ((i+1)*stride)-ième fin de ligne / 第 (i+1)*stride 个换行符之后的位置
+} LineIndex;
+
+#define INLINE_DATA_SIZE (MAX_PATH_LENGTH - sizeof(LineIndex))  // Taille maximale des données stockées dans l'inode / 存放在 inode 内的数据最大长度
+
 // Structure d'inode / inode 结构
 typedef struct {
     int inode_number;            // Numéro d'inode / inode编号
@@ -34,10 +57,16 @@ typedef struct {
     time_t atime;                // Temps d'accès / 访问时间
     time_t mtime;                // Temps de modification / 修改时间
     time_t ctime;                // Temps de création / 创建时间
-    int page_count;              // Nombre de pages utilisées / 文件使用的页面数量
-    int pages[MAX_FILE_PAGES];   // Pointeurs directs vers les pages / 直接页面指针
+    int page_count;              // Nombre de pages utilisées, 0 si le contenu est dans l'inode / 文件使用的页面数量，内容存放在 inode 内时为0
+    int pages[MAX_FILE_PAGES];   // Pointeurs directs vers les pages, ou PAGE_HOLE / 直接页面指针，或 PAGE_HOLE
+    unsigned char compressed;    // Contenu compressé page par page / 内容按页压缩
+    unsigned short comp_end[MAX_FILE_PAGES]; // Fin de chaque page compressée dans le flux / 每个压缩页在压缩流中的结束位置
     union {
         char symlink_path[MAX_PATH_LENGTH]; // Chemin du lien symbolique / 符号链接路径
+        struct {
+            LineIndex line_index;                // Index des lignes / 行索引
+            char inline_data[INLINE_DATA_SIZE];  // Contenu des petits fichiers (page_count == 0) / 小文件内容（page_count == 0 时）
+        } file;                                  // Données d'un fichier régulier / 普通文件数据
     } data;
 } Inode;
 
@@ -51,9 +80,18 @@ typedef struct {
 // Structure d'entrée de table de pages / 页表项结构
 typedef struct {
     int is_used;       // Indicateur d'utilisation / 是否被使用
+    int ref_count;     // Nombre de références (pages partagées par cp) / 引用计数（cp 共享的页面）
+    unsigned int checksum;  // CRC32C des données, mis à jour à la sauvegarde / 数据的 CRC32C，保存时更新
     char data[PAGE_SIZE];  // Page de données / 数据页面
 } PageTableEntry;
 
+// Description d'un instantané du volume / 卷快照描述
+typedef struct {
+    int id;                             // Identifiant du fichier de l'instantané / 快照文件编号
+    char name[MAX_FILENAME_LENGTH];     // Nom de l'instantané / 快照名称
+    time_t ctime;                       // Date de création / 创建时间
+} SnapshotInfo;
+
 // Structure du superbloc / 超级块结构
 typedef struct {
     Inode inodes[MAX_FILES];                      // Tableau d'inodes / inode 数组
@@ -61,6 +99,15 @@ typedef struct {
     PageTableEntry page_table[MAX_FILES * MAX_FILE_PAGES];  // Table des pages / 页面表
     int free_inode_head;                         // Tête de liste des inodes libres / 空闲 inode 链表头
     int free_page_head;                          // Tête de liste des pages libres / 空闲页面链表头
+    int dedup_enabled;                           // Mode de déduplication des pages / 页面去重模式
+    int compress_enabled;                        // Mode de compression des pages / 页面压缩模式
+    unsigned int inode_checksums[META_BLOCKS];   // CRC32C des blocs d'inodes / inode 块的 CRC32C
+    unsigned int directory_checksums[META_BLOCKS]; // CRC32C des blocs de répertoire / 目录块的 CRC32C
+    int snapshot_count;                          // Nombre d'instantanés, du plus ancien au plus récent / 快照数量（从旧到新）
+    int next_snapshot_id;                        // Prochain identifiant d'instantané / 下一个快照编号
+    SnapshotInfo snapshots[MAX_SNAPSHOTS];       // Instantanés existants / 现有快照
+    unsigned char snapshot_pins[MAX_FILES * MAX_FILE_PAGES]; // Nombre d'instantanés retenant chaque page / 引用每个页面的快照数
+    unsigned int generation;                     // Incrémentée à chaque sauvegarde, écrite en dernier / 每次保存时递增，最后写入
 } SuperBlock;
 
 
@@ -68,16 +115,46 @@ typedef struct {
 // Déclarations des fonctions du système de fichiers / 文件系统操作函数声明
 void format_partition(); // Initialiser la partition (créer un grand fichier "virtual_disk.dat" pour simuler le système de fichiers et initialiser le répertoire racine) / 初始化分区（创建一个大文件"virtual_disk.dat"来模拟文件系统，同时初始化根目录）
 size_t write_superblock(FILE* disk); // Écrire le superbloc sur le disque / 将超级块写入磁盘
+int read_superblock(); // Charger le superbloc en renvoyant un statut / 加载超级块并返回状态
 void load_superblock(); // Charger le superbloc du disque en mémoire / 从磁盘加载超级块到内存
-void save_superblock(); // Sauvegarder le superbloc sur le disque / 将超级块保存到磁盘
+int save_superblock(); // Sauvegarder le superbloc sur le disque / 将超级块保存到磁盘
+void begin_session(); // Garder le superbloc chargé entre les commandes / 在多条命令之间保持超级块已加载
+int commit_session(); // Écrire les modifications en attente de la session / 写入会话中待保存的修改
+int end_session(); // Valider puis terminer la session / 提交并结束会话
+unsigned int read_disk_generation(); // Génération de l'image publiée (sous le verrou de l'image) / 已发布镜像的版本号（需持有镜像锁）
+int begin_transaction(); // Commencer une transaction / 开始事务
+int commit_transaction(); // Valider la transaction en une sauvegarde / 以一次保存提交事务
+int abort_transaction(); // Annuler la transaction / 取消事务
+void discard_changes(); // Abandonner les modifications non écrites / 放弃尚未写入的修改
+int in_transaction(); // Indiquer si une transaction est en cours / 是否有事务正在进行
+void refresh_session(); // Recharger l'image si un autre processus l'a republiée / 其他进程重新发布镜像时重新加载
+void acquire_disk_writer(); // Devenir le seul processus qui modifie le volume / 成为唯一修改卷的进程
+void release_disk_writer(); // Hors session, rendre le rôle de rédacteur / 会话之外，释放写者身份
 
 // Déclarations des fonctions d'inode et de page / inode和page操作函数声明
 int allocate_inode(); // Allouer un inode / 分配 inode
 void free_inode(int inode_number); // Libérer un inode / 释放 inode
 int allocate_page(); // Allouer une page / 分配页面
-void free_page(int page_number); // Libérer une page / 释放页面
+void free_page(int page_number); // Libérer une référence à une page / 释放页面的一个引用
+void share_page(int page_number); // Ajouter une référence à une page / 增加页面的一个引用
+int unshare_page(int page_number); // Obtenir une copie privée d'une page partagée avant écriture / 写入前获取共享页面的私有副本
+int page_is_shared(int page_number); // Indiquer si une page doit être copiée avant écriture / 判断页面写入前是否需要复制
+void pin_page(int page_number); // Retenir une page pour un instantané / 为快照保留页面
+void unpin_page(int page_number); // Relâcher une page retenue par un instantané / 释放快照保留的页面
+int verify_page_checksum(int page_number); // Vérifier le checksum d'une page à sa première lecture / 首次读取页面时校验其校验和
+int metadata_damaged(); // Indiquer si des métadonnées chargées sont corrompues / 判断已加载的元数据是否损坏
+void accept_metadata(); // Accepter les métadonnées actuelles (fsck repair) / 接受当前元数据（fsck repair）
+long page_disk_offset(int page_number); // Position des données d'une page dans le fichier disque / 页面数据在磁盘文件中的位置
+void mark_page_dirty(int page_number); // Marquer une page à écrire lors de la prochaine sauvegarde / 标记页面在下次保存时写回
+void touch_access_time(Inode *inode); // Mettre à jour la date d'accès d'un inode lu / 更新被读取 inode 的访问时间
 int get_inode_from_path(const char *path); // Obtenir l'inode à partir du chemin / 根据路径获取inode
 int get_parent_directory_inode(const char *path); // Obtenir l'inode du répertoire parent / 获取父目录的inode
+int find_parent_directory_inode(const char *path); // Idem, sans message d'erreur / 同上，不输出错误信息
+int absolute_path(const char *path, char *absolute); // Chemin absolu sans barre finale / 不带末尾斜杠的绝对路径
+typedef struct DirectoryCache DirectoryCache; // Répertoires résolus d'une opération groupée / 批量操作中已解析的目录
+DirectoryCache *directory_cache_new(); // Créer un cache vide / 创建空缓存
+void directory_cache_free(DirectoryCache *cache); // Libérer le cache / 释放缓存
+int resolve_directory_cached(DirectoryCache *cache, const char *path, int *created); // Résoudre (ou créer) un répertoire / 解析（或创建）目录
 int get_file_size(int inode_number); // 获取文件大小
 int get_dir_size(int inode_number); // 获取目录大小
 void create_directory_entry(const char *name, int parent_inode); // Créer une entrée de répertoire / 创建目录项
@@ -91,18 +168,36 @@ void remove_directory_entry(const char *name, int parent_inode); // Supprimer un
 ///file.h
 // Déclarations des fonctions de manipulation de fichiers / 文件操作函数声明
 void create_file(const char *filename);
+int add_regular_file(const char *path); // Créer un fichier vide sans affichage / 创建空文件（不输出）
+int add_regular_file_at(int parent_inode, const char *filename); // Idem dans un parent résolu / 在已解析的父目录中创建
+void create_files(int count, char **paths); // Créer plusieurs fichiers en une sauvegarde / 一次保存创建多个文件
 void delete_file(const char *filename);
+void delete_files(int count, char **paths); // Supprimer plusieurs fichiers en une sauvegarde / 一次保存删除多个文件
 void move_file(const char *source, const char *destination);
 void copy_file(const char *source, const char *destination);
 void open_file(const char *filename); // Afficher le contenu du fichier (cat) / 打印文件内容（cat）
 void head_file(const char *path, int lines);  // Afficher les n premières lignes du fichier / 显示文件前 n 行
 void tail_file(const char *path, int lines);  // Afficher les n dernières lignes du fichier / 显示文件后 n 行
+void print_lines(const char *path, int first, int last); // Afficher les lignes first à last du fichier / 显示文件第 first 到 last 行
 void write_file(const char *filename, const char *content); // Écrire dans le fichier (echo) / 写入文件内容（echo）
+void truncate_file(const char *path, size_t size); // Changer la taille d'un fichier sans écrire de données / 不写入数据地改变文件大小
 void append_to_file(const char *path, const char *content); // Ajouter du contenu au fichier (echo >>) / 追加文件内容（echo >>）
+int store_file_data(Inode *inode, const char *content, size_t content_len); // Enregistrer le contenu complet d'un fichier / 保存文件的完整内容
+int set_file_contents(Inode *inode, const char *content, size_t content_len); // Remplacer le contenu d'un fichier en mémoire / 在内存中替换文件内容
+int replace_file_contents(const char *path, const char *content, size_t content_len); // Remplacer le contenu d'un fichier par son chemin, sans affichage / 按路径替换文件内容，不输出
+int read_file_data(const Inode *inode, size_t start, size_t end, char *buffer); // Lire une plage d'octets d'un fichier / 读取文件的一段字节
+int write_file_data(Inode *inode, size_t start, const char *content, size_t content_len); // Écrire une plage d'octets d'un fichier en mémoire / 在内存中写入文件的一段字节
+int verify_file_pages(const Inode *inode); // Vérifier les checksums des pages d'un fichier / 校验文件所有页面的校验和
+const char *file_page_data(const Inode *inode, int page_index); // Données d'une page, sans copie (NULL si corrompue) / 页面数据（不复制，损坏时为 NULL）
+int append_data(Inode *inode, const char *content, size_t content_len); // Ajouter à la fin d'un fichier en mémoire / 在内存中追加到文件末尾
+void sync_append_buffers(int force); // Écrire les ajouts en attente (tous, ou seulement les expirés) / 写回缓冲的追加内容（全部或仅超时的）
 
 ///dir.h
 // Déclarations des fonctions de manipulation de répertoires / 目录操作函数声明
 void create_directory(const char *dirname);
+int add_directory(const char *path); // Créer un répertoire sans affichage / 创建目录（不输出）
+int add_directory_at(int parent_inode, const char *dirname); // Idem dans un parent résolu / 在已解析的父目录中创建
+void create_directories(int count, char **paths); // mkdir -p
 void delete_directory(const char *dirname);
 void delete_directory_recursive(int dir_inode); // Supprimer un répertoire et son contenu récursivement / 递归删除目录及其内容（辅助函数）
 void delete_directory_force(const char *path); // Supprimer un répertoire et son contenu (rm -rf) / 删除目录及其内容（rm -rf）
@@ -143,11 +238,120 @@ unsigned char parse_permissions(const char *perm_str); // Analyser la chaîne de
 // Déclarations des fonctions de liens / 硬链接和符号链接操作函数声明
 void link_file(const char *source, const char *link_name);  // Créer un lien dur / 创建硬链接
 int resolve_symlink(int inode_num); // Résoudre un lien symbolique / 解析符号链接
+int lookup_path(const char *path); // Résoudre un chemin et ses liens sans affichage / 无输出地解析路径及其链接
 void create_symlink(const char *target, const char *linkpath); // Créer un lien symbolique / 创建符号链接
 void delete_symlink(const char *path);  // Supprimer un lien symbolique / 删除符号链接
 void show_symlink(const char *linkpath); // Afficher la cible du lien symbolique / 显示符号链接目标
 
 
+///dedup.h
+// Déclarations des fonctions de déduplication / 页面去重函数声明
+int dedup_page(int page_number); // Partager une page identique déjà présente / 共享已存在的相同页面
+void dedup_command(const char *arg); // Activer/désactiver la déduplication (dedup on|off) / 开启/关闭页面去重
+
+
+///compress.h
+// Déclarations des fonctions de compression / 压缩函数声明
+size_t lz_compress(const char *src, size_t len, char *dst, size_t cap); // Compresser un bloc / 压缩数据块
+long lz_decompress(const char *src, size_t len, char *dst, size_t cap); // Décompresser un bloc / 解压数据块
+size_t compress_file_data(const char *data, size_t len, char *stream, unsigned short *comp_end); // Compresser un fichier page par page / 按页压缩文件内容
+const char *compressed_page_data(const Inode *inode, int page_index); // Page décompressée via le cache / 通过缓存获取解压后的页面
+void page_cache_invalidate(int inode_number); // Oublier les pages en cache d'un fichier / 使文件的缓存页失效
+void compress_command(const char *arg); // Activer/désactiver la compression (compress on|off) / 开启/关闭页面压缩
+
+
+///snapshot.h
+void snapshot_preserve_metadata(const Inode *old_inodes, const DirectoryEntry *old_directory); // Conserver les blocs de métadonnées modifiés pour le dernier instantané / 为最新快照保存被修改的元数据块
+int find_snapshot(const char *name); // Chercher un instantané par son nom / 按名称查找快照
+int snapshot_metadata(int index, Inode *inodes, DirectoryEntry *directory, int *free_inode_head); // Reconstituer les métadonnées d'un instantané / 重建快照的元数据
+void mark_free_inodes(const Inode *inodes, int head, unsigned char *is_free); // Marquer les inodes de la liste libre / 标记空闲链表中的 inode
+void snapshot_command(const char *action, const char *name); // Créer, lister, supprimer ou restaurer un instantané / 创建、列出、删除或恢复快照
+
+
+///send.h
+void send_command(const char *host_file, const char *from_snapshot); // Écrire le flux des changements depuis un instantané / 写出自某快照以来的变更流
+void receive_command(const char *host_file); // Appliquer un flux de changements au volume / 将变更流应用到卷
+
+
+///archive.h
+void import_archive(const char *host_tar, const char *dest_path); // Extraire une archive tar de l'hôte dans le volume / 将主机上的 tar 归档解压到卷中
+void export_archive(const char *path, const char *host_tar); // Écrire une arborescence du volume dans une archive tar / 将卷中的目录树写入 tar 归档
+
+
+///hostio.h
+void put_file(const char *host_file, const char *path); // Copier un fichier de l'hôte dans le volume / 将主机文件复制到卷中
+void get_file(const char *path, const char *host_file); // Copier un fichier du volume vers l'hôte / 将卷中的文件复制到主机
+
+
+///fsck.h
+void fsck_command(const char *arg); // Vérifier (et réparer) la cohérence du système de fichiers / 检查（并修复）文件系统一致性
+
+
+///crc32c.h
+unsigned int crc32c(const void *data, size_t len); // Calculer le CRC32C d'un bloc / 计算数据块的 CRC32C
+
+
+///command.h
+#define MAX_COMMAND_ARGS 128  // Nombre maximum de mots dans une commande (touch/rm/mkdir -p groupés) / 命令的最大单词数（批量 touch/rm/mkdir -p）
+#define MAX_COMMAND_LENGTH 4096  // Longueur maximale d'une ligne de commande / 命令行最大长度
+#define COMMAND_OK 0         // Commande exécutée / 命令已执行
+#define COMMAND_EXIT 1       // Commande exit / exit 命令
+#define COMMAND_INVALID -1   // Commande inconnue ou arguments invalides / 未知命令或参数无效
+#define COMMAND_NOT_INIT -2  // Le disque n'est pas formaté / 磁盘未格式化
+#define COMMAND_FAILED -3    // Commande exécutée mais qui a signalé une erreur / 命令已执行但报告了错误
+int tokenize_command(char *line, char *argv[], int max_args); // Découper une ligne en mots / 将一行拆分为单词
+int execute_command(int argc, char *argv[]); // Exécuter une commande découpée / 执行拆分后的命令
+void set_command_location(const char *source, int line); // Ligne de script des commandes suivantes / 后续命令所在的脚本行
+void command_error(const char *format, ...); // Afficher l'échec de la commande en cours / 显示当前命令的错误
+int command_is_read_only(int argc, char *argv[]); // Indiquer si une commande ne modifie pas le volume / 判断命令是否不修改卷
+int command_is_local_only(int argc, char *argv[]); // Indiquer si une commande est refusée par le serveur / 判断命令是否不能通过服务器执行
+
+///pipe.h
+int is_pipeline(int argc, char *argv[]); // Indiquer si une ligne contient | ou une redirection / 判断命令行是否包含 | 或重定向
+int pipeline_read_only(int argc, char *argv[]); // Indiquer si un pipeline ne fait que lire le volume / 判断管道是否只读取卷
+int run_pipeline(int argc, char *argv[]); // Exécuter un pipeline / 执行管道
+
+///lock.h
+// Ensemble de verrous d'inodes pris par une commande / 命令持有的 inode 锁集合
+typedef struct {
+    int count;
+    int overflow;                          // Trop d'inodes : verrouiller tout le volume / inode 过多：锁定整个卷
+    int inodes[MAX_FILES];
+    unsigned char exclusive[MAX_FILES];
+} LockSet;
+extern int locking_enabled;  // Hôte multithread : les commandes prennent les verrous / 多线程宿主：命令需要加锁
+void lock_volume(int exclusive); // Prendre le verrou du volume / 获取卷锁
+void unlock_volume(); // Relâcher le verrou du volume / 释放卷锁
+void lock_pages(); // Verrouiller l'allocateur de pages / 锁定页面分配器
+void unlock_pages();
+void lock_inode_allocator(); // Verrouiller l'allocateur d'inodes / 锁定 inode 分配器
+void unlock_inode_allocator();
+void lock_directory_slots(); // Verrouiller les emplacements de la table des répertoires / 锁定目录表空闲槽
+void unlock_directory_slots();
+void lock_set_init(LockSet *set); // Vider un ensemble de verrous / 清空锁集合
+void lock_set_add(LockSet *set, int inode_number, int exclusive); // Ajouter un inode / 添加一个 inode
+void lock_set_add_children(LockSet *set, int dir_inode, int recursive); // Ajouter les entrées d'un répertoire / 添加目录的条目
+void lock_set_acquire(LockSet *set); // Verrouiller par numéro croissant / 按编号递增加锁
+void lock_set_release(LockSet *set); // Relâcher l'ensemble / 释放锁集合
+unsigned int namespace_read_begin(); // Lecture optimiste de l'arborescence / 目录树的乐观读
+int namespace_read_retry(unsigned int token); // 1 si la lecture doit être recommencée / 需要重读时返回 1
+void namespace_write_begin(); // Début d'une modification de l'arborescence / 目录树修改开始
+void namespace_write_end(); // Fin d'une modification de l'arborescence / 目录树修改结束
+unsigned int inode_read_begin(int inode_number); // Lecture optimiste d'un inode / inode 的乐观读
+int inode_read_retry(int inode_number, unsigned int token); // 1 si l'inode a changé / inode 已改变时返回 1
+void lock_disk_image(int exclusive); // Verrou de l'image disque entre processus / 进程间的磁盘镜像锁
+void unlock_disk_image();
+void lock_disk_writer(); // Verrou du processus rédacteur / 写者进程锁
+void unlock_disk_writer();
+void detach_disk_locks(); // Processus fils : ne plus partager les verrous du père / 子进程：不再共享父进程的锁
+
+
+///server.h
+void run_server(const char *socket_path); // Servir le volume sur une socket Unix / 通过 Unix 套接字提供卷服务
+int connect_server(const char *socket_path); // Se connecter à un serveur / 连接到服务器
+int remote_command(int fd, int argc, char *argv[]); // Exécuter une commande sur le serveur / 在服务器上执行命令
+
+
 ///help.h
 // Déclarations des fonctions d'aide / 帮助信息函数声明
 void show_help(); // Afficher les informations d'aide / 显示帮助信息
@@ -156,7 +360,9 @@ void NotInit();
 
 // Variables globales / 全局变量
 extern SuperBlock superblock;  // Superbloc / 超级块
-extern char current_path[MAX_PATH_LENGTH];  // Répertoire de travail courant / 当前工作目录
+extern __thread char current_path[MAX_PATH_LENGTH];  // Répertoire de travail courant, propre à chaque thread / 当前工作目录，每个线程各自一份
+extern int batch_mode;  // Exécution d'un script, sans invite ni confirmation / 脚本执行模式，无提示符也无确认
+extern int read_only_mount;  // Volume monté en lecture seule (-r) / 以只读方式挂载卷（-r）
 
 
 // 测试函数
@@ -0,0 +1,464 @@
+/**
+* @file fsck.c
+* @brief Vérification et réparation de la cohérence du système de fichiers (fsck)
+* @author jzy
+* @date 2025-4-15
+*/
+#include "filesystem.h"
+#include <pthread.h>
+#include <unistd.h>
+
+extern SuperBlock fs;
+
+#define FSCK_MAX_THREADS 8  // Nombre maximal de threads de vérification / 最大校验线程数
+#define TOTAL_PAGES (MAX_FILES * MAX_FILE_PAGES)
+
+// Problèmes détectés sur un inode / inode 上发现的问题
+#define INODE_BAD_TYPE    0x01  // Type de fichier inconnu / 未知文件类型
+#define INODE_BAD_NUMBER  0x02  // Numéro d'inode incohérent / inode 编号不一致
+#define INODE_BAD_PAGES   0x04  // Pointeur de page invalide / 页面指针无效
+
+// Problèmes détectés sur une entrée de répertoire / 目录项上发现的问题
+#define ENTRY_BAD_TARGET  0x01  // Inode cible libre ou hors limites / 目标 inode 空闲或越界
+#define ENTRY_BAD_PARENT  0x02  // Répertoire parent libre ou pas un répertoire / 父目录空闲或不是目录
+#define ENTRY_BAD_DOT     0x04  // '.' ne désigne pas son répertoire / '.' 未指向所在目录
+
+// Problèmes détectés sur une page / 页面上发现的问题
+#define PAGE_BAD_CHECKSUM 0x01  // Checksum incorrect / 校验和错误
+
+// État partagé de la vérification / 校验的共享状态
+static unsigned char inode_free[MAX_FILES];        // Inode dans la liste libre / inode 在空闲链表中
+static unsigned char page_on_free_list[TOTAL_PAGES]; // Page dans la liste libre / 页面在空闲链表中
+static unsigned char inode_problem[MAX_FILES];
+static unsigned char entry_problem[MAX_FILES];
+static unsigned char page_problem[TOTAL_PAGES];
+static int page_refs[TOTAL_PAGES];                 // Références trouvées dans les inodes / inode 中找到的引用数
+static int name_refs[MAX_FILES];                   // Entrées nommées désignant chaque inode / 指向每个 inode 的具名目录项数
+
+// Travail d'un thread : une tranche d'inodes, d'entrées et de pages / 线程任务：一段 inode、目录项和页面
+typedef struct {
+    int first_inode, last_inode;   // [first, last)
+    int first_page, last_page;     // [first, last)
+    int page_refs[TOTAL_PAGES];    // Résultats locaux, fusionnés après la jointure / 局部结果，join 后合并
+    int name_refs[MAX_FILES];
+} FsckWorker;
+
+/**
+ * @brief Indiquer si une entrée est '.' ou '..'
+ * @param entry L'entrée de répertoire
+ * @return 1 si c'est '.' ou '..', 0 sinon
+ */
+static int is_dot_entry(const DirectoryEntry *entry) {
+    return strcmp(entry->name, ".") == 0 || strcmp(entry->name, "..") == 0;
+}
+
+/**
+ * @brief Vérifier une tranche d'inodes, d'entrées de répertoire et de pages
+ * @details Chaque thread n'écrit que dans sa tranche des tableaux partagés et dans ses compteurs locaux
+ * @param arg Le FsckWorker décrivant la tranche
+ * @return NULL
+ */
+static void *fsck_worker(void *arg) {
+    FsckWorker *w = arg;
+
+    for (int i = w->first_inode; i < w->last_inode; i++) {
+        // Inodes utilisés : type, numéro et pages / 已使用的 inode：类型、编号和页面
+        if (!inode_free[i]) {
+            Inode *inode = &fs.inodes[i];
+            if (inode->file_type != FILE_TYPE_REGULAR && inode->file_type != FILE_TYPE_DIR &&
+                inode->file_type != FILE_TYPE_SYMLINK) {
+                inode_problem[i] |= INODE_BAD_TYPE;
+            }
+            if (inode->inode_number != i) {
+                inode_problem[i] |= INODE_BAD_NUMBER;
+            }
+            if (inode->page_count < 0 || inode->page_count > MAX_FILE_PAGES ||
+                (inode->file_type != FILE_TYPE_REGULAR && inode->page_count != 0)) {
+                inode_problem[i] |= INODE_BAD_PAGES;
+            } else {
+                for (int j = 0; j < inode->page_count; j++) {
+                    int page = inode->pages[j];
+                    if (page == PAGE_HOLE && !inode->compressed) continue;
+                    if (page < 0 || page >= TOTAL_PAGES || page_on_free_list[page]) {
+                        inode_problem[i] |= INODE_BAD_PAGES;
+                        break;
+                    }
+                    w->page_refs[page]++;
+                }
+            }
+        }
+
+        // Entrées de répertoire de la même tranche / 同一区间的目录项
+        DirectoryEntry *entry = &fs.directory[i];
+        if (entry->inode_number == -1) continue;
+        int target = entry->inode_number;
+        int parent = entry->parent_inode;
+        if (target < 0 || target >= MAX_FILES || inode_free[target]) {
+            entry_problem[i] |= ENTRY_BAD_TARGET;
+        }
+        if (parent < 0 || parent >= MAX_FILES || inode_free[parent] ||
+            fs.inodes[parent].file_type != FILE_TYPE_DIR) {
+            entry_problem[i] |= ENTRY_BAD_PARENT;
+        }
+        if (strcmp(entry->name, ".") == 0 && target != parent) {
+            entry_problem[i] |= ENTRY_BAD_DOT;
+        }
+        if (!entry_problem[i] && !is_dot_entry(entry)) {
+            w->name_refs[target]++;
+        }
+    }
+
+    // Checksums des pages utilisées / 已使用页面的校验和
+    for (int p = w->first_page; p < w->last_page; p++) {
+        if (fs.page_table[p].is_used &&
+            crc32c(fs.page_table[p].data, PAGE_SIZE) != fs.page_table[p].checksum) {
+            page_problem[p] |= PAGE_BAD_CHECKSUM;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parcourir les listes libres des inodes et des pages
+ * @details Une boucle ou un lien hors limites coupe la liste; la suite est signalée comme fuite
+ * @param problems Compteur de problèmes à incrémenter
+ * @return Aucun
+ */
+static void walk_free_lists(int *problems) {
+    memset(inode_free, 0, sizeof(inode_free));
+    memset(page_on_free_list, 0, sizeof(page_on_free_list));
+
+    int steps = 0;
+    for (int i = fs.free_inode_head; i != -1; i = fs.inodes[i].link_count) {
+        if (i < 0 || i >= MAX_FILES || inode_free[i] || ++steps > MAX_FILES) {
+            printf("Inode free list is broken at %d\n", i);
+            (*problems)++;
+            break;
+        }
+        inode_free[i] = 1;
+    }
+
+    steps = 0;
+    for (int p = fs.free_page_head; p != -1; p = *((int *)fs.page_table[p].data)) {
+        if (p < 0 || p >= TOTAL_PAGES || page_on_free_list[p] || ++steps > TOTAL_PAGES) {
+            printf("Page free list is broken at %d\n", p);
+            (*problems)++;
+            break;
+        }
+        if (fs.page_table[p].is_used) {
+            printf("Page %d is on the free list but marked used\n", p);
+            (*problems)++;
+        }
+        page_on_free_list[p] = 1;
+    }
+}
+
+/**
+ * @brief Lancer les threads de vérification par tranches et fusionner leurs résultats
+ * @return Aucun
+ */
+static void run_workers() {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus < 1 ? 1 : cpus > FSCK_MAX_THREADS ? FSCK_MAX_THREADS : (int)cpus;
+
+    FsckWorker *workers = calloc(threads, sizeof(FsckWorker));
+    pthread_t tids[FSCK_MAX_THREADS];
+    int started[FSCK_MAX_THREADS] = {0};
+    if (!workers) {
+        threads = 0;
+    }
+
+    for (int t = 0; t < threads; t++) {
+        workers[t].first_inode = MAX_FILES * t / threads;
+        workers[t].last_inode = MAX_FILES * (t + 1) / threads;
+        workers[t].first_page = TOTAL_PAGES * t / threads;
+        workers[t].last_page = TOTAL_PAGES * (t + 1) / threads;
+        started[t] = pthread_create(&tids[t], NULL, fsck_worker, &workers[t]) == 0;
+        if (!started[t]) fsck_worker(&workers[t]);  // Repli sans thread / 无法创建线程时直接执行
+    }
+
+    memset(page_refs, 0, sizeof(page_refs));
+    memset(name_refs, 0, sizeof(name_refs));
+    for (int t = 0; t < threads; t++) {
+        if (started[t]) pthread_join(tids[t], NULL);
+        for (int p = 0; p < TOTAL_PAGES; p++) page_refs[p] += workers[t].page_refs[p];
+        for (int i = 0; i < MAX_FILES; i++) name_refs[i] += workers[t].name_refs[i];
+    }
+
+    if (!workers) {
+        // Mémoire insuffisante : vérification sur le thread courant / 内存不足：在当前线程上校验
+        static FsckWorker single;
+        memset(&single, 0, sizeof(single));
+        single.last_inode = MAX_FILES;
+        single.last_page = TOTAL_PAGES;
+        fsck_worker(&single);
+        memcpy(page_refs, single.page_refs, sizeof(page_refs));
+        memcpy(name_refs, single.name_refs, sizeof(name_refs));
+    }
+    free(workers);
+}
+
+/**
+ * @brief Commande fsck : vérifier (et réparer) la cohérence des inodes, du répertoire et des pages
+ * @details Vérifie les listes libres, les types et pages des inodes, les entrées de répertoire, les
+ *          pointeurs '.' et '..', l'accessibilité depuis la racine, les compteurs de liens, la propriété
+ *          et les compteurs de références des pages, et les checksums. Les inodes, entrées et pages sont
+ *          répartis par tranches entre plusieurs threads.
+ * @param arg "repair" pour corriger les problèmes, ou NULL pour les signaler seulement
+ * @return Aucun
+ */
+void fsck_command(const char *arg) {
+    if (arg != NULL && strcmp(arg, "repair") != 0) {
+        command_error("Usage: fsck [repair]\n");
+        return;
+    }
+    int repair = arg != NULL;
+
+    load_superblock();
+    commit_session();  // Les checksums des pages modifiées sont recalculés à l'écriture / 被修改页面的校验和在写入时重新计算
+    int problems = 0;
+    int root = fs.directory[0].inode_number;
+
+    memset(inode_problem, 0, sizeof(inode_problem));
+    memset(entry_problem, 0, sizeof(entry_problem));
+    memset(page_problem, 0, sizeof(page_problem));
+    walk_free_lists(&problems);
+    if (root < 0 || root >= MAX_FILES || inode_free[root] || fs.inodes[root].file_type != FILE_TYPE_DIR) {
+        command_error("Root directory is missing, cannot check the tree\n");
+        return;
+    }
+    run_workers();
+
+    // Inodes / inode
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!inode_problem[i]) continue;
+        problems++;
+        if (inode_problem[i] & INODE_BAD_TYPE) printf("Inode %d has an unknown type %d\n", i, fs.inodes[i].file_type);
+        if (inode_problem[i] & INODE_BAD_NUMBER) printf("Inode %d records number %d\n", i, fs.inodes[i].inode_number);
+        if (inode_problem[i] & INODE_BAD_PAGES) printf("Inode %d has an invalid page list\n", i);
+        if (!repair) continue;
+
+        Inode *inode = &fs.inodes[i];
+        inode->inode_number = i;
+        if (inode_problem[i] & INODE_BAD_TYPE) {
+            // Inode illisible : le libérer, ses entrées seront supprimées ci-dessous / 无法识别的 inode：释放它，其目录项将在下面删除
+            inode_free[i] = 1;
+            continue;
+        }
+        if (inode_problem[i] & INODE_BAD_PAGES) {
+            // Garder les pages valides du début du fichier / 保留文件开头的有效页面
+            int kept = 0;
+            if (inode->file_type == FILE_TYPE_REGULAR && inode->page_count > 0) {
+                int count = inode->page_count > MAX_FILE_PAGES ? MAX_FILE_PAGES : inode->page_count;
+                while (kept < count && ((inode->pages[kept] == PAGE_HOLE && !inode->compressed) ||
+                       (inode->pages[kept] >= 0 && inode->pages[kept] < TOTAL_PAGES &&
+                        !page_on_free_list[inode->pages[kept]]))) {
+                    kept++;
+                }
+            }
+            inode->page_count = kept;
+            if (inode->compressed || (inode->file_type == FILE_TYPE_REGULAR && inode->size > (size_t)kept * PAGE_SIZE)) {
+                inode->compressed = 0;
+                inode->size = (size_t)kept * PAGE_SIZE;
+                inode->data.file.line_index.valid = 0;
+            }
+        }
+    }
+
+    // Entrées de répertoire invalides / 无效目录项
+    for (int i = 0; i < MAX_FILES; i++) {
+        DirectoryEntry *entry = &fs.directory[i];
+        if (!entry_problem[i]) continue;
+        problems++;
+        if (entry_problem[i] & ENTRY_BAD_TARGET) printf("Entry '%s' points to a free inode %d\n", entry->name, entry->inode_number);
+        if (entry_problem[i] & ENTRY_BAD_PARENT) printf("Entry '%s' has an invalid parent %d\n", entry->name, entry->parent_inode);
+        if (entry_problem[i] & ENTRY_BAD_DOT) printf("Entry '.' of directory %d points to %d\n", entry->parent_inode, entry->inode_number);
+        if (!repair) continue;
+        if (entry_problem[i] == ENTRY_BAD_DOT) {
+            entry->inode_number = entry->parent_inode;
+        } else {
+            entry->inode_number = -1;
+            entry->parent_inode = -1;
+            entry->name[0] = '\0';
+        }
+    }
+    if (repair) {
+        // Les inodes libérés ci-dessus ne comptent plus comme cibles / 上面释放的 inode 不再作为目标
+        for (int i = 0; i < MAX_FILES; i++) {
+            DirectoryEntry *entry = &fs.directory[i];
+            if (entry->inode_number != -1 && inode_free[entry->inode_number]) {
+                if (!is_dot_entry(entry)) name_refs[entry->inode_number]--;
+                entry->inode_number = -1;
+                entry->parent_inode = -1;
+                entry->name[0] = '\0';
+            }
+        }
+    }
+
+    // Accessibilité depuis la racine : listes chaînées des enfants de chaque répertoire / 从根目录的可达性：每个目录的子项链表
+    int child_head[MAX_FILES], next_child[MAX_FILES], dir_entry[MAX_FILES];
+    int queue[MAX_FILES];
+    unsigned char reachable[MAX_FILES] = {0};
+    for (int i = 0; i < MAX_FILES; i++) {
+        child_head[i] = -1;
+        dir_entry[i] = -1;
+    }
+    for (int i = MAX_FILES - 1; i >= 0; i--) {
+        DirectoryEntry *entry = &fs.directory[i];
+        if (entry->inode_number == -1 || entry_problem[i] & (ENTRY_BAD_TARGET | ENTRY_BAD_PARENT) || is_dot_entry(entry)) continue;
+        next_child[i] = child_head[entry->parent_inode];
+        child_head[entry->parent_inode] = i;
+    }
+    int queue_len = 0;
+    reachable[root] = 1;
+    queue[queue_len++] = root;
+    for (int q = 0; q < queue_len; q++) {
+        int dir = queue[q];
+        for (int e = child_head[dir]; e != -1; e = next_child[e]) {
+            int target = fs.directory[e].inode_number;
+            if (fs.inodes[target].file_type == FILE_TYPE_DIR) {
+                if (dir_entry[target] != -1 || target == root) {
+                    printf("Directory %d has more than one name ('%s')\n", target, fs.directory[e].name);
+                    problems++;
+                    if (repair) {
+                        name_refs[target]--;
+                        fs.directory[e].inode_number = -1;
+                        fs.directory[e].parent_inode = -1;
+                        fs.directory[e].name[0] = '\0';
+                    }
+                    continue;
+                }
+                dir_entry[target] = e;
+            }
+            if (!reachable[target]) {
+                reachable[target] = 1;
+                if (fs.inodes[target].file_type == FILE_TYPE_DIR) queue[queue_len++] = target;
+            }
+        }
+    }
+
+    // Entrées dans des répertoires inaccessibles / 位于不可达目录中的目录项
+    for (int i = 0; i < MAX_FILES; i++) {
+        DirectoryEntry *entry = &fs.directory[i];
+        if (entry->inode_number == -1 || entry_problem[i]) continue;
+        if (entry->parent_inode >= 0 && entry->parent_inode < MAX_FILES && reachable[entry->parent_inode]) continue;
+        printf("Entry '%s' is in an unreachable directory %d\n", entry->name, entry->parent_inode);
+        problems++;
+        if (repair) {
+            if (!is_dot_entry(entry)) name_refs[entry->inode_number]--;
+            entry->inode_number = -1;
+            entry->parent_inode = -1;
+            entry->name[0] = '\0';
+        }
+    }
+
+    // Pointeurs '..' : le parent de chaque répertoire accessible / '..' 指针：每个可达目录的父目录
+    for (int i = 0; i < MAX_FILES; i++) {
+        DirectoryEntry *entry = &fs.directory[i];
+        if (entry->inode_number == -1 || entry_problem[i] || strcmp(entry->name, "..") != 0) continue;
+        int dir = entry->parent_inode;
+        if (!reachable[dir]) continue;
+        int expected = dir == root ? root : fs.directory[dir_entry[dir]].parent_inode;
+        if (entry->inode_number != expected) {
+            printf("Entry '..' of directory %d points to %d instead of %d\n", dir, entry->inode_number, expected);
+            problems++;
+            if (repair) entry->inode_number = expected;
+        }
+    }
+
+    // Inodes orphelins et compteurs de liens / 孤立 inode 和链接计数
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (inode_free[i] || i == root) continue;
+        Inode *inode = &fs.inodes[i];
+        if (!reachable[i]) {
+            printf("Inode %d is allocated but not reachable from the root\n", i);
+            problems++;
+            if (repair) inode_free[i] = 1;
+            continue;
+        }
+        // link_count compte les liens en plus du premier nom; un lien symbolique vaut 1 / link_count 统计第一个名字之外的链接；符号链接为 1
+        int expected = inode->file_type == FILE_TYPE_REGULAR ? name_refs[i] - 1 :
+                       inode->file_type == FILE_TYPE_SYMLINK ? 1 : inode->link_count;
+        if (inode->link_count != expected) {
+            printf("Inode %d has link count %d, expected %d\n", i, inode->link_count, expected);
+            problems++;
+            if (repair) inode->link_count = expected;
+        }
+    }
+
+    // Propriété et compteurs de références des pages / 页面归属和引用计数
+    if (repair) {
+        // Recompter sans les inodes libérés par la réparation / 不计入修复中释放的 inode
+        memset(page_refs, 0, sizeof(page_refs));
+        for (int i = 0; i < MAX_FILES; i++) {
+            if (inode_free[i] || fs.inodes[i].file_type != FILE_TYPE_REGULAR) continue;
+            for (int j = 0; j < fs.inodes[i].page_count; j++) {
+                if (fs.inodes[i].pages[j] != PAGE_HOLE) page_refs[fs.inodes[i].pages[j]]++;
+            }
+        }
+    }
+    int lost_pages = 0;
+    for (int p = 0; p < TOTAL_PAGES; p++) {
+        PageTableEntry *page = &fs.page_table[p];
+        if (page_problem[p] & PAGE_BAD_CHECKSUM) {
+            printf("Page %d fails its checksum\n", p);
+            problems++;
+            if (repair) mark_page_dirty(p);  // Accepter le contenu actuel / 接受当前内容
+        }
+        // Une page retenue par un instantané reste utilisée sans référence de fichier / 被快照保留的页面即使没有文件引用也保持使用状态
+        int used = page_refs[p] > 0 || fs.snapshot_pins[p] > 0;
+        if (page->is_used == used && page->ref_count == page_refs[p] && (used || page_on_free_list[p])) {
+            continue;
+        }
+        if (used && !page->is_used) printf("Page %d is used but marked free\n", p);
+        else if (!used && page->is_used) printf("Page %d is marked used but nothing owns it\n", p);
+        else if (used || page->ref_count != 0) printf("Page %d has reference count %d, expected %d\n", p, page->ref_count, page_refs[p]);
+        else lost_pages++;
+        problems += used || page->is_used || page->ref_count != 0;
+        if (repair) {
+            page->is_used = used;
+            page->ref_count = page_refs[p];
+            mark_page_dirty(p);
+        }
+    }
+
+    // Les détails sont affichés au chargement / 详细信息在加载时输出
+    if (metadata_damaged()) {
+        printf("Inode or directory blocks fail their checksum\n");
+        problems++;
+        if (repair) accept_metadata();  // Les checksums sont recalculés à la sauvegarde / 保存时重新计算校验和
+    }
+
+    if (lost_pages) {
+        // Une liste libre coupée perd toutes les pages suivantes : un seul message / 断开的空闲链表会丢失后续所有页面：只输出一条信息
+        printf("%d free page(s) are not on the free list\n", lost_pages);
+        problems++;
+    }
+
+    if (!repair) {
+        if (problems == 0) printf("Filesystem clean\n");
+        else command_error("%d problem(s) found, run 'fsck repair' to fix them\n", problems);
+        return;
+    }
+
+    // Reconstruire les listes libres dans l'ordre croissant / 按升序重建空闲链表
+    fs.free_inode_head = -1;
+    for (int i = MAX_FILES - 1; i >= 0; i--) {
+        if (!inode_free[i] || i == root) continue;
+        fs.inodes[i].link_count = fs.free_inode_head;
+        fs.free_inode_head = i;
+    }
+    fs.free_page_head = -1;
+    for (int p = TOTAL_PAGES - 1; p >= 0; p--) {
+        if (fs.page_table[p].is_used) continue;
+        if (*((int *)fs.page_table[p].data) != fs.free_page_head) {
+            *((int *)fs.page_table[p].data) = fs.free_page_head;
+            mark_page_dirty(p);
+        }
+        fs.free_page_head = p;
+    }
+
+    save_superblock();
+    if (problems == 0) printf("Filesystem clean\n");
+    else printf("%d problem(s) repaired\n", problems);
+}
@@ -18,12 +18,28 @@ void show_help() {
     // 基本文件系统操作
     printf("File System Operations:\n");
     printf("  mkfs                   Format the file system\n");
+    printf("  sync                   Flush buffered appends to disk\n");
+    printf("  begin                  Start a transaction\n");
+    printf("  commit                 Apply the transaction atomically through the journal\n");
+    printf("  abort                  Discard the changes made since begin\n");
+    printf("  dedup [on|off]         Show or toggle page deduplication\n");
+    printf("  compress [on|off]      Show or toggle page compression\n");
+    printf("  fsck [repair]          Check (and repair) filesystem consistency\n");
+    printf("  snapshot create|delete|restore <name>  Manage volume snapshots\n");
+    printf("  snapshot list          List volume snapshots\n");
+    printf("  send <hostfile> [snap] Write changes since a snapshot (or all) to a stream\n");
+    printf("  receive <hostfile>     Apply a send stream to this volume\n");
+    printf("  import <hosttar> [dir] Extract a host tar archive into the volume\n");
+    printf("  export <path> <hosttar> Write a file or directory tree to a host tar archive\n");
+    printf("  put <hostfile> <path>   Copy a host file into the volume\n");
+    printf("  get <path> <hostfile>   Copy a file from the volume to the host\n");
     
     // 目录操作
     printf("\nDirectory Operations:\n");
     printf("  pwd                   Show current working directory\n");
     printf("  cd <path>             Change current directory\n");
     printf("  mkdir <name>          Create a new directory\n");
+    printf("  mkdir -p <path>...    Create directories and their missing parents\n");
     printf("  rmdir <name>          Remove an empty directory\n");
     printf("  rm -rf <name>         Remove a directory and its contents recursively\n");
     printf("  mvdir <src> <dst>     Move/rename a directory\n");
@@ -31,8 +47,8 @@ void show_help() {
     
     // 文件操作
     printf("\nFile Operations:\n");
-    printf("  touch <name>          Create a new empty file\n");
-    printf("  rm <name>             Remove a file\n");
+    printf("  touch <name>...       Create new empty files\n");
+    printf("  rm <name>...          Remove files\n");
     printf("  mv <src> <dst>        Move/rename a file\n");
     printf("  cp <src> <dst>        Copy a file\n");
     
@@ -41,8 +57,13 @@ void show_help() {
     printf("  cat <file>            Display file content\n");
     printf("  head <file> <n>       Display first n lines of file\n");
     printf("  tail <file> <n>       Display last n lines of file\n");
+    printf("  lines <file> <a> <b>  Display lines a to b of file\n");
     printf("  echo <text> > <file>  Write text to file\n");
     printf("  echo <text> >> <file> Append text to file\n");
+    printf("  truncate <file> <size> Set file size, extending with unallocated zeros\n");
+    printf("  cat <a> [b...] > <file> Concatenate files into file (>> appends)\n");
+    printf("  <cmd> | grep [-v] <text> Filter command output by text\n");
+    printf("  <cmd> > <file>        Write command output to file (>> appends)\n");
     
     // 列表和树形显示
     printf("\nListing Commands:\n");
@@ -0,0 +1,255 @@
+/**
+* @file hostio.c
+* @brief Transfert de fichiers entre l'hôte et le volume (put / get)
+* @author jzy
+* @date 2025-4-19
+*/
+#define _GNU_SOURCE
+#include "filesystem.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+extern SuperBlock fs;
+
+#define MAX_FILE_SIZE ((size_t)MAX_FILE_PAGES * PAGE_SIZE)
+
+/**
+ * @brief Écrire entièrement un tampon dans un descripteur
+ * @param fd Le descripteur de destination
+ * @param buffer Les données
+ * @param len La longueur des données
+ * @return 0 en cas de succès, -1 en cas d'erreur
+ */
+static int write_all(int fd, const char *buffer, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buffer, len);
+        if (n < 0) return -1;
+        buffer += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copier une étendue du fichier disque vers le fichier hôte sans passer par l'espace utilisateur
+ * @details Essaie copy_file_range, puis sendfile ; renvoie le nombre d'octets effectivement copiés
+ * @param disk_fd Le descripteur du disque virtuel
+ * @param offset La position de l'étendue dans le disque virtuel
+ * @param out_fd Le descripteur du fichier hôte
+ * @param len La longueur de l'étendue
+ * @return Le nombre d'octets copiés par le noyau (peut être inférieur à len)
+ */
+static size_t kernel_copy(int disk_fd, long offset, int out_fd, size_t len) {
+    size_t done = 0;
+#ifdef __linux__
+    off_t in_offset = offset;
+    while (done < len) {
+        ssize_t n = copy_file_range(disk_fd, &in_offset, out_fd, NULL, len - done, 0);
+        if (n <= 0) break;
+        done += n;
+    }
+    // sendfile accepte aussi les systèmes de fichiers sans copy_file_range / sendfile 也支持不提供 copy_file_range 的文件系统
+    while (done < len) {
+        ssize_t n = sendfile(out_fd, disk_fd, &in_offset, len - done);
+        if (n <= 0) break;
+        done += n;
+    }
+#else
+    (void)disk_fd; (void)offset; (void)out_fd; (void)len;
+#endif
+    return done;
+}
+
+/**
+ * @brief Copier un fichier de l'hôte dans le volume
+ * @details Le fichier est lu en une fois puis stocké comme par write, afin de bénéficier
+ *          des checksums, de la déduplication et de la compression
+ * @param host_file Le chemin du fichier sur l'hôte
+ * @param path Le chemin de destination (un fichier, ou un répertoire existant)
+ * @return Aucun
+ */
+void put_file(const char *host_file, const char *path) {
+    load_superblock();
+
+    int fd = open(host_file, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open host file");
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        command_error("Not a regular host file\n");
+        close(fd);
+        return;
+    }
+    if ((size_t)st.st_size > MAX_FILE_SIZE) {
+        command_error("File size exceeds maximum limit\n");
+        close(fd);
+        return;
+    }
+
+    // Destination : répertoire existant, fichier existant ou nouveau fichier / 目标：已有目录、已有文件或新文件
+    char filename[MAX_FILENAME_LENGTH];
+    int parent_inode;
+    int file_inode = get_inode_from_path(path);
+    if (file_inode != -1 && fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
+        file_inode = resolve_symlink(file_inode);
+    }
+    if (file_inode != -1 && fs.inodes[file_inode].file_type == FILE_TYPE_DIR) {
+        parent_inode = file_inode;
+        const char *base = strrchr(host_file, '/');
+        snprintf(filename, sizeof(filename), "%s", base ? base + 1 : host_file);
+        file_inode = find_in_directory(parent_inode, filename);
+    } else {
+        parent_inode = get_parent_directory_inode(path);
+        extract_last_path_component(path, filename);
+    }
+    if (parent_inode == -1 || filename[0] == '\0') {
+        command_error("Parent directory not found\n");
+        close(fd);
+        return;
+    }
+
+    if (file_inode != -1) {
+        if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
+            command_error("Not a regular file\n");
+            close(fd);
+            return;
+        }
+        if (!check_file_permission(file_inode, PERM_WRITE)) {
+            command_error("Permission denied\n");
+            close(fd);
+            return;
+        }
+    } else if (!check_directory_permission(parent_inode, PERM_READ | PERM_WRITE)) {
+        command_error("Permission denied\n");
+        close(fd);
+        return;
+    }
+
+    // Lecture en un seul appel système (la taille est bornée) / 一次系统调用读取（大小有上限）
+    static char data[MAX_FILE_SIZE];
+    size_t len = 0;
+    while (len < (size_t)st.st_size) {
+        ssize_t n = read(fd, data + len, st.st_size - len);
+        if (n <= 0) break;
+        len += n;
+    }
+    close(fd);
+    if (len != (size_t)st.st_size) {
+        command_error("Failed to read host file\n");
+        return;
+    }
+
+    if (file_inode == -1) {
+        file_inode = allocate_inode();
+        if (file_inode == -1) {
+            command_error("No free inodes\n");
+            return;
+        }
+        Inode *inode = &fs.inodes[file_inode];
+        inode->file_type = FILE_TYPE_REGULAR;
+        inode->permissions = PERM_READ | PERM_WRITE;
+        inode->ctime = time(NULL);
+        add_directory_entry(parent_inode, filename, file_inode);
+        fs.inodes[parent_inode].size += sizeof(DirectoryEntry);
+    }
+    if (set_file_contents(&fs.inodes[file_inode], data, len) != 0) {
+        command_error("No free pages available\n");
+        load_superblock();  // Abandonner les modifications en mémoire / 放弃内存中的修改
+        return;
+    }
+    page_cache_invalidate(file_inode);
+    fs.inodes[parent_inode].mtime = fs.inodes[file_inode].mtime;
+
+    save_superblock();
+    printf("Copied %zu bytes into %s\n", len, path);
+}
+
+/**
+ * @brief Copier un fichier du volume vers l'hôte
+ * @details Les pages non compressées sont copiées directement du disque virtuel par le noyau
+ *          (une étendue par page, les pages n'étant pas contiguës sur le disque) et les trous
+ *          restent des trous dans le fichier hôte ;
+ *          les petits fichiers et les fichiers compressés sont écrits depuis la mémoire.
+ *          Les checksums de toutes les pages sont vérifiés avant de créer le fichier hôte
+ * @param path Le chemin du fichier dans le volume
+ * @param host_file Le chemin du fichier sur l'hôte
+ * @return Aucun
+ */
+void get_file(const char *path, const char *host_file) {
+    load_superblock();
+    commit_session();  // Les pages sont copiées depuis le fichier disque / 页面从磁盘文件复制
+
+    int file_inode = get_inode_from_path(path);
+    if (file_inode != -1 && fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
+        file_inode = resolve_symlink(file_inode);
+    }
+    if (file_inode == -1) {
+        command_error("File not found\n");
+        return;
+    }
+    if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
+        command_error("Not a regular file\n");
+        return;
+    }
+    if (!check_file_permission(file_inode, PERM_READ)) {
+        command_error("Permission denied\n");
+        return;
+    }
+    // Une page corrompue n'est pas exportée / 损坏的页面不会被导出
+    if (verify_file_pages(&fs.inodes[file_inode]) != 0) {
+        command_error("File data is corrupted\n");
+        return;
+    }
+
+    int out_fd = open(host_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        perror("Failed to create host file");
+        return;
+    }
+
+    const Inode *inode = &fs.inodes[file_inode];
+    static char data[MAX_FILE_SIZE];
+    int ok = 1;
+    if (inode->compressed || inode->page_count == 0) {
+        ok = read_file_data(inode, 0, inode->size, data) == 0 &&
+             write_all(out_fd, data, inode->size) == 0;
+    } else {
+        // Copier depuis le disque seulement si l'image publiée est celle en mémoire / 仅当已发布的镜像与内存一致时才从磁盘复制
+        lock_disk_image(0);
+        int disk_fd = read_disk_generation() == fs.generation ? open(DISK_FILE, O_RDONLY) : -1;
+        for (int i = 0; ok && (size_t)i * PAGE_SIZE < inode->size; i++) {
+            size_t len = inode->size - (size_t)i * PAGE_SIZE;
+            if (len > PAGE_SIZE) len = PAGE_SIZE;
+            // Un trou reste un trou dans le fichier hôte / 空洞在主机文件中仍为空洞
+            int page = inode->pages[i];
+            if (page == PAGE_HOLE) continue;
+            if (lseek(out_fd, (off_t)i * PAGE_SIZE, SEEK_SET) < 0) {
+                ok = 0;
+                break;
+            }
+            size_t done = disk_fd < 0 ? 0 : kernel_copy(disk_fd, page_disk_offset(page), out_fd, len);
+            // Repli sur une écriture depuis la mémoire / 回退为从内存写入
+            if (done < len) {
+                if (lseek(out_fd, (off_t)i * PAGE_SIZE + done, SEEK_SET) < 0 ||
+                    write_all(out_fd, fs.page_table[page].data + done, len - done) != 0) {
+                    ok = 0;
+                }
+            }
+        }
+        if (disk_fd >= 0) close(disk_fd);
+        unlock_disk_image();
+        if (ok && ftruncate(out_fd, inode->size) != 0) ok = 0;
+    }
+    if (close(out_fd) != 0) ok = 0;
+    if (!ok) {
+        perror("Failed to write host file");
+        return;
+    }
+    printf("Copied %zu bytes to %s\n", (size_t)inode->size, host_file);
+}
@@ -9,13 +9,15 @@
 
 extern SuperBlock fs;
 
+#define MAX_SYMLINK_HOPS 10  // Prévenir les boucles de liens / 防止循环链接
+
 /**
  * @brief Résoudre un lien symbolique et retourner l'inode de la cible
  * @param inode_num Le numéro d'inode du lien symbolique à résoudre
  * @return Le numéro d'inode de la cible du lien, ou -1 en cas d'erreur
  */
 int resolve_symlink(int inode_num) {
-    int max_links = 10;  // Prévenir les boucles de liens / 防止循环链接
+    int max_links = MAX_SYMLINK_HOPS;
     int current = inode_num;
     
     while (max_links > 0 && fs.inodes[current].file_type == FILE_TYPE_SYMLINK) {
@@ -25,13 +27,27 @@ int resolve_symlink(int inode_num) {
     }
     
     if (max_links == 0) {
-        printf("Too many levels of symbolic links\n");
+        command_error("Too many levels of symbolic links\n");
         return -1;
     }
     
     return current;
 }
 
+/**
+ * @brief Résoudre un chemin en suivant les liens symboliques, sans affichage
+ * @param path Le chemin
+ * @return Le numéro d'inode, ou VFS_ERR_NOT_FOUND, VFS_ERR_INVALID (boucle de liens)
+ */
+int lookup_path(const char *path) {
+    int inode_number = get_inode_from_path(path);
+    for (int hops = 0; inode_number != -1 && fs.inodes[inode_number].file_type == FILE_TYPE_SYMLINK; hops++) {
+        if (hops == MAX_SYMLINK_HOPS) return VFS_ERR_INVALID;
+        inode_number = get_inode_from_path(fs.inodes[inode_number].data.symlink_path);
+    }
+    return inode_number == -1 ? VFS_ERR_NOT_FOUND : inode_number;
+}
+
 /**
  * @brief Créer un lien dur vers un fichier existant
  * @param source Le chemin du fichier source
@@ -44,26 +60,26 @@ void link_file(const char *source, const char *link_name) {
     // Obtenir l'inode du fichier source / 获取源文件的 inode
     int src_inode = get_inode_from_path(source);
     if (src_inode == -1) {
-        printf("Source file not found\n");
+        command_error("Source file not found\n");
         return;
     }
 
     // Vérifier s'il s'agit d'un fichier régulier (les liens durs ne peuvent être créés que pour des fichiers réguliers) / 检查是否为普通文件（硬链接只能用于普通文件）
     if (fs.inodes[src_inode].file_type != FILE_TYPE_REGULAR) {
-        printf("Hard links can only be created for regular files\n");
+        command_error("Hard links can only be created for regular files\n");
         return;
     }
 
     // Obtenir l'inode du répertoire parent de destination / 获取目标父目录的 inode
     int dest_parent_inode = get_parent_directory_inode(link_name);
     if (dest_parent_inode == -1) {
-        printf("Destination parent directory not found\n");
+        command_error("Destination parent directory not found\n");
         return;
     }
 
     // Vérifier les permissions d'écriture du répertoire parent / 检查父目录的写权限
     if (!(fs.inodes[dest_parent_inode].permissions & PERM_WRITE)) {
-        printf("Permission denied: parent directory is read-only\n");
+        command_error("Permission denied: parent directory is read-only\n");
         return;
     }
 
@@ -71,7 +87,7 @@ void link_file(const char *source, const char *link_name) {
     char dest_name[MAX_FILENAME_LENGTH];
     extract_last_path_component(link_name, dest_name);
     if (find_in_directory(dest_parent_inode, dest_name) != -1) {
-        printf("Link name already exists\n");
+        command_error("Link name already exists\n");
         return;
     }
 
@@ -98,14 +114,14 @@ void create_symlink(const char *target, const char *linkpath) {
     // Obtenir l'inode du fichier cible (vérifier si la cible existe) / 获取目标文件的 inode（检查目标是否存在）
     int target_inode = get_inode_from_path(target);
     if (target_inode == -1) {
-        printf("Target file not found\n");
+        command_error("Target file not found\n");
         return;
     }
 
     // Obtenir l'inode du répertoire parent du lien symbolique / 获取符号链接的父目录
     int parent_inode = get_parent_directory_inode(linkpath);
     if (parent_inode == -1) {
-        printf("Parent directory not found\n");
+        command_error("Parent directory not found\n");
         return;
     }
 
@@ -113,14 +129,14 @@ void create_symlink(const char *target, const char *linkpath) {
     char link_name[MAX_FILENAME_LENGTH];
     extract_last_path_component(linkpath, link_name);
     if (find_in_directory(parent_inode, link_name) != -1) {
-        printf("Link name already exists\n");
+        command_error("Link name already exists\n");
         return;
     }
 
     // Allouer un nouvel inode / 分配新的 inode
     int new_inode = allocate_inode();
     if (new_inode == -1) {
-        printf("No free inodes available\n");
+        command_error("No free inodes available\n");
         return;
     }
 
@@ -173,20 +189,20 @@ void delete_symlink(const char *path) {
     // Obtenir l'inode du lien symbolique / 获取符号链接的 inode
     int link_inode = get_inode_from_path(path);
     if (link_inode == -1) {
-        printf("Symbolic link not found\n");
+        command_error("Symbolic link not found\n");
         return;
     }
 
     // Vérifier s'il s'agit d'un lien symbolique / 检查是否为符号链接
     if (fs.inodes[link_inode].file_type != FILE_TYPE_SYMLINK) {
-        printf("Not a symbolic link\n");
+        command_error("Not a symbolic link\n");
         return;
     }
 
     // Obtenir l'inode du répertoire parent / 获取父目录 inode
     int parent_inode = get_parent_directory_inode(path);
     if (parent_inode == -1) {
-        printf("Parent directory not found\n");
+        command_error("Parent directory not found\n");
         return;
     }
 
@@ -8,229 +8,226 @@
 
 extern SuperBlock fs;
 
+#define LIST_HIDDEN 1            // Inclure les entrées commençant par '.' / 包含以 '.' 开头的条目
+#define LIST_ANY_PERMISSION 2    // Ne pas vérifier la permission de lecture / 不检查读权限
+
+// Entrée de répertoire copiée par une lecture sans verrou / 无锁读取复制出的目录项
+typedef struct {
+    char name[MAX_FILENAME_LENGTH];
+    int inode_number;
+    unsigned char file_type;
+    unsigned char permissions;
+    int link_count;
+    size_t size;
+    time_t mtime;
+} ListedEntry;
+
 /**
- * @brief Afficher la liste des fichiers du répertoire courant (sans les fichiers cachés)
+ * @brief Copier les métadonnées affichées d'un inode, en recommençant si un écrivain le modifie
+ * @param inode_number Le numéro d'inode
+ * @param entry L'entrée à remplir (le nom n'est pas modifié)
  * @return Aucun
  */
-void show_ls() {
-    load_superblock();
-    
-    int current_inode = get_inode_from_path(current_path);
-    if (current_inode == -1) {
-        printf("Directory not found\n");
-        return;
-    }
-
-    // Vérifier les permissions de lecture du répertoire / 检查目录读权限
-    if (!check_directory_permission(current_inode, PERM_READ)) {
-        printf("Permission denied\n");
-        return;
-    }
-
-    // Collecter tous les noms de fichiers / 收集所有文件名
-    char *filenames[MAX_FILES];
-    int count = 0;
+static void read_listed_inode(int inode_number, ListedEntry *entry) {
+    unsigned int token;
+    do {
+        token = inode_read_begin(inode_number);
+        const Inode *inode = &fs.inodes[inode_number];
+        entry->inode_number = inode_number;
+        entry->file_type = inode->file_type;
+        entry->permissions = inode->permissions;
+        entry->link_count = inode->link_count;
+        entry->size = inode->size;
+        entry->mtime = inode->mtime;
+    } while (inode_read_retry(inode_number, token));
+}
 
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (fs.directory[i].parent_inode == current_inode && 
-            fs.directory[i].name[0] != '\0' && 
-            fs.directory[i].name[0] != '.' &&    // Ignorer les fichiers cachés / 跳过隐藏文件
-            fs.directory[i].inode_number != -1) {
-            filenames[count] = fs.directory[i].name;
-            count++;
+/**
+ * @brief Lire les entrées d'un répertoire sans prendre de verrou
+ * @details La lecture est recommencée si l'arborescence change pendant qu'elle se fait,
+ *          les lecteurs n'écrivent donc jamais en mémoire partagée
+ * @param path Le chemin du répertoire
+ * @param options LIST_HIDDEN, LIST_ANY_PERMISSION
+ * @param entries Tableau de MAX_FILES entrées, rempli dans l'ordre de la table des répertoires
+ * @return Le nombre d'entrées, ou VFS_ERR_NOT_FOUND, VFS_ERR_NOT_DIR, VFS_ERR_PERMISSION
+ */
+static int read_directory(const char *path, int options, ListedEntry *entries) {
+    int count;
+    unsigned int token;
+    do {
+        token = namespace_read_begin();
+        int dir_inode = get_inode_from_path(path);
+        if (dir_inode == -1) {
+            count = VFS_ERR_NOT_FOUND;
+        } else if (fs.inodes[dir_inode].file_type != FILE_TYPE_DIR) {
+            count = VFS_ERR_NOT_DIR;
+        } else if (!(options & LIST_ANY_PERMISSION) && !check_directory_permission(dir_inode, PERM_READ)) {
+            count = VFS_ERR_PERMISSION;
+        } else {
+            count = 0;
+            for (int i = 0; i < MAX_FILES; i++) {
+                const DirectoryEntry *dirent = &fs.directory[i];
+                int target = dirent->inode_number;
+                if (dirent->parent_inode != dir_inode || target < 0 || target >= MAX_FILES ||
+                    dirent->name[0] == '\0' ||
+                    (!(options & LIST_HIDDEN) && dirent->name[0] == '.')) {  // Fichiers cachés / 隐藏文件
+                    continue;
+                }
+                ListedEntry *entry = &entries[count++];
+                strncpy(entry->name, dirent->name, MAX_FILENAME_LENGTH - 1);
+                entry->name[MAX_FILENAME_LENGTH - 1] = '\0';
+                read_listed_inode(target, entry);
+            }
         }
-    }
+    } while (namespace_read_retry(token));
+    return count;
+}
 
-    // Trier par ordre alphabétique / 按字母顺序排序
+/**
+ * @brief Trier des entrées par ordre alphabétique
+ * @param sorted Tableau de pointeurs vers les entrées, trié sur place
+ * @param count Le nombre d'entrées
+ * @return Aucun
+ */
+static void sort_entries(ListedEntry **sorted, int count) {
     for (int i = 0; i < count - 1; i++) {
         for (int j = i + 1; j < count; j++) {
-            if (strcmp(filenames[i], filenames[j]) > 0) {
-                char *temp = filenames[i];
-                filenames[i] = filenames[j];
-                filenames[j] = temp;
+            if (strcmp(sorted[i]->name, sorted[j]->name) > 0) {
+                ListedEntry *temp = sorted[i];
+                sorted[i] = sorted[j];
+                sorted[j] = temp;
             }
         }
     }
-
-    // Afficher les noms de fichiers / 打印文件名
-    for (int i = 0; i < count; i++) {
-        printf("%s\n", filenames[i]);
-    }
-
-    save_superblock();
 }
 
 /**
- * @brief Afficher la liste de tous les fichiers du répertoire courant (y compris les fichiers cachés)
+ * @brief Afficher les noms d'un répertoire triés par ordre alphabétique
+ * @param options LIST_HIDDEN pour inclure les fichiers cachés
  * @return Aucun
  */
-void show_ls_all() {
-    load_superblock();
-    
-    int current_inode = get_inode_from_path(current_path);
-    if (current_inode == -1) {
-        printf("Directory not found\n");
+static void print_sorted_names(int options) {
+    ListedEntry entries[MAX_FILES];
+    int count = read_directory(current_path, options, entries);
+    if (count == VFS_ERR_NOT_FOUND) {
+        command_error("Directory not found\n");
         return;
     }
-
-    // Vérifier les permissions de lecture du répertoire / 检查目录读权限
-    if (!check_directory_permission(current_inode, PERM_READ)) {
-        printf("Permission denied\n");
+    if (count < 0) {
+        command_error("Permission denied\n");
         return;
     }
 
-    // Collecter tous les noms de fichiers (y compris les fichiers cachés) / 收集所有文件名（包括隐藏文件）
-    char *filenames[MAX_FILES];
-    int count = 0;
-
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (fs.directory[i].parent_inode == current_inode && 
-            fs.directory[i].name[0] != '\0' && 
-            fs.directory[i].inode_number != -1) {
-            filenames[count] = fs.directory[i].name;
-            count++;
-        }
-    }
-
     // Trier par ordre alphabétique / 按字母顺序排序
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = i + 1; j < count; j++) {
-            if (strcmp(filenames[i], filenames[j]) > 0) {
-                char *temp = filenames[i];
-                filenames[i] = filenames[j];
-                filenames[j] = temp;
-            }
-        }
-    }
+    ListedEntry *sorted[MAX_FILES];
+    for (int i = 0; i < count; i++) sorted[i] = &entries[i];
+    sort_entries(sorted, count);
 
     // Afficher les noms de fichiers / 打印文件名
     for (int i = 0; i < count; i++) {
-        printf("%s\n", filenames[i]);
+        printf("%s\n", sorted[i]->name);
     }
-
-    save_superblock();
 }
 
 /**
- * @brief Afficher la liste détaillée de tous les fichiers du répertoire courant (y compris les fichiers cachés)
+ * @brief Afficher une ligne de la liste détaillée
+ * @param entry L'entrée à afficher
  * @return Aucun
  */
-void show_list_all() {
-    load_superblock();
-    
-    int current_inode = get_inode_from_path(current_path);
-    if (current_inode == -1) {
-        printf("Directory not found\n");
-        return;
+static void print_list_row(const ListedEntry *entry) {
+    // Type de fichier / 文件类型
+    char type;
+    switch (entry->file_type) {
+        case FILE_TYPE_REGULAR: type = '-'; break;
+        case FILE_TYPE_DIR: type = 'd'; break;
+        case FILE_TYPE_SYMLINK: type = 'l'; break;
+        default: type = '?';
     }
 
-    printf("%-4s %-10s %-4s %-8s %-20s %-s\n", 
-           "Type", "Perms", "Links", "Size", "Modified", "Name");
-    printf("----------------------------------------------------------\n");
+    // Permissions / 权限
+    char perms[4];
+    perms[0] = (entry->permissions & PERM_READ) ? 'r' : '-';
+    perms[1] = (entry->permissions & PERM_WRITE) ? 'w' : '-';
+    perms[2] = (entry->permissions & PERM_EXECUTE) ? 'x' : '-';
+    perms[3] = '\0';
 
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (fs.directory[i].parent_inode == current_inode && 
-            fs.directory[i].name[0] != '\0' && 
-            fs.directory[i].inode_number != -1) {
-            
-            Inode *inode = &fs.inodes[fs.directory[i].inode_number];
-            
-            // Type de fichier / 文件类型
-            char type;
-            switch (inode->file_type) {
-                case FILE_TYPE_REGULAR: type = '-'; break;
-                case FILE_TYPE_DIR: type = 'd'; break;
-                case FILE_TYPE_SYMLINK: type = 'l'; break;
-                default: type = '?';
-            }
-            
-            // Permissions / 权限
-            char perms[4];
-            perms[0] = (inode->permissions & PERM_READ) ? 'r' : '-';
-            perms[1] = (inode->permissions & PERM_WRITE) ? 'w' : '-';
-            perms[2] = (inode->permissions & PERM_EXECUTE) ? 'x' : '-';
-            perms[3] = '\0';
-            
-            // Heure de modification / 修改时间
-            char mtime_str[20];
-            strftime(mtime_str, sizeof(mtime_str), "%Y-%m-%d %H:%M:%S", 
-                    localtime(&inode->mtime));
-            
-            printf("%-4c %-10s %-4d %-8zu %-20s %s\n",
-                   type,
-                   perms,
-                   inode->link_count,
-                   inode->size,
-                   mtime_str,
-                   fs.directory[i].name);
-        }
-    }
-    
-    save_superblock();
+    // Heure de modification / 修改时间
+    char mtime_str[20];
+    struct tm mtime_tm;
+    strftime(mtime_str, sizeof(mtime_str), "%Y-%m-%d %H:%M:%S",
+            localtime_r(&entry->mtime, &mtime_tm));
+
+    printf("%-4c %-10s %-4d %-8zu %-20s %s\n",
+           type,
+           perms,
+           entry->link_count,
+           entry->size,
+           mtime_str,
+           entry->name);
 }
 
 /**
- * @brief Afficher la liste détaillée des fichiers du répertoire courant (sans les fichiers cachés)
+ * @brief Afficher la liste détaillée d'un répertoire
+ * @param options LIST_HIDDEN, LIST_ANY_PERMISSION
  * @return Aucun
  */
-void show_list() {
-    load_superblock();
-    
-    int current_inode = get_inode_from_path(current_path);
-    if (current_inode == -1) {
-        printf("Directory not found\n");
+static void print_list(int options) {
+    ListedEntry entries[MAX_FILES];
+    int count = read_directory(current_path, options, entries);
+    if (count == VFS_ERR_NOT_FOUND) {
+        command_error("Directory not found\n");
         return;
     }
-
-    // Vérifier les permissions de lecture / 检查是否有读权限
-    if (!check_directory_permission(current_inode, PERM_READ)) {
-        printf("Permission denied\n");
+    if (count < 0 && !(options & LIST_ANY_PERMISSION)) {
+        command_error("Permission denied\n");
         return;
     }
 
     printf("%-4s %-10s %-4s %-8s %-20s %-s\n", 
            "Type", "Perms", "Links", "Size", "Modified", "Name");
     printf("----------------------------------------------------------\n");
-
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (fs.directory[i].parent_inode == current_inode && 
-            fs.directory[i].name[0] != '\0' && 
-            fs.directory[i].name[0] != '.' &&    // Ignorer les fichiers cachés / 跳过隐藏文件
-            fs.directory[i].inode_number != -1) {
-            
-            Inode *inode = &fs.inodes[fs.directory[i].inode_number];
-            
-            // Type de fichier / 文件类型
-            char type;
-            switch (inode->file_type) {
-                case FILE_TYPE_REGULAR: type = '-'; break;
-                case FILE_TYPE_DIR: type = 'd'; break;
-                case FILE_TYPE_SYMLINK: type = 'l'; break;
-                default: type = '?';
-            }
-            
-            // Permissions / 权限
-            char perms[4];
-            perms[0] = (inode->permissions & PERM_READ) ? 'r' : '-';
-            perms[1] = (inode->permissions & PERM_WRITE) ? 'w' : '-';
-            perms[2] = (inode->permissions & PERM_EXECUTE) ? 'x' : '-';
-            perms[3] = '\0';
-            
-            // Heure de modification / 修改时间
-            char mtime_str[20];
-            strftime(mtime_str, sizeof(mtime_str), "%Y-%m-%d %H:%M:%S", 
-                    localtime(&inode->mtime));
-            
-            printf("%-4c %-10s %-4d %-8zu %-20s %s\n",
-                   type,
-                   perms,
-                   inode->link_count,
-                   inode->size,
-                   mtime_str,
-                   fs.directory[i].name);
-        }
+    for (int i = 0; i < count; i++) {
+        print_list_row(&entries[i]);
     }
-    
+}
+
+/**
+ * @brief Afficher la liste des fichiers du répertoire courant (sans les fichiers cachés)
+ * @return Aucun
+ */
+void show_ls() {
+    load_superblock();
+    print_sorted_names(0);
+    save_superblock();
+}
+
+/**
+ * @brief Afficher la liste de tous les fichiers du répertoire courant (y compris les fichiers cachés)
+ * @return Aucun
+ */
+void show_ls_all() {
+    load_superblock();
+    print_sorted_names(LIST_HIDDEN);
+    save_superblock();
+}
+
+/**
+ * @brief Afficher la liste détaillée de tous les fichiers du répertoire courant (y compris les fichiers cachés)
+ * @return Aucun
+ */
+void show_list_all() {
+    load_superblock();
+    print_list(LIST_HIDDEN | LIST_ANY_PERMISSION);
+    save_superblock();
+}
+
+/**
+ * @brief Afficher la liste détaillée des fichiers du répertoire courant (sans les fichiers cachés)
+ * @return Aucun
+ */
+void show_list() {
+    load_superblock();
+    print_list(0);
     save_superblock();
 }
 
@@ -241,53 +238,40 @@ void show_list() {
  */
 void show_list_one(const char *path) {
     load_superblock();
-    
-    int inode_num = get_inode_from_path(path);
-    if (inode_num == -1) {
-        printf("File or directory not found\n");
-        return;
-    }
 
-    Inode *inode = &fs.inodes[inode_num];
-    
-    // Vérifier les permissions de lecture / 检查读权限
-    if(inode->file_type == FILE_TYPE_DIR) {
-        if (!check_directory_permission(inode_num, PERM_READ)) {
-            printf("Permission denied\n");
-            return;
+    // Lire l'inode et la cible d'un lien sans verrou / 无锁读取 inode 和链接目标
+    ListedEntry entry;
+    char target[MAX_PATH_LENGTH];
+    int status;
+    unsigned int token;
+    do {
+        token = namespace_read_begin();
+        int inode_num = get_inode_from_path(path);
+        status = 0;
+        if (inode_num == -1) {
+            status = VFS_ERR_NOT_FOUND;
+        } else if (fs.inodes[inode_num].file_type == FILE_TYPE_DIR ?
+                   !check_directory_permission(inode_num, PERM_READ) :
+                   !check_file_permission(inode_num, PERM_READ)) {
+            status = VFS_ERR_PERMISSION;
+        } else {
+            read_listed_inode(inode_num, &entry);
+            strncpy(target, fs.inodes[inode_num].data.symlink_path, MAX_PATH_LENGTH - 1);
+            target[MAX_PATH_LENGTH - 1] = '\0';
         }
-    }else{
-        if (!check_file_permission(inode_num, PERM_READ)) {
-            printf("Permission denied\n");
-            return;
-        }
-    }
-    
+    } while (namespace_read_retry(token));
 
-    // Type de fichier / 文件类型
-    char type;
-    switch (inode->file_type) {
-        case FILE_TYPE_REGULAR: type = '-'; break;
-        case FILE_TYPE_DIR: type = 'd'; break;
-        case FILE_TYPE_SYMLINK: type = 'l'; break;
-        default: type = '?';
+    if (status == VFS_ERR_NOT_FOUND) {
+        command_error("File or directory not found\n");
+        return;
     }
-    
-    // Permissions / 权限
-    char perms[4];
-    perms[0] = (inode->permissions & PERM_READ) ? 'r' : '-';
-    perms[1] = (inode->permissions & PERM_WRITE) ? 'w' : '-';
-    perms[2] = (inode->permissions & PERM_EXECUTE) ? 'x' : '-';
-    perms[3] = '\0';
-    
-    // Heure de modification / 修改时间
-    char mtime_str[20];
-    strftime(mtime_str, sizeof(mtime_str), "%Y-%m-%d %H:%M:%S", 
-            localtime(&inode->mtime));
-    
+    if (status == VFS_ERR_PERMISSION) {
+        command_error("Permission denied\n");
+        return;
+    }
+
     // Obtenir le nom du fichier / 获取文件名
-    char filename[MAX_FILENAME_LENGTH];
-    extract_last_path_component(path, filename);
+    extract_last_path_component(path, entry.name);
 
     // Afficher l'en-tête / 打印表头
     printf("%-4s %-10s %-4s %-8s %-20s %-s\n", 
@@ -295,17 +279,11 @@ void show_list_one(const char *path) {
     printf("----------------------------------------------------------\n");
 
     // Afficher les informations du fichier / 打印文件信息
-    printf("%-4c %-10s %-4d %-8zu %-20s %s\n",
-           type,
-           perms,
-           inode->link_count,
-           inode->size,
-           mtime_str,
-           filename);
+    print_list_row(&entry);
 
     // Si c'est un lien symbolique, afficher la cible / 如果是符号链接，显示链接目标
-    if (inode->file_type == FILE_TYPE_SYMLINK) {
-        printf(" -> %s\n", inode->data.symlink_path);
+    if (entry.file_type == FILE_TYPE_SYMLINK) {
+        printf(" -> %s\n", target);
     }
     
     save_superblock();
@@ -317,43 +295,41 @@ void show_list_one(const char *path) {
  */
 void list_file_dir() {
     load_superblock();
-    
-    int current_inode = get_inode_from_path(current_path);
-    if (current_inode == -1 || fs.inodes[current_inode].file_type != FILE_TYPE_DIR) {
-        printf("Not a directory\n");
+
+    ListedEntry entries[MAX_FILES];
+    int count = read_directory(current_path, LIST_HIDDEN, entries);
+    if (count == VFS_ERR_NOT_FOUND || count == VFS_ERR_NOT_DIR) {
+        command_error("Not a directory\n");
         return;
     }
 
     // Vérifier les permissions de lecture / 检查是否有读权限
-    if (!check_directory_permission(current_inode, PERM_READ)) {
-        printf("Permission denied\n");
+    if (count == VFS_ERR_PERMISSION) {
+        command_error("Permission denied\n");
         return;
     }
 
     printf("%-8s %-12s %-8s\n", "Inode", "Type", "Name");
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (fs.directory[i].parent_inode == current_inode && fs.directory[i].name[0] != '\0' && fs.directory[i].inode_number != -1) {
-            Inode *inode = &fs.inodes[fs.directory[i].inode_number];
-            char *type;
-            switch (inode->file_type) {
-                case 1:
-                    type = "FILE";
-                    break;
-                case 2:
-                    type = "DIR";
-                    break;
-                case 3:
-                    type = "SYMLINK";
-                    break;
-                default:
-                    type = "UNKNOWN";
-                    break;
-            }
-            printf("%-8d %-12s %-8s\n", 
-                   fs.directory[i].inode_number,
-                   type,
-                   fs.directory[i].name);
+    for (int i = 0; i < count; i++) {
+        char *type;
+        switch (entries[i].file_type) {
+            case 1:
+                type = "FILE";
+                break;
+            case 2:
+                type = "DIR";
+                break;
+            case 3:
+                type = "SYMLINK";
+                break;
+            default:
+                type = "UNKNOWN";
+                break;
         }
+        printf("%-8d %-12s %-8s\n", 
+               entries[i].inode_number,
+               type,
+               entries[i].name);
     }
     
     save_superblock();
@@ -366,10 +342,15 @@ void list_file_dir() {
  */
 void show_inode(const char *path) {
     load_superblock();
-    
-    int inode_num = get_inode_from_path(path);
+
+    int inode_num;
+    unsigned int token;
+    do {
+        token = namespace_read_begin();
+        inode_num = get_inode_from_path(path);
+    } while (namespace_read_retry(token));
     if (inode_num == -1) {
-        printf("Path not found\n");
+        command_error("Path not found\n");
         return;
     }
 
@@ -459,12 +440,12 @@ void show_tree() {
     
     int current_inode = get_inode_from_path(current_path);
     if (current_inode == -1) {
-        printf("Directory not found\n");
+        command_error("Directory not found\n");
         return;
     }
 
     if (!check_directory_permission(current_inode, PERM_READ)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
@@ -558,12 +539,12 @@ void show_tree_inodes() {
     
     int current_inode = get_inode_from_path(current_path);
     if (current_inode == -1) {
-        printf("Directory not found\n");
+        command_error("Directory not found\n");
         return;
     }
 
     if (!check_directory_permission(current_inode, PERM_READ)) {
-        printf("Permission denied\n");
+        command_error("Permission denied\n");
         return;
     }
 
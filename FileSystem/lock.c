@@ -0,0 +1,396 @@
+/**
+* @file lock.c
+* @brief Verrous lecteurs-rédacteurs du volume et des inodes, verrous des allocateurs
+* @details Un hôte multithread active locking_enabled dans une session :
+*          le superbloc reste alors en mémoire et chaque commande prend le verrou du volume en
+*          partage, puis les verrous de ses inodes par numéro croissant (en partage pour lire,
+*          en exclusif pour modifier une cible et son répertoire parent). Les commandes qui
+*          modifient l'arborescence ou tout le volume prennent le verrou du volume en exclusif.
+*          Les listes de répertoires lisent sans verrou, validées par des compteurs de séquence.
+* @author jzy
+* @date 2025-4-21
+*/
+#define _GNU_SOURCE
+#include "filesystem.h"
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+// Verrous sur un descripteur ouvert (Linux) : non relâchés par le fclose d'un autre descripteur.
+// Ailleurs, les verrous POSIX classiques sont relâchés à chaque fclose du fichier disque /
+// 基于打开文件描述的锁（Linux）：不会因关闭其他描述符而释放；其他系统上的 POSIX 锁会在关闭磁盘文件时释放
+#ifndef F_OFD_SETLKW
+#define F_OFD_SETLKW F_SETLKW
+#endif
+
+#define DISK_WRITER_BYTE 0  // Octet verrouillé par le processus rédacteur / 写者进程锁定的字节
+#define DISK_IMAGE_BYTE 1   // Octet verrouillé pendant la lecture ou l'écriture de l'image / 读写镜像期间锁定的字节
+
+extern SuperBlock fs;
+
+int locking_enabled = 0;
+
+static pthread_once_t locks_once = PTHREAD_ONCE_INIT;
+static pthread_rwlock_t volume_lock;                 // Arborescence et volume entier / 目录树和整个卷
+static pthread_rwlock_t inode_locks[MAX_FILES];      // Un verrou par inode / 每个 inode 一把锁
+static pthread_mutex_t page_lock;                    // Allocateur et compteurs de pages (récursif) / 页面分配器和引用计数（可重入）
+static pthread_mutex_t inode_allocator_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t directory_slot_lock = PTHREAD_MUTEX_INITIALIZER;
+static int disk_lock_fd = -1;                        // Descripteur portant les verrous entre processus / 承载进程间锁的描述符
+
+// Compteurs de séquence : impairs pendant une écriture / 序列计数器：写入期间为奇数
+static unsigned int namespace_seq;                   // Arborescence (écrivains du volume entier) / 目录树（整卷写者）
+static unsigned int inode_seq[MAX_FILES];            // Métadonnées de chaque inode / 每个 inode 的元数据
+
+/**
+ * @brief Initialiser les verrous au premier usage
+ * @return Aucun
+ */
+static void init_locks() {
+    pthread_rwlock_init(&volume_lock, NULL);
+    for (int i = 0; i < MAX_FILES; i++) {
+        pthread_rwlock_init(&inode_locks[i], NULL);
+    }
+    // unshare_page et dedup_page appellent les autres fonctions de l'allocateur / unshare_page 和 dedup_page 会调用分配器的其他函数
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&page_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/**
+ * @brief Prendre le verrou du volume
+ * @param exclusive 1 pour un accès exclusif, 0 pour un accès partagé
+ * @return Aucun
+ */
+void lock_volume(int exclusive) {
+    pthread_once(&locks_once, init_locks);
+    if (exclusive) pthread_rwlock_wrlock(&volume_lock);
+    else pthread_rwlock_rdlock(&volume_lock);
+}
+
+/**
+ * @brief Relâcher le verrou du volume
+ * @return Aucun
+ */
+void unlock_volume() {
+    pthread_rwlock_unlock(&volume_lock);
+}
+
+/**
+ * @brief Prendre le verrou de l'allocateur de pages (allocation, références, pages partagées)
+ * @return Aucun
+ */
+void lock_pages() {
+    pthread_once(&locks_once, init_locks);
+    pthread_mutex_lock(&page_lock);
+}
+
+/**
+ * @brief Relâcher le verrou de l'allocateur de pages
+ * @return Aucun
+ */
+void unlock_pages() {
+    pthread_mutex_unlock(&page_lock);
+}
+
+/**
+ * @brief Prendre le verrou de l'allocateur d'inodes
+ * @return Aucun
+ */
+void lock_inode_allocator() {
+    pthread_mutex_lock(&inode_allocator_lock);
+}
+
+/**
+ * @brief Relâcher le verrou de l'allocateur d'inodes
+ * @return Aucun
+ */
+void unlock_inode_allocator() {
+    pthread_mutex_unlock(&inode_allocator_lock);
+}
+
+/**
+ * @brief Prendre le verrou des emplacements libres de la table des répertoires
+ * @return Aucun
+ */
+void lock_directory_slots() {
+    pthread_mutex_lock(&directory_slot_lock);
+}
+
+/**
+ * @brief Relâcher le verrou des emplacements de la table des répertoires
+ * @return Aucun
+ */
+void unlock_directory_slots() {
+    pthread_mutex_unlock(&directory_slot_lock);
+}
+
+/**
+ * @brief Poser ou retirer un verrou fcntl sur un octet du fichier disque
+ * @param byte L'octet (DISK_WRITER_BYTE ou DISK_IMAGE_BYTE)
+ * @param type F_RDLCK, F_WRLCK ou F_UNLCK
+ * @return Aucun (sans fichier disque, il n'y a rien à protéger)
+ */
+static void set_disk_lock(int byte, short type) {
+    if (disk_lock_fd < 0) {
+        disk_lock_fd = open(DISK_FILE, read_only_mount ? O_RDONLY : O_RDWR);
+        if (disk_lock_fd < 0) return;
+    }
+    struct flock lock = { .l_type = type, .l_whence = SEEK_SET, .l_start = byte, .l_len = 1 };
+    while (fcntl(disk_lock_fd, F_OFD_SETLKW, &lock) != 0) {
+        if (errno != EINTR) {
+            perror("Failed to lock virtual disk");
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Prendre le verrou de l'image disque
+ * @param exclusive 1 pour y écrire, 0 pour la lire (les lecteurs ne s'attendent pas entre eux)
+ * @return Aucun
+ */
+void lock_disk_image(int exclusive) {
+    set_disk_lock(DISK_IMAGE_BYTE, exclusive ? F_WRLCK : F_RDLCK);
+}
+
+/**
+ * @brief Relâcher le verrou de l'image disque
+ * @return Aucun
+ */
+void unlock_disk_image() {
+    set_disk_lock(DISK_IMAGE_BYTE, F_UNLCK);
+}
+
+/**
+ * @brief Devenir le processus rédacteur du volume, en attendant le rédacteur actuel
+ * @return Aucun
+ */
+void lock_disk_writer() {
+    set_disk_lock(DISK_WRITER_BYTE, F_WRLCK);
+}
+
+/**
+ * @brief Cesser d'être le processus rédacteur
+ * @return Aucun
+ */
+void unlock_disk_writer() {
+    set_disk_lock(DISK_WRITER_BYTE, F_UNLCK);
+}
+
+/**
+ * @brief Après un fork, utiliser un descripteur propre pour les verrous entre processus
+ * @details Les verrous fcntl sont portés par la description de fichier ouverte, partagée avec le père
+ * @return Aucun
+ */
+void detach_disk_locks() {
+    if (disk_lock_fd >= 0) close(disk_lock_fd);
+    disk_lock_fd = -1;
+}
+
+/**
+ * @brief Attendre qu'un compteur de séquence soit pair et le lire
+ * @param seq Le compteur
+ * @return La valeur lue, à repasser à seq_read_retry
+ */
+static unsigned int seq_read_begin(const unsigned int *seq) {
+    unsigned int value;
+    while ((value = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1) {
+        sched_yield();
+    }
+    return value;
+}
+
+/**
+ * @brief Indiquer si une lecture optimiste doit être recommencée
+ * @param seq Le compteur
+ * @param value La valeur renvoyée par seq_read_begin
+ * @return 1 si un écrivain est passé pendant la lecture, 0 sinon
+ */
+static int seq_read_retry(const unsigned int *seq, unsigned int value) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(seq, __ATOMIC_RELAXED) != value;
+}
+
+/**
+ * @brief Commencer ou terminer une écriture protégée par un compteur de séquence
+ * @param seq Le compteur (déjà protégé par un verrou exclusif)
+ * @return Aucun
+ */
+static void seq_write_step(unsigned int *seq) {
+    __atomic_add_fetch(seq, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Commencer une lecture optimiste de l'arborescence, sans écrire en mémoire partagée
+ * @details Les entrées de répertoire et les inodes sont des emplacements de tableaux fixes : une
+ *          lecture concurrente d'un objet libéré reste valide en mémoire, elle est seulement recommencée
+ * @return Le jeton à passer à namespace_read_retry
+ */
+unsigned int namespace_read_begin() {
+    return seq_read_begin(&namespace_seq);
+}
+
+/**
+ * @brief Vérifier une lecture optimiste de l'arborescence
+ * @param token Le jeton renvoyé par namespace_read_begin
+ * @return 1 si l'arborescence a changé pendant la lecture, 0 sinon
+ */
+int namespace_read_retry(unsigned int token) {
+    return seq_read_retry(&namespace_seq, token);
+}
+
+/**
+ * @brief Signaler le début d'une modification de l'arborescence, sous le verrou exclusif du volume
+ * @return Aucun
+ */
+void namespace_write_begin() {
+    seq_write_step(&namespace_seq);
+}
+
+/**
+ * @brief Signaler la fin d'une modification de l'arborescence
+ * @return Aucun
+ */
+void namespace_write_end() {
+    seq_write_step(&namespace_seq);
+}
+
+/**
+ * @brief Commencer une lecture optimiste des métadonnées d'un inode
+ * @param inode_number Le numéro d'inode
+ * @return Le jeton à passer à inode_read_retry
+ */
+unsigned int inode_read_begin(int inode_number) {
+    return seq_read_begin(&inode_seq[inode_number]);
+}
+
+/**
+ * @brief Vérifier une lecture optimiste des métadonnées d'un inode
+ * @param inode_number Le numéro d'inode
+ * @param token Le jeton renvoyé par inode_read_begin
+ * @return 1 si l'inode a été modifié pendant la lecture, 0 sinon
+ */
+int inode_read_retry(int inode_number, unsigned int token) {
+    return seq_read_retry(&inode_seq[inode_number], token);
+}
+
+/**
+ * @brief Vider un ensemble de verrous d'inodes
+ * @param set L'ensemble
+ * @return Aucun
+ */
+void lock_set_init(LockSet *set) {
+    set->count = 0;
+    set->overflow = 0;
+}
+
+/**
+ * @brief Ajouter un inode à un ensemble de verrous
+ * @param set L'ensemble
+ * @param inode_number Le numéro d'inode (ignoré s'il est invalide)
+ * @param exclusive 1 pour un accès exclusif, 0 pour un accès partagé
+ * @return Aucun
+ */
+void lock_set_add(LockSet *set, int inode_number, int exclusive) {
+    if (inode_number < 0 || inode_number >= MAX_FILES) return;
+    if (set->count == MAX_FILES) {
+        set->overflow = 1;
+        return;
+    }
+    set->inodes[set->count] = inode_number;
+    set->exclusive[set->count] = (unsigned char)exclusive;
+    set->count++;
+}
+
+/**
+ * @brief Ajouter en partage les entrées d'un répertoire à un ensemble de verrous
+ * @param set L'ensemble
+ * @param dir_inode Le numéro d'inode du répertoire
+ * @param recursive 1 pour ajouter toute la sous-arborescence, 0 pour les seules entrées directes
+ * @return Aucun
+ */
+void lock_set_add_children(LockSet *set, int dir_inode, int recursive) {
+    int queue[MAX_FILES];
+    int head = 0, tail = 0;
+    queue[tail++] = dir_inode;
+    while (head < tail && !set->overflow) {
+        int dir = queue[head++];
+        for (int i = 0; i < MAX_FILES; i++) {
+            const DirectoryEntry *entry = &fs.directory[i];
+            if (entry->inode_number == -1 || entry->parent_inode != dir ||
+                strcmp(entry->name, ".") == 0 || strcmp(entry->name, "..") == 0) {
+                continue;
+            }
+            lock_set_add(set, entry->inode_number, 0);
+            if (recursive && tail < MAX_FILES && entry->inode_number != dir &&
+                fs.inodes[entry->inode_number].file_type == FILE_TYPE_DIR) {
+                queue[tail++] = entry->inode_number;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Comparer deux clés de verrou pour qsort
+ * @param a La première clé
+ * @param b La seconde clé
+ * @return Négatif, nul ou positif selon l'ordre des clés
+ */
+static int compare_lock_entries(const void *a, const void *b) {
+    const long *x = a, *y = b;
+    return (*x > *y) - (*x < *y);
+}
+
+/**
+ * @brief Prendre tous les verrous d'un ensemble, par numéro d'inode croissant
+ * @details L'ordre croissant évite les interblocages entre commandes ; un inode présent plusieurs
+ *          fois n'est verrouillé qu'une fois, en exclusif si une des demandes l'est
+ * @param set L'ensemble (trié et dédoublonné sur place)
+ * @return Aucun
+ */
+void lock_set_acquire(LockSet *set) {
+    pthread_once(&locks_once, init_locks);
+
+    // Clé de tri : numéro d'inode, puis exclusif avant partagé / 排序键：inode 编号，独占在共享之前
+    long keys[MAX_FILES];
+    for (int i = 0; i < set->count; i++) {
+        keys[i] = (long)set->inodes[i] * 2 + !set->exclusive[i];
+    }
+    qsort(keys, set->count, sizeof(long), compare_lock_entries);
+    int count = 0;
+    for (int i = 0; i < set->count; i++) {
+        int inode_number = (int)(keys[i] / 2);
+        if (count > 0 && set->inodes[count - 1] == inode_number) continue;
+        set->inodes[count] = inode_number;
+        set->exclusive[count] = !(keys[i] % 2);
+        count++;
+    }
+    set->count = count;
+
+    for (int i = 0; i < set->count; i++) {
+        if (set->exclusive[i]) {
+            pthread_rwlock_wrlock(&inode_locks[set->inodes[i]]);
+            seq_write_step(&inode_seq[set->inodes[i]]);
+        } else {
+            pthread_rwlock_rdlock(&inode_locks[set->inodes[i]]);
+        }
+    }
+}
+
+/**
+ * @brief Relâcher tous les verrous d'un ensemble
+ * @param set L'ensemble, déjà acquis
+ * @return Aucun
+ */
+void lock_set_release(LockSet *set) {
+    for (int i = set->count - 1; i >= 0; i--) {
+        if (set->exclusive[i]) seq_write_step(&inode_seq[set->inodes[i]]);
+        pthread_rwlock_unlock(&inode_locks[set->inodes[i]]);
+    }
+}
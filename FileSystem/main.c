@@ -7,105 +7,185 @@
 #include "filesystem.h"
 #include <stdio.h>
 #include <string.h>
-#include <sys/stat.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+
+static volatile sig_atomic_t shell_stop = 0;
+static volatile sig_atomic_t flush_due = 0;
+
+/**
+ * @brief Demander l'arrêt du shell (SIGINT, SIGTERM)
+ * @details La lecture en cours est interrompue ; les ajouts en attente sont écrits en sortant de la boucle
+ * @param sig Le signal reçu
+ * @return Aucun
+ */
+static void handle_stop(int sig) {
+    (void)sig;
+    shell_stop = 1;
+}
+
+/**
+ * @brief Signaler que l'attente d'une commande a duré APPEND_FLUSH_SECONDS (SIGALRM)
+ * @details La lecture en cours est interrompue pour écrire les ajouts expirés, puis reprend
+ * @param sig Le signal reçu
+ * @return Aucun
+ */
+static void handle_alarm(int sig) {
+    (void)sig;
+    flush_due = 1;
+}
 
 /**
  * @brief Fonction principale du système de fichiers virtuel
- * @details Gère la boucle principale du shell et traite les commandes utilisateur
- * @return 0 en cas de succès
+ * @details Gère la boucle principale du shell et traite les commandes utilisateur.
+ *          Avec -f <script>, ou quand l'entrée standard n'est pas un terminal, les commandes
+ *          sont exécutées en mode script : sans invite ni confirmation, dans une seule session
+ *          validée à la fin (ou toutes les N commandes avec -n N).
+ *          Avec -s <socket>, le programme sert le volume à plusieurs clients ; avec -c <socket>,
+ *          les commandes sont envoyées à ce serveur. Avec -r, le volume est monté en lecture seule :
+ *          plusieurs processus peuvent le lire en parallèle pendant qu'un autre le modifie.
+ *          SIGINT et SIGTERM terminent le shell proprement : les ajouts en attente sont écrits
+ * @param argc Le nombre d'arguments
+ * @param argv Les arguments
+ * @return 0 en cas de succès, 1 si les arguments sont invalides, si une commande du script a
+ *         échoué ou si les modifications n'ont pas pu être écrites
  */
-int main() {
-    char command[256];
-    char arg1[256], arg2[256];
-    int lines;
+int main(int argc, char *argv[]) {
+    char command[MAX_COMMAND_LENGTH];
 
-    welcome();
+    // Analyser les options / 解析选项
+    FILE *input = stdin;
+    const char *source = "stdin";
+    const char *server_socket = NULL, *client_socket = NULL;
+    long commit_every = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:n:s:c:r")) != -1) {
+        if (opt == 'f') {
+            source = optarg;
+        } else if (opt == 'n') {
+            commit_every = strtol(optarg, NULL, 10);
+        } else if (opt == 's') {
+            server_socket = optarg;
+        } else if (opt == 'c') {
+            client_socket = optarg;
+        } else if (opt == 'r') {
+            read_only_mount = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [-r] [-f script] [-n commands_per_commit] [-s socket | -c socket]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (server_socket) {
+        run_server(server_socket);
+        return 0;
+    }
+    int server_fd = -1;
+    if (client_socket) {
+        server_fd = connect_server(client_socket);
+        if (server_fd < 0) return 1;
+    }
+    if (strcmp(source, "stdin") != 0) {
+        input = fopen(source, "r");
+        if (!input) {
+            perror("Failed to open script");
+            return 1;
+        }
+    }
+    batch_mode = input != stdin || !isatty(STDIN_FILENO);
 
-    while (1) {
-        printf("%s> ", current_path);
-        fgets(command, sizeof(command), stdin);
-        command[strcspn(command, "\n")] = 0;
+    // Sans SA_RESTART, le signal interrompt fgets / 不设置 SA_RESTART，信号会中断 fgets
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    // En interactif, les ajouts restent en tampon entre les commandes, au plus APPEND_FLUSH_SECONDS / 交互模式下，追加内容在命令之间保留在缓冲区，最多 APPEND_FLUSH_SECONDS 秒
+    int interactive = !batch_mode && server_fd < 0;
+    if (interactive) {
+        action.sa_handler = handle_alarm;
+        sigaction(SIGALRM, &action, NULL);
+    }
 
-        // Check if virtual_disk.dat exists
-        struct stat buffer;
-        int fs_initialized = (stat("virtual_disk.dat", &buffer) == 0);
+    if (!batch_mode) {
+        welcome();
+    } else if (server_fd < 0) {
+        begin_session();
+    }
 
-        if (strcmp(command, "exit") == 0) {
-            break;
-        } else if (strcmp(command, "mkfs") == 0) {
-            format_partition();
-        } else if (!fs_initialized) {
-            NotInit();
+    int line_number = 0;
+    long executed = 0;
+    int failed = 0;  // Une commande a échoué ou une validation n'a pas pu écrire / 有命令失败或提交未能写入
+    while (!shell_stop) {
+        // Seuls les ajouts expirés sont écrits : les suivants continuent de remplir le tampon / 只写回超时的追加内容：后续追加继续填充缓冲区
+        if (interactive) sync_append_buffers(0);
+        if (!batch_mode) printf("%s> ", current_path);
+        char *line;
+        for (;;) {
+            if (interactive) alarm(APPEND_FLUSH_SECONDS);
+            line = fgets(command, sizeof(command), input);
+            if (interactive) alarm(0);
+            if (line != NULL || !flush_due || shell_stop) break;
+            // Utilisateur inactif : écrire les ajouts expirés puis reprendre la lecture / 用户空闲：写回超时的追加内容后继续读取
+            flush_due = 0;
+            clearerr(input);
+            sync_append_buffers(0);
+        }
+        if (line == NULL) break;  // Fin de l'entrée / 输入结束
+        line_number++;
+        if (strchr(command, '\n') == NULL && !feof(input)) {
+            // Ligne trop longue : l'ignorer entièrement / 行过长：整行忽略
+            int c;
+            while ((c = fgetc(input)) != '\n' && c != EOF) {}
+            printf("%s:%d: Command too long\n", source, line_number);
+            failed = batch_mode;
             continue;
-        } else if (strcmp(command, "ls") == 0) {
-            show_ls();
-        } else if (strcmp(command, "ls -a") == 0) {
-            show_ls_all();
-        } else if (strcmp(command, "ls -l") == 0) {
-            show_list();
-        } else if (strcmp(command, "ls -la") == 0) {
-            show_list_all();
-        } else if (sscanf(command, "ls -l %s", arg1) == 1) {
-            show_list_one(arg1);
-        } else if (strcmp(command, "ls -it") == 0) {
-            list_file_dir();
-        } else if (sscanf(command, "ls -i %s", arg1) == 1) {
-            show_inode(arg1);
-        } else if (strcmp(command, "tree") == 0) {
-            show_tree();
-        } else if (strcmp(command, "tree -i") == 0) {
-            show_tree_inodes();
-        } else if (strcmp(command, "pwd") == 0) {
-            print_working_directory();
-        } else if (sscanf(command, "cd %s", arg1) == 1) {
-            change_directory(arg1);
-        } else if (sscanf(command, "mkdir %s", arg1) == 1) {
-            create_directory(arg1);
-        } else if (sscanf(command, "rmdir %s", arg1) == 1) {
-            delete_directory(arg1);
-        } else if (sscanf(command, "rm -rf %s", arg1) == 1) {
-            delete_directory_force(arg1);
-        } else if (sscanf(command, "mvdir %s %s", arg1, arg2) == 2) {
-            move_directory(arg1, arg2);
-        } else if (sscanf(command, "du %s", arg1) == 1) {
-            du_command(arg1);
-        } else if (sscanf(command, "touch %s", arg1) == 1) {
-            create_file(arg1);
-        } else if (sscanf(command, "rm %s", arg1) == 1) {
-            delete_file(arg1);
-        } else if (sscanf(command, "cat %s", arg1) == 1) {
-            open_file(arg1);
-        } else if (sscanf(command, "head %s %d", arg1, &lines) == 2) {
-            head_file(arg1, lines);
-        } else if (sscanf(command, "tail %s %d", arg1, &lines) == 2) {
-            tail_file(arg1, lines);
-        } else if (sscanf(command, "echo %s >> %s", arg1, arg2) == 2) {
-            append_to_file(arg2, arg1);
-        } else if (sscanf(command, "echo %s > %s", arg1, arg2) == 2) {
-            write_file(arg2, arg1);
-        } else if (sscanf(command, "mv %s %s", arg1, arg2) == 2) {
-            move_file(arg1, arg2);
-        } else if (sscanf(command, "cp %s %s", arg1, arg2) == 2) {
-            copy_file(arg1, arg2);
-        } else if (sscanf(command, "perm %s", arg1) == 1) {
-            show_permissions(arg1);
-        } else if (sscanf(command, "chmod %s %s", arg1, arg2) == 2) {
-            change_permissions(arg1, arg2);
-        } else if (sscanf(command, "ln %s %s", arg1, arg2) == 2) {
-            link_file(arg1, arg2);
-        } else if (sscanf(command, "link %s %s", arg1, arg2) == 2) {
-            create_symlink(arg1, arg2);
-        } else if (sscanf(command, "unlink %s", arg1) == 1) {
-            delete_symlink(arg1);
-        } else if (strcmp(command, "help") == 0) {
-            show_help();
-        } else {
-            printf("Invalid command.\n");
+        }
+        command[strcspn(command, "\r\n")] = 0;
+        if (batch_mode && (command[0] == '\0' || command[0] == '#')) continue;  // Lignes vides et commentaires / 空行和注释
+
+        // Découper la ligne puis exécuter la commande / 拆分命令行并执行命令
+        char *argv_cmd[MAX_COMMAND_ARGS];
+        int argc_cmd = tokenize_command(command, argv_cmd, MAX_COMMAND_ARGS);
+        if (argc_cmd == 0) continue;
+        set_command_location(batch_mode ? source : NULL, line_number);
+        int status = argc_cmd < 0 ? COMMAND_INVALID :
+                     server_fd >= 0 ? remote_command(server_fd, argc_cmd, argv_cmd) : execute_command(argc_cmd, argv_cmd);
+        if (status == COMMAND_EXIT) break;
+        // Un script s'arrête avec un statut d'échec, pas une session interactive / 脚本以失败状态结束，交互会话则不会
+        if (status != COMMAND_OK && batch_mode) failed = 1;
+
+        if (status == COMMAND_NOT_INIT) {
+            if (batch_mode) printf("%s:%d: File system is not initialized\n", source, line_number);
+            else NotInit();
+        } else if (status == COMMAND_INVALID) {
+            if (batch_mode) printf("%s:%d: Invalid command: %s\n", source, line_number, argv_cmd[0]);
+            else printf("Invalid command.\n");
+        }
+
+        // Valider la session toutes les N commandes / 每 N 条命令提交一次会话
+        if (batch_mode && server_fd < 0 && commit_every > 0 && ++executed % commit_every == 0) {
+            sync_append_buffers(1);
+            if (commit_session() != 0) failed = 1;
         }
     }
 
-    printf("Exiting Virtual File System.\n");
-    return 0;
+    // Les ajouts en attente sont écrits quel que soit le mode / 无论何种模式，都写回等待中的追加内容
+    if (server_fd < 0) sync_append_buffers(1);
+    // Une transaction non validée est abandonnée / 未提交的事务被放弃
+    if (server_fd < 0 && abort_transaction() == 0) {
+        printf("Transaction aborted\n");
+    }
+    if (server_fd >= 0) {
+        close(server_fd);
+    } else if (batch_mode) {
+        if (end_session() != 0) failed = 1;
+    }
+    if (!batch_mode) {
+        printf("Exiting Virtual File System.\n");
+    }
+    if (input != stdin) fclose(input);
+    return failed;
 }
 
 
@@ -19,7 +19,7 @@ void show_permissions(const char *path) {
     // Obtenir l'inode du fichier / 获取文件的 inode
     int inode_num = get_inode_from_path(path);
     if (inode_num == -1) {
-        printf("File not found\n");
+        command_error("File not found\n");
         return;
     }
 
@@ -56,7 +56,7 @@ void show_permissions(const char *path) {
     printf("%c%s %s\n", type, perms, filename);
     
     // Mettre à jour le temps d'accès / 更新访问时间
-    inode->atime = time(NULL);
+    touch_access_time(inode);
     save_superblock();
 }
 
@@ -98,13 +98,13 @@ void change_permissions(const char *path, const char *perm_str) {
     // Obtenir l'inode du fichier / 获取文件的 inode
     int inode_num = get_inode_from_path(path);
     if (inode_num == -1) {
-        printf("File or directory not found\n");
+        command_error("File or directory not found\n");
         return;
     }
 
     // Vérifier le format de la chaîne de permissions / 检查权限字符串格式
     if (strlen(perm_str) != 3) {
-        printf("Invalid permission format. Please use format 'rwx' (e.g., 'rw-', 'r--', etc.)\n");
+        command_error("Invalid permission format. Please use format 'rwx' (e.g., 'rw-', 'r--', etc.)\n");
         return;
     }
 
@@ -114,19 +114,19 @@ void change_permissions(const char *path, const char *perm_str) {
         switch (i) {
             case 0: // Permission de lecture / 读权限
                 if (c != 'r' && c != '-') {
-                    printf("Invalid read permission. Use 'r' or '-'\n");
+                    command_error("Invalid read permission. Use 'r' or '-'\n");
                     return;
                 }
                 break;
             case 1: // Permission d'écriture / 写权限
                 if (c != 'w' && c != '-') {
-                    printf("Invalid write permission. Use 'w' or '-'\n");
+                    command_error("Invalid write permission. Use 'w' or '-'\n");
                     return;
                 }
                 break;
             case 2: // Permission d'exécution / 执行权限
                 if (c != 'x' && c != '-') {
-                    printf("Invalid execute permission. Use 'x' or '-'\n");
+                    command_error("Invalid execute permission. Use 'x' or '-'\n");
                     return;
                 }
                 break;
@@ -0,0 +1,476 @@
+/**
+* @file pipe.c
+* @brief Pipelines entre commandes : cat a | grep x, cat a b > c, ls | grep x >> d
+* @details Les étapes s'échangent des références vers des blocs d'au plus une page. cat transmet
+*          directement les pages du volume, grep transmet des morceaux de ces blocs, et une
+*          redirection ajoute les blocs au fichier cible page par page, sans passer par stdio.
+*          Une autre commande peut ouvrir le pipeline : sa sortie est alors capturée puis découpée
+*          en pages.
+* @author jzy
+* @date 2025-4-23
+*/
+#define _GNU_SOURCE
+#include "filesystem.h"
+#include <unistd.h>
+
+extern SuperBlock fs;
+
+#define MAX_FILE_SIZE ((size_t)MAX_FILE_PAGES * PAGE_SIZE)
+#define MAX_PIPE_STAGES 8  // Nombre maximal d'étapes / 最大阶段数
+
+// Une étape : reçoit des blocs, puis la fin du flux / 一个阶段：接收数据块，然后接收流结束
+typedef struct PipeStage PipeStage;
+struct PipeStage {
+    int (*push)(PipeStage *stage, const char *data, size_t len); // 0, ou -1 pour arrêter le flux / 返回 0，或 -1 停止数据流
+    void (*finish)(PipeStage *stage);
+    PipeStage *next;
+
+    // grep
+    const char *pattern;
+    int invert;                 // grep -v
+    char *line;                 // Ligne à cheval sur deux blocs / 跨两个数据块的行
+    size_t line_len, line_cap;
+
+    // Sortie standard / 标准输出
+    char last;                  // Dernier octet écrit / 最后写出的字节
+
+    // Fichier cible / 目标文件
+    Inode *inode;
+    int append;                 // >> plutôt que > / 是 >> 而不是 >
+    int failed;
+};
+
+/**
+ * @brief Indiquer si un mot est un opérateur de redirection
+ * @param word Le mot
+ * @return 1 pour > ou >>, 0 sinon
+ */
+static int is_redirect(const char *word) {
+    return strcmp(word, ">") == 0 || strcmp(word, ">>") == 0;
+}
+
+/**
+ * @brief Indiquer si une ligne de commande est un pipeline
+ * @details echo garde sa propre syntaxe echo <texte> > <fichier> ; un | en fait tout de même un pipeline
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @return 1 si la ligne contient | (ou une redirection hors echo), 0 sinon
+ */
+int is_pipeline(int argc, char *argv[]) {
+    int redirect = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "|") == 0) return 1;
+        if (is_redirect(argv[i])) redirect = 1;
+    }
+    return redirect && strcmp(argv[0], "echo") != 0;
+}
+
+/**
+ * @brief Indiquer si un pipeline ne fait que lire le volume
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @return 1 si la commande source ne modifie pas le volume et qu'il n'y a pas de redirection, 0 sinon
+ */
+int pipeline_read_only(int argc, char *argv[]) {
+    int source = 0;
+    while (source < argc && strcmp(argv[source], "|") != 0 && !is_redirect(argv[source])) source++;
+    if (argc >= 2 && is_redirect(argv[argc - 2])) return 0;
+    return source > 0 && command_is_read_only(source, argv);
+}
+
+/**
+ * @brief Étape finale : écrire les blocs sur la sortie standard
+ * @param stage L'étape
+ * @param data Le bloc
+ * @param len La longueur du bloc
+ * @return 0
+ */
+static int stdout_push(PipeStage *stage, const char *data, size_t len) {
+    if (len == 0) return 0;
+    fwrite(data, 1, len, stdout);
+    stage->last = data[len - 1];
+    return 0;
+}
+
+/**
+ * @brief Terminer la sortie standard par une fin de ligne, comme cat
+ * @param stage L'étape
+ * @return Aucun
+ */
+static void stdout_finish(PipeStage *stage) {
+    if (stage->last != '\0' && stage->last != '\n') printf("\n");
+}
+
+/**
+ * @brief Étape finale : ajouter les blocs au fichier cible, page par page
+ * @param stage L'étape
+ * @param data Le bloc
+ * @param len La longueur du bloc
+ * @return 0, ou -1 si le fichier est plein ou s'il n'y a plus de pages libres
+ */
+static int file_push(PipeStage *stage, const char *data, size_t len) {
+    if (stage->failed) return -1;
+    if (stage->inode->size + len > MAX_FILE_SIZE) {
+        command_error("File size exceeds maximum limit\n");
+        stage->failed = 1;
+        return -1;
+    }
+    if (append_data(stage->inode, data, len) != 0) {
+        stage->failed = 1;
+        return -1;
+    }
+    page_cache_invalidate(stage->inode->inode_number);
+    return 0;
+}
+
+/**
+ * @brief Mettre à jour les dates du fichier cible et sauvegarder
+ * @param stage L'étape
+ * @return Aucun
+ */
+static void file_finish(PipeStage *stage) {
+    time_t now = time(NULL);
+    stage->inode->mtime = now;
+    stage->inode->atime = now;
+    save_superblock();
+    if (stage->failed) return;
+    if (stage->append) printf("Content appended successfully\n");
+    else printf("File written successfully\n");
+}
+
+/**
+ * @brief Tester une ligne et la transmettre si elle correspond au motif
+ * @param stage L'étape grep
+ * @param line La ligne (fin de ligne comprise)
+ * @param len La longueur de la ligne
+ * @return Le résultat de l'étape suivante, ou 0 si la ligne est écartée
+ */
+static int grep_line(PipeStage *stage, const char *line, size_t len) {
+    int found = memmem(line, len, stage->pattern, strlen(stage->pattern)) != NULL;
+    if (found == stage->invert) return 0;
+    return stage->next->push(stage->next, line, len);
+}
+
+/**
+ * @brief Étape grep : transmettre les lignes qui contiennent le motif
+ * @details Une ligne entière dans un bloc est transmise sans copie ; seule une ligne à cheval sur
+ *          deux blocs est recopiée
+ * @param stage L'étape
+ * @param data Le bloc
+ * @param len La longueur du bloc
+ * @return 0, ou -1 si l'étape suivante arrête le flux
+ */
+static int grep_push(PipeStage *stage, const char *data, size_t len) {
+    size_t start = 0;
+    while (start < len) {
+        const char *newline = memchr(data + start, '\n', len - start);
+        size_t end = newline ? (size_t)(newline - data) + 1 : len;
+
+        // Compléter la ligne en attente, ou la commencer / 补全等待中的行，或开始新行
+        if (stage->line_len > 0 || newline == NULL) {
+            size_t needed = stage->line_len + (end - start);
+            if (needed > stage->line_cap) {
+                size_t cap = stage->line_cap ? stage->line_cap : PAGE_SIZE;
+                while (cap < needed) cap *= 2;
+                char *line = realloc(stage->line, cap);
+                if (line == NULL) return -1;
+                stage->line = line;
+                stage->line_cap = cap;
+            }
+            memcpy(stage->line + stage->line_len, data + start, end - start);
+            stage->line_len = needed;
+            if (newline != NULL) {
+                stage->line_len = 0;
+                if (grep_line(stage, stage->line, needed) != 0) return -1;
+            }
+        } else if (grep_line(stage, data + start, end - start) != 0) {
+            return -1;
+        }
+        start = end;
+    }
+    return 0;
+}
+
+/**
+ * @brief Tester la dernière ligne, sans fin de ligne, puis terminer l'étape suivante
+ * @param stage L'étape
+ * @return Aucun
+ */
+static void grep_finish(PipeStage *stage) {
+    if (stage->line_len > 0) grep_line(stage, stage->line, stage->line_len);
+    free(stage->line);
+    stage->next->finish(stage->next);
+}
+
+/**
+ * @brief Ouvrir le fichier cible d'une redirection, en le créant s'il n'existe pas
+ * @param stage L'étape finale à initialiser
+ * @param path Le chemin du fichier
+ * @param append 1 pour >>, 0 pour >
+ * @return 0, ou -1 après avoir affiché l'erreur
+ */
+static int open_target(PipeStage *stage, const char *path, int append) {
+    int file_inode = get_inode_from_path(path);
+    if (file_inode != -1 && fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
+        file_inode = resolve_symlink(file_inode);
+        if (file_inode == -1) {
+            command_error("Source file does not exist or has been deleted\n");
+            return -1;
+        }
+    }
+    if (file_inode == -1) {
+        file_inode = add_regular_file(path);
+        if (file_inode < 0) {
+            command_error("Cannot create %s: %s\n", path, vfs_strerror(file_inode));
+            return -1;
+        }
+    }
+    if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
+        command_error("Not a regular file\n");
+        return -1;
+    }
+    if (!check_file_permission(file_inode, PERM_WRITE)) {
+        command_error("Permission denied\n");
+        return -1;
+    }
+
+    stage->inode = &fs.inodes[file_inode];
+    stage->append = append;
+    stage->push = file_push;
+    stage->finish = file_finish;
+    return 0;
+}
+
+/**
+ * @brief Vider le fichier cible d'une redirection >
+ * @param stage L'étape finale
+ * @return 0, ou -1 après avoir affiché l'erreur
+ */
+static int truncate_target(PipeStage *stage) {
+    if (stage->append || stage->inode->size == 0) return 0;
+    if (set_file_contents(stage->inode, "", 0) != 0) {
+        command_error("No free pages available\n");
+        return -1;
+    }
+    page_cache_invalidate(stage->inode->inode_number);
+    return 0;
+}
+
+/**
+ * @brief Résoudre les fichiers lus par cat et vérifier leurs permissions
+ * @param count Le nombre de chemins
+ * @param paths Les chemins
+ * @param inodes Reçoit les numéros d'inode
+ * @return 0, ou -1 après avoir affiché l'erreur
+ */
+static int open_sources(int count, char **paths, int *inodes) {
+    for (int i = 0; i < count; i++) {
+        int file_inode = get_inode_from_path(paths[i]);
+        if (file_inode == -1) {
+            command_error("%s: File not found\n", paths[i]);
+            return -1;
+        }
+        if (fs.inodes[file_inode].file_type == FILE_TYPE_SYMLINK) {
+            file_inode = resolve_symlink(file_inode);
+            if (file_inode == -1) {
+                command_error("%s: Source file does not exist or has been deleted\n", paths[i]);
+                return -1;
+            }
+        }
+        if (!check_file_permission(file_inode, PERM_READ)) {
+            command_error("%s: Permission denied\n", paths[i]);
+            return -1;
+        }
+        if (fs.inodes[file_inode].file_type != FILE_TYPE_REGULAR) {
+            command_error("%s: Not a regular file\n", paths[i]);
+            return -1;
+        }
+        if (verify_file_pages(&fs.inodes[file_inode]) != 0) {
+            command_error("%s: File data is corrupted\n", paths[i]);
+            return -1;
+        }
+        inodes[i] = file_inode;
+    }
+    return 0;
+}
+
+/**
+ * @brief Envoyer le contenu de fichiers dans le pipeline, une page à la fois
+ * @details Les pages non compressées sont transmises par référence ; une page décompressée est
+ *          recopiée, car le cache de décompression peut être réutilisé par l'étape finale
+ * @param first La première étape
+ * @param count Le nombre de fichiers
+ * @param inodes Les numéros d'inode
+ * @return Aucun
+ */
+static void stream_files(PipeStage *first, int count, const int *inodes) {
+    char page[PAGE_SIZE];
+    for (int i = 0; i < count; i++) {
+        Inode *inode = &fs.inodes[inodes[i]];
+        size_t size = inode->size;
+        for (size_t offset = 0; offset < size; offset += PAGE_SIZE) {
+            size_t len = size - offset < PAGE_SIZE ? size - offset : PAGE_SIZE;
+            const char *data = file_page_data(inode, offset / PAGE_SIZE);
+            if (inode->compressed) {
+                memcpy(page, data, len);
+                data = page;
+            }
+            if (first->push(first, data, len) != 0) return;
+        }
+        touch_access_time(inode);
+    }
+}
+
+/**
+ * @brief Exécuter une commande en capturant sa sortie dans un fichier temporaire
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @param status Reçoit le statut de la commande
+ * @return Le fichier temporaire, relu depuis le début, ou NULL
+ */
+static FILE *capture_command(int argc, char **argv, int *status) {
+    FILE *capture = tmpfile();
+    if (capture == NULL) {
+        perror("Failed to create pipe buffer");
+        *status = COMMAND_OK;
+        return NULL;
+    }
+    int saved_stdout = dup(STDOUT_FILENO);
+    fflush(stdout);
+    dup2(fileno(capture), STDOUT_FILENO);
+    *status = execute_command(argc, argv);
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    rewind(capture);
+    return capture;
+}
+
+/**
+ * @brief Exécuter un pipeline : une source, des filtres grep, puis la sortie standard ou un fichier
+ * @details Sources : cat <fichier>... (pages transmises directement) ou toute autre commande (sortie
+ *          capturée). Filtres : grep [-v] <motif>. Fin : > <fichier> ou >> <fichier>
+ * @param argc Le nombre de mots
+ * @param argv Les mots (les opérateurs sont des mots séparés)
+ * @return COMMAND_OK ou COMMAND_INVALID, ou le statut de la commande source
+ */
+int run_pipeline(int argc, char *argv[]) {
+    // Découper en étapes / 拆分为各个阶段
+    char **stage_argv[MAX_PIPE_STAGES];
+    int stage_argc[MAX_PIPE_STAGES];
+    int stages = 0;
+    const char *target = NULL;
+    int append = 0;
+    int start = 0;
+    for (int i = 0; i <= argc; i++) {
+        int end_of_stage = i == argc || strcmp(argv[i], "|") == 0 || is_redirect(argv[i]);
+        if (!end_of_stage) continue;
+        if (i == start || stages == MAX_PIPE_STAGES) return COMMAND_INVALID;
+        stage_argv[stages] = argv + start;
+        stage_argc[stages] = i - start;
+        stages++;
+        if (i < argc && is_redirect(argv[i])) {
+            // La redirection termine la ligne / 重定向必须位于行尾
+            if (i + 2 != argc) return COMMAND_INVALID;
+            target = argv[i + 1];
+            append = strcmp(argv[i], ">>") == 0;
+            break;
+        }
+        start = i + 1;
+    }
+
+    // Vérifier les filtres / 检查过滤器
+    PipeStage chain[MAX_PIPE_STAGES + 1];
+    memset(chain, 0, sizeof(chain));
+    for (int s = 1; s < stages; s++) {
+        PipeStage *stage = &chain[s];
+        char **words = stage_argv[s];
+        if (strcmp(words[0], "grep") == 0 && stage_argc[s] == 2) {
+            stage->pattern = words[1];
+        } else if (strcmp(words[0], "grep") == 0 && stage_argc[s] == 3 && strcmp(words[1], "-v") == 0) {
+            stage->pattern = words[2];
+            stage->invert = 1;
+        } else {
+            return COMMAND_INVALID;
+        }
+        stage->push = grep_push;
+        stage->finish = grep_finish;
+    }
+    for (int s = 0; s < stages; s++) {
+        chain[s].next = &chain[s + 1];
+    }
+    PipeStage *first = stages > 1 ? &chain[1] : &chain[stages];
+    PipeStage *sink = &chain[stages];
+
+    int native = strcmp(stage_argv[0][0], "cat") == 0 && stage_argc[0] > 1;
+    if (target != NULL && read_only_mount) {
+        command_error("Read-only file system\n");
+        return COMMAND_OK;
+    }
+    if (target != NULL && metadata_damaged()) {
+        command_error("Metadata checksum mismatch, run 'fsck repair'\n");
+        return COMMAND_OK;
+    }
+
+    // Une autre commande s'exécute d'abord, sortie capturée / 其他命令先执行，输出被捕获
+    FILE *capture = NULL;
+    if (!native) {
+        int status;
+        capture = capture_command(stage_argc[0], stage_argv[0], &status);
+        // Le message d'une source en échec passe dans le pipeline / 失败的源命令的消息仍进入管道
+        if (status != COMMAND_OK && status != COMMAND_FAILED) {
+            if (capture) fclose(capture);
+            return status;
+        }
+        if (capture == NULL) return COMMAND_OK;
+    }
+
+    if (target != NULL) acquire_disk_writer();
+    else refresh_session();
+    if (locking_enabled) {
+        lock_volume(1);
+        namespace_write_begin();
+    }
+    load_superblock();
+
+    int sources[MAX_COMMAND_ARGS];
+    int ok = !native || open_sources(stage_argc[0] - 1, stage_argv[0] + 1, sources) == 0;
+    if (ok && target != NULL) {
+        ok = open_target(sink, target, append) == 0;
+        // Lire et vider le même fichier perdrait les données / 读取并清空同一文件会丢失数据
+        for (int i = 0; ok && native && i < stage_argc[0] - 1; i++) {
+            if (&fs.inodes[sources[i]] == sink->inode) {
+                command_error("%s: Input file is output file\n", stage_argv[0][i + 1]);
+                ok = 0;
+            }
+        }
+        if (ok) ok = truncate_target(sink) == 0;
+    } else if (ok) {
+        sink->push = stdout_push;
+        sink->finish = stdout_finish;
+    }
+
+    if (ok) {
+        if (native) {
+            stream_files(first, stage_argc[0] - 1, sources);
+        } else {
+            char page[PAGE_SIZE];
+            size_t len;
+            while ((len = fread(page, 1, PAGE_SIZE, capture)) > 0) {
+                if (first->push(first, page, len) != 0) break;
+            }
+        }
+        first->finish(first);
+        if (target == NULL) save_superblock();  // Dates d'accès / 访问时间
+    } else {
+        for (int s = 1; s < stages; s++) free(chain[s].line);
+    }
+
+    if (capture) fclose(capture);
+    if (locking_enabled) {
+        namespace_write_end();
+        unlock_volume();
+    }
+    release_disk_writer();
+    return COMMAND_OK;
+}
@@ -0,0 +1,411 @@
+/**
+* @file send.c
+* @brief Flux de réplication incrémentale entre volumes (send/receive)
+* @author jzy
+* @date 2025-4-17
+*/
+#include "filesystem.h"
+
+extern SuperBlock fs;
+
+#define SEND_MAGIC "VFSSEND1"  // Signature du flux / 流签名
+#define TOTAL_PAGES (MAX_FILES * MAX_FILE_PAGES)
+
+// Origine de chaque page d'un inode transmis / 已发送 inode 每个页面的来源
+#define PAGE_FROM_BASE   0  // Page inchangée depuis l'instantané de base / 自基准快照以来未改变的页面
+#define PAGE_FROM_STREAM 1  // Contenu transmis à la suite de l'enregistrement / 内容紧随记录之后发送
+#define PAGE_SHARED      2  // Même page qu'une page déjà transmise dans le flux / 与流中已发送的页面相同
+#define PAGE_FROM_HOLE   3  // Trou d'un fichier creux, sans données / 稀疏文件中的空洞，没有数据
+
+// En-tête du flux / 流头
+typedef struct {
+    char magic[8];
+    int incremental;                 // 0 : flux complet / 0：完整流
+    unsigned int base_fingerprint;   // Empreinte des métadonnées de départ / 起始元数据指纹
+    unsigned int target_fingerprint; // Empreinte des métadonnées après application / 应用后的元数据指纹
+    int free_inodes;                 // Longueur de la liste des inodes libres qui suit l'en-tête / 流头之后的空闲 inode 链表长度
+    int inode_records;               // Nombre d'inodes transmis / 发送的 inode 数
+    int entry_records;               // Nombre d'entrées de répertoire transmises / 发送的目录项数
+    int data_pages;                  // Nombre de pages de données transmises / 发送的数据页数
+} SendHeader;
+
+// Le flux contient l'en-tête, la liste des inodes libres dans l'ordre, les inodes puis les entrées / 流依次包含流头、按顺序排列的空闲 inode 链表、inode 记录和目录项记录
+
+// Enregistrement d'un inode, suivi des pages PAGE_FROM_STREAM / inode 记录，后跟 PAGE_FROM_STREAM 页面
+typedef struct {
+    int inode_number;
+    int allocated;                              // 0 : l'inode a été libéré depuis la base / 0：该 inode 自基准以来已被释放
+    unsigned char page_source[MAX_FILE_PAGES];  // Origine de chaque page / 每个页面的来源
+    Inode inode;                                // Les numéros de pages sont ceux du volume source / 页号为源卷的页号
+} InodeRecord;
+
+// Enregistrement d'une entrée de répertoire / 目录项记录
+typedef struct {
+    int slot;
+    DirectoryEntry entry;
+} EntryRecord;
+
+/**
+ * @brief Calculer l'empreinte logique des tables d'inodes et du répertoire
+ * @details Les numéros de pages physiques, qui diffèrent d'un volume à l'autre, les dates d'accès, qu'une
+ *          simple lecture modifie, et le contenu résiduel des inodes et entrées libres sont ignorés;
+ *          seul l'ordre de la liste libre compte.
+ * @param inodes La table d'inodes
+ * @param directory La table du répertoire
+ * @param free_inode_head La tête de la liste des inodes libres
+ * @return L'empreinte CRC32C
+ */
+static unsigned int metadata_fingerprint(const Inode *inodes, const DirectoryEntry *directory, int free_inode_head) {
+    static Inode masked[MAX_FILES];
+    static DirectoryEntry masked_directory[MAX_FILES];
+    unsigned char is_free[MAX_FILES];
+    mark_free_inodes(inodes, free_inode_head, is_free);
+    memcpy(masked, inodes, sizeof(masked));
+    memcpy(masked_directory, directory, sizeof(masked_directory));
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (is_free[i]) {
+            memset(&masked[i], 0, sizeof(Inode));
+            masked[i].link_count = inodes[i].link_count;
+        } else {
+            memset(masked[i].pages, 0, sizeof(masked[i].pages));
+            masked[i].atime = 0;
+        }
+        if (directory[i].inode_number == -1) {
+            memset(&masked_directory[i], 0, sizeof(DirectoryEntry));
+            masked_directory[i].inode_number = -1;
+        }
+    }
+    unsigned int parts[3] = { crc32c(masked, sizeof(masked)), crc32c(masked_directory, sizeof(masked_directory)),
+                              (unsigned int)free_inode_head };
+    return crc32c(parts, sizeof(parts));
+}
+
+/**
+ * @brief Comparer deux entrées de répertoire en ignorant le contenu des entrées libres
+ * @param a La première entrée
+ * @param b La seconde entrée
+ * @return 1 si elles diffèrent, 0 sinon
+ */
+static int entry_differs(const DirectoryEntry *a, const DirectoryEntry *b) {
+    if (a->inode_number == -1 && b->inode_number == -1) return 0;
+    return a->inode_number != b->inode_number || a->parent_inode != b->parent_inode ||
+           strcmp(a->name, b->name) != 0;
+}
+
+/**
+ * @brief Préparer l'enregistrement d'un inode et l'origine de ses pages
+ * @param record Reçoit l'enregistrement
+ * @param i Le numéro de l'inode
+ * @param allocated L'inode est utilisé dans l'état actuel
+ * @param base L'inode dans l'état de base, ou NULL s'il était libre (ou flux complet)
+ * @param sent Pages déjà transmises dans le flux
+ * @return Le nombre de pages dont le contenu doit être transmis
+ */
+static int prepare_inode_record(InodeRecord *record, int i, int allocated, const Inode *base, unsigned char *sent) {
+    memset(record, 0, sizeof(InodeRecord));
+    record->inode_number = i;
+    record->allocated = allocated;
+    record->inode = fs.inodes[i];
+    if (!allocated || fs.inodes[i].file_type != FILE_TYPE_REGULAR) return 0;
+
+    int data_pages = 0;
+    for (int j = 0; j < fs.inodes[i].page_count; j++) {
+        int page = fs.inodes[i].pages[j];
+        // Grâce à la copie sur écriture, une page de même numéro au même rang n'a pas changé / 由于写时复制，同一位置的相同页号内容未变
+        if (page == PAGE_HOLE) {
+            record->page_source[j] = PAGE_FROM_HOLE;
+        } else if (base && base->file_type == FILE_TYPE_REGULAR && j < base->page_count && base->pages[j] == page) {
+            record->page_source[j] = PAGE_FROM_BASE;
+        } else if (sent[page]) {
+            record->page_source[j] = PAGE_SHARED;
+        } else {
+            record->page_source[j] = PAGE_FROM_STREAM;
+            sent[page] = 1;
+            data_pages++;
+        }
+    }
+    return data_pages;
+}
+
+/**
+ * @brief Commande send : écrire dans un fichier de l'hôte les changements depuis un instantané
+ * @details Sans instantané, le flux contient tout le volume. Seuls les inodes et les entrées de
+ *          répertoire modifiés, et les pages qui ne sont plus celles de l'instantané, sont transmis.
+ * @param host_file Le fichier de l'hôte recevant le flux
+ * @param from_snapshot Le nom de l'instantané de base, ou NULL pour un flux complet
+ * @return Aucun
+ */
+void send_command(const char *host_file, const char *from_snapshot) {
+    load_superblock();
+    commit_session();  // Les instantanés doivent refléter les modifications en attente / 快照需要包含待保存的修改
+
+    static Inode base_inodes[MAX_FILES];
+    static DirectoryEntry base_directory[MAX_FILES];
+    unsigned char base_free[MAX_FILES], live_free[MAX_FILES];
+    int base_free_head = -1;
+    int incremental = from_snapshot != NULL;
+    if (incremental) {
+        int index = find_snapshot(from_snapshot);
+        if (index == -1) {
+            command_error("Snapshot not found\n");
+            return;
+        }
+        if (!snapshot_metadata(index, base_inodes, base_directory, &base_free_head)) return;
+        mark_free_inodes(base_inodes, base_free_head, base_free);
+    }
+    mark_free_inodes(fs.inodes, fs.free_inode_head, live_free);
+
+    // Choisir les inodes et entrées à transmettre / 选择要发送的 inode 和目录项
+    // Flux complet : tout ce qui est utilisé; flux incrémental : ce qui a changé depuis la base / 完整流：所有已使用的内容；增量流：自基准以来变化的内容
+    unsigned char inode_changed[MAX_FILES], entry_changed[MAX_FILES];
+    SendHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SEND_MAGIC, sizeof(header.magic));
+    header.incremental = incremental;
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!incremental) {
+            inode_changed[i] = !live_free[i];
+            entry_changed[i] = fs.directory[i].inode_number != -1;
+        } else {
+            inode_changed[i] = live_free[i] ? !base_free[i] :
+                               base_free[i] || memcmp(&base_inodes[i], &fs.inodes[i], sizeof(Inode)) != 0;
+            entry_changed[i] = entry_differs(&base_directory[i], &fs.directory[i]);
+        }
+        header.inode_records += inode_changed[i];
+        header.entry_records += entry_changed[i];
+    }
+    int free_list[MAX_FILES];
+    for (int i = fs.free_inode_head; i >= 0 && header.free_inodes < MAX_FILES; i = fs.inodes[i].link_count) {
+        free_list[header.free_inodes++] = i;
+    }
+
+    static unsigned char sent[TOTAL_PAGES];
+    static InodeRecord records[MAX_FILES];
+    memset(sent, 0, sizeof(sent));
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!inode_changed[i]) continue;
+        const Inode *base = incremental && !base_free[i] ? &base_inodes[i] : NULL;
+        header.data_pages += prepare_inode_record(&records[i], i, !live_free[i], base, sent);
+    }
+    header.base_fingerprint = incremental ? metadata_fingerprint(base_inodes, base_directory, base_free_head) : 0;
+    header.target_fingerprint = metadata_fingerprint(fs.inodes, fs.directory, fs.free_inode_head);
+
+    // Le récepteur donnerait un checksum valide aux données corrompues : refuser le flux / 接收方会给损坏的数据有效的校验和：拒绝发送
+    if (metadata_damaged()) {
+        command_error("Metadata checksum mismatch, run 'fsck repair'\n");
+        return;
+    }
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!inode_changed[i] || !records[i].allocated || records[i].inode.file_type != FILE_TYPE_REGULAR) continue;
+        for (int j = 0; j < records[i].inode.page_count; j++) {
+            if (records[i].page_source[j] == PAGE_FROM_STREAM && !verify_page_checksum(records[i].inode.pages[j])) {
+                command_error("Page %d fails its checksum, stream not written\n", records[i].inode.pages[j]);
+                return;
+            }
+        }
+    }
+
+    FILE *out = fopen(host_file, "wb");
+    if (!out) {
+        perror("Failed to create stream file");
+        return;
+    }
+    static char buffer[1 << 16];
+    setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+    int ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+             fwrite(free_list, sizeof(int), header.free_inodes, out) == (size_t)header.free_inodes;
+    for (int i = 0; ok && i < MAX_FILES; i++) {
+        if (!inode_changed[i]) continue;
+        ok = fwrite(&records[i], sizeof(InodeRecord), 1, out) == 1;
+        for (int j = 0; ok && records[i].allocated && j < records[i].inode.page_count; j++) {
+            if (records[i].inode.file_type != FILE_TYPE_REGULAR) break;
+            if (records[i].page_source[j] != PAGE_FROM_STREAM) continue;
+            int page = records[i].inode.pages[j];
+            ok = fwrite(fs.page_table[page].data, PAGE_SIZE, 1, out) == 1;
+        }
+    }
+    for (int i = 0; ok && i < MAX_FILES; i++) {
+        if (!entry_changed[i]) continue;
+        EntryRecord record = { i, fs.directory[i] };
+        ok = fwrite(&record, sizeof(record), 1, out) == 1;
+    }
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        command_error("Failed to write stream\n");
+        return;
+    }
+    printf("Stream written: %d inodes, %d entries, %d pages\n",
+           header.inode_records, header.entry_records, header.data_pages);
+}
+
+/**
+ * @brief Compter les pages de la liste libre
+ * @return Le nombre de pages libres
+ */
+static int count_free_pages() {
+    int count = 0;
+    for (int p = fs.free_page_head; p != -1 && count < TOTAL_PAGES; p = *((int *)fs.page_table[p].data)) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Commande receive : appliquer au volume un flux produit par send
+ * @details Un flux incrémental n'est accepté que si le volume est dans l'état de base du flux
+ * @param host_file Le fichier de l'hôte contenant le flux
+ * @return Aucun
+ */
+void receive_command(const char *host_file) {
+    load_superblock();
+    // Un flux mal appliqué est abandonné en relisant le disque : rien d'autre ne doit être en attente / 应用失败的流通过重读磁盘放弃：不能有其他待写修改
+    commit_session();
+
+    FILE *in = fopen(host_file, "rb");
+    if (!in) {
+        perror("Failed to open stream file");
+        return;
+    }
+    static char buffer[1 << 16];
+    setvbuf(in, buffer, _IOFBF, sizeof(buffer));
+
+    // Vérifier l'en-tête, la taille du flux et l'état de base / 检查流头、流大小和基准状态
+    SendHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, SEND_MAGIC, sizeof(header.magic)) != 0) {
+        command_error("Not a send stream\n");
+        fclose(in);
+        return;
+    }
+    long expected = sizeof(SendHeader) + (long)header.free_inodes * sizeof(int) +
+                    (long)header.inode_records * sizeof(InodeRecord) +
+                    (long)header.data_pages * PAGE_SIZE + (long)header.entry_records * sizeof(EntryRecord);
+    fseek(in, 0, SEEK_END);
+    if (ftell(in) != expected) {
+        command_error("Stream is truncated or corrupted\n");
+        fclose(in);
+        return;
+    }
+    int free_list[MAX_FILES];
+    fseek(in, sizeof(SendHeader), SEEK_SET);
+    if (header.free_inodes < 0 || header.free_inodes > MAX_FILES ||
+        fread(free_list, sizeof(int), header.free_inodes, in) != (size_t)header.free_inodes) {
+        command_error("Stream is truncated or corrupted\n");
+        fclose(in);
+        return;
+    }
+    if (header.incremental && metadata_fingerprint(fs.inodes, fs.directory, fs.free_inode_head) != header.base_fingerprint) {
+        command_error("Volume does not match the base snapshot of the stream\n");
+        fclose(in);
+        return;
+    }
+    if (count_free_pages() < header.data_pages) {
+        command_error("Not enough free pages to receive the stream\n");
+        fclose(in);
+        return;
+    }
+
+    // Correspondance entre les pages du volume source et les pages locales / 源卷页面与本地页面的对应关系
+    static int page_map[TOTAL_PAGES];
+    for (int p = 0; p < TOTAL_PAGES; p++) page_map[p] = -1;
+    unsigned char was_free[MAX_FILES];
+    mark_free_inodes(fs.inodes, fs.free_inode_head, was_free);
+
+    // Un flux complet remplace tout le contenu du volume / 完整流替换卷的全部内容
+    if (!header.incremental) {
+        for (int i = 0; i < MAX_FILES; i++) {
+            if (!was_free[i] && fs.inodes[i].file_type == FILE_TYPE_REGULAR) {
+                for (int j = 0; j < fs.inodes[i].page_count; j++) free_page(fs.inodes[i].pages[j]);
+            }
+            was_free[i] = 1;
+            page_cache_invalidate(i);
+            fs.directory[i].inode_number = -1;
+            fs.directory[i].parent_inode = -1;
+            fs.directory[i].name[0] = '\0';
+        }
+    }
+
+    int ok = 1;
+    for (int r = 0; ok && r < header.inode_records; r++) {
+        InodeRecord record;
+        if (fread(&record, sizeof(record), 1, in) != 1 ||
+            record.inode_number < 0 || record.inode_number >= MAX_FILES) {
+            ok = 0;
+            break;
+        }
+        int i = record.inode_number;
+        Inode old = fs.inodes[i];
+        Inode *inode = &record.inode;
+        int old_pages = !was_free[i] && old.file_type == FILE_TYPE_REGULAR ? old.page_count : 0;
+        int new_pages = record.allocated && inode->file_type == FILE_TYPE_REGULAR ? inode->page_count : 0;
+
+        // Construire la liste des pages locales du nouvel inode / 构建新 inode 的本地页面列表
+        unsigned char kept[MAX_FILE_PAGES] = {0};
+        for (int j = 0; ok && j < new_pages; j++) {
+            int source_page = inode->pages[j];
+            if (record.page_source[j] == PAGE_FROM_HOLE) {
+                inode->pages[j] = PAGE_HOLE;
+            } else if (record.page_source[j] == PAGE_FROM_BASE && j < old_pages) {
+                inode->pages[j] = old.pages[j];
+                kept[j] = 1;
+            } else if (record.page_source[j] == PAGE_SHARED && page_map[source_page] != -1) {
+                inode->pages[j] = page_map[source_page];
+                share_page(inode->pages[j]);
+            } else if (record.page_source[j] == PAGE_FROM_STREAM) {
+                int page = allocate_page();
+                if (page == -1 || fread(fs.page_table[page].data, PAGE_SIZE, 1, in) != 1) {
+                    ok = 0;
+                    break;
+                }
+                page = dedup_page(page);
+                page_map[source_page] = page;
+                inode->pages[j] = page;
+            } else {
+                ok = 0;
+            }
+        }
+        if (!ok) break;
+
+        // Relâcher les anciennes pages qui ne sont pas reprises / 释放未被沿用的旧页面
+        for (int j = 0; j < old_pages; j++) {
+            if (j >= new_pages || !kept[j]) free_page(old.pages[j]);
+        }
+        if (record.allocated) fs.inodes[i] = *inode;
+        page_cache_invalidate(i);
+    }
+
+    for (int r = 0; ok && r < header.entry_records; r++) {
+        EntryRecord record;
+        if (fread(&record, sizeof(record), 1, in) != 1 || record.slot < 0 || record.slot >= MAX_FILES) {
+            ok = 0;
+            break;
+        }
+        fs.directory[record.slot] = record.entry;
+    }
+    fclose(in);
+
+    // Reconstruire la liste des inodes libres dans l'ordre du volume source / 按源卷的顺序重建空闲 inode 链表
+    fs.free_inode_head = header.free_inodes > 0 ? free_list[0] : -1;
+    for (int k = 0; k < header.free_inodes; k++) {
+        if (free_list[k] < 0 || free_list[k] >= MAX_FILES) continue;
+        fs.inodes[free_list[k]].link_count = k + 1 < header.free_inodes ? free_list[k + 1] : -1;
+    }
+
+    if (!ok) {
+        // Ne pas écrire un flux à moitié appliqué / 不写入只应用了一半的流
+        discard_changes();
+        load_superblock();
+        command_error("Failed to apply stream, volume left unchanged\n");
+    } else {
+        save_superblock();
+        if (metadata_fingerprint(fs.inodes, fs.directory, fs.free_inode_head) != header.target_fingerprint) {
+            command_error("Stream applied but the volume does not match the source\n");
+        } else {
+            printf("Stream received: %d inodes, %d entries, %d pages\n",
+                   header.inode_records, header.entry_records, header.data_pages);
+        }
+    }
+    if (get_inode_from_path(current_path) == -1) {
+        strcpy(current_path, "/");
+    }
+}
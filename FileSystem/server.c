@@ -0,0 +1,368 @@
+/**
+* @file server.c
+* @brief Mode serveur : un processus garde le volume chargé et sert plusieurs clients sur une socket Unix
+* @author jzy
+* @date 2025-4-21
+*/
+#include "filesystem.h"
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define REQUEST_MAGIC 0x51534656u   // "VFSQ"
+#define RESPONSE_MAGIC 0x52534656u  // "VFSR"
+#define MAX_REQUEST_LENGTH (MAX_PATH_LENGTH + MAX_COMMAND_LENGTH)  // Taille maximale du contenu d'une requête / 请求内容的最大长度
+#define MAX_CLIENTS 64              // Nombre maximum de clients connectés / 最大连接客户端数
+#define COMMIT_INTERVAL 1           // Secondes entre deux écritures du volume / 两次写入卷之间的秒数
+
+// En-tête d'une requête, suivi de length octets : le répertoire courant du client puis les mots,
+// chacun terminé par '\0' / 请求头，后跟 length 字节：客户端当前目录和各个单词，均以 '\0' 结尾
+typedef struct {
+    uint32_t magic;
+    uint16_t argc;
+    uint16_t length;
+} RequestHeader;
+
+// En-tête d'une réponse, suivi de la sortie de la commande puis du nouveau répertoire courant / 响应头，后跟命令输出和新的当前目录
+typedef struct {
+    uint32_t magic;
+    int32_t status;
+    uint32_t output_length;
+    uint32_t cwd_length;
+} ResponseHeader;
+
+// Un client connecté / 已连接的客户端
+typedef struct {
+    int fd;
+    pid_t reader;  // Processus qui sert une lecture en cours, 0 sinon / 正在处理读请求的进程，没有则为 0
+} Client;
+
+static volatile sig_atomic_t server_stop = 0;
+
+/**
+ * @brief Demander l'arrêt du serveur (SIGINT, SIGTERM)
+ * @param sig Le signal reçu
+ * @return Aucun
+ */
+static void handle_stop(int sig) {
+    (void)sig;
+    server_stop = 1;
+}
+
+/**
+ * @brief Lire exactement len octets d'une socket
+ * @param fd La socket
+ * @param buffer Le tampon
+ * @param len Le nombre d'octets
+ * @return 0 en cas de succès, -1 en cas d'erreur ou de fin de connexion
+ */
+static int read_full(int fd, void *buffer, size_t len) {
+    char *p = buffer;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Écrire exactement len octets sur une socket
+ * @param fd La socket
+ * @param buffer Les données
+ * @param len Le nombre d'octets
+ * @return 0 en cas de succès, -1 en cas d'erreur
+ */
+static int write_full(int fd, const void *buffer, size_t len) {
+    const char *p = buffer;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Exécuter une commande en capturant sa sortie, puis envoyer la réponse au client
+ * @param fd La socket du client
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @return Aucun
+ */
+static void serve_command(int fd, int argc, char *argv[]) {
+    // La sortie standard est redirigée vers un fichier temporaire / 标准输出被重定向到临时文件
+    FILE *capture = tmpfile();
+    int saved_stdout = dup(STDOUT_FILENO);
+    fflush(stdout);
+    if (capture) dup2(fileno(capture), STDOUT_FILENO);
+
+    ResponseHeader response = { RESPONSE_MAGIC, 0, 0, 0 };
+    // Les clients partagent la session du serveur : pas de transaction par client / 客户端共享服务器会话：不支持单个客户端的事务
+    if (command_is_local_only(argc, argv)) {
+        command_error("Not available in server mode\n");
+        response.status = COMMAND_FAILED;
+    } else {
+        response.status = execute_command(argc, argv);
+    }
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    char *output = NULL;
+    if (capture) {
+        off_t length = lseek(fileno(capture), 0, SEEK_END);
+        output = malloc(length > 0 ? length : 1);
+        if (output && length > 0 && pread(fileno(capture), output, length, 0) == length) {
+            response.output_length = length;
+        }
+        fclose(capture);
+    }
+    response.cwd_length = strlen(current_path);
+
+    if (write_full(fd, &response, sizeof(response)) == 0 &&
+        write_full(fd, output, response.output_length) == 0) {
+        write_full(fd, current_path, response.cwd_length);
+    }
+    free(output);
+}
+
+/**
+ * @brief Lire et traiter une requête d'un client
+ * @details Les commandes en lecture seule sont servies par un processus fils, qui voit une copie
+ *          cohérente du volume et s'exécute en parallèle avec les autres requêtes ; les autres
+ *          commandes sont exécutées une à une par le serveur
+ * @param client Le client
+ * @param listener La socket d'écoute (fermée dans le fils)
+ * @return 0 si la connexion reste ouverte, -1 si elle doit être fermée
+ */
+static int handle_request(Client *client, int listener) {
+    RequestHeader request;
+    char words[MAX_REQUEST_LENGTH + 1];
+    if (read_full(client->fd, &request, sizeof(request)) != 0 || request.magic != REQUEST_MAGIC ||
+        request.length > MAX_REQUEST_LENGTH || request.argc == 0 || request.argc > MAX_COMMAND_ARGS ||
+        read_full(client->fd, words, request.length) != 0) {
+        return -1;
+    }
+    words[request.length] = '\0';
+
+    // Le répertoire courant puis les mots / 当前目录和各个单词
+    size_t pos = strlen(words) + 1;
+    if (words[0] != '/' || pos > MAX_PATH_LENGTH) return -1;
+    strcpy(current_path, words);
+    char *argv[MAX_COMMAND_ARGS];
+    int argc = 0;
+    for (; pos < request.length && argc < request.argc; pos += strlen(words + pos) + 1) {
+        argv[argc++] = words + pos;
+    }
+    if (argc != request.argc) return -1;
+
+    if (command_is_read_only(argc, argv)) {
+        // Recharger une image republiée une fois, avant de la partager avec le fils / 在与子进程共享之前，只重新加载一次已发布的镜像
+        refresh_session();
+        load_superblock();
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listener);
+            detach_disk_locks();
+            serve_command(client->fd, argc, argv);
+            _exit(0);
+        }
+        if (pid > 0) {
+            client->reader = pid;
+            return 0;
+        }
+        // fork impossible : servir la lecture directement / 无法 fork：直接处理读请求
+    }
+    serve_command(client->fd, argc, argv);
+    return 0;
+}
+
+/**
+ * @brief Servir le volume à plusieurs clients sur une socket Unix, jusqu'à SIGINT ou SIGTERM
+ * @details Le volume est chargé une seule fois ; les modifications sont écrites au plus toutes
+ *          les COMMIT_INTERVAL secondes, sur la commande sync et à l'arrêt du serveur
+ * @param socket_path Le chemin de la socket
+ * @return Aucun
+ */
+void run_server(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long\n");
+        return;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 16) != 0) {
+        perror("Failed to listen on socket");
+        if (listener >= 0) close(listener);
+        return;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    batch_mode = 1;
+    begin_session();
+    acquire_disk_writer();  // Le serveur est le rédacteur de son volume / 服务器是其卷的写者
+    fprintf(stderr, "Serving %s on %s\n", DISK_FILE, socket_path);
+
+    Client clients[MAX_CLIENTS];
+    int client_count = 0;
+    time_t last_commit = time(NULL);
+
+    while (!server_stop) {
+        // Les clients dont une lecture est en cours ne sont pas écoutés / 不监听有读请求正在处理的客户端
+        struct pollfd fds[MAX_CLIENTS + 1];
+        int polled[MAX_CLIENTS];
+        int nfds = 1;
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < client_count; i++) {
+            if (clients[i].reader) continue;
+            polled[nfds - 1] = i;
+            fds[nfds].fd = clients[i].fd;
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+        int ready = poll(fds, nfds, 100);
+
+        // Récupérer les lectures terminées / 回收已完成的读请求
+        pid_t pid;
+        while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+            for (int i = 0; i < client_count; i++) {
+                if (clients[i].reader == pid) clients[i].reader = 0;
+            }
+        }
+
+        if (ready > 0) {
+            for (int k = 1; k < nfds; k++) {
+                if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+                Client *client = &clients[polled[k - 1]];
+                if (handle_request(client, listener) != 0) {
+                    close(client->fd);
+                    client->fd = -1;
+                }
+            }
+            if (fds[0].revents & POLLIN) {
+                int fd = accept(listener, NULL, NULL);
+                if (fd >= 0 && client_count < MAX_CLIENTS) {
+                    clients[client_count].fd = fd;
+                    clients[client_count].reader = 0;
+                    client_count++;
+                } else if (fd >= 0) {
+                    close(fd);
+                }
+            }
+            // Retirer les clients déconnectés / 移除已断开的客户端
+            int kept = 0;
+            for (int i = 0; i < client_count; i++) {
+                if (clients[i].fd >= 0) clients[kept++] = clients[i];
+            }
+            client_count = kept;
+        }
+
+        if (time(NULL) - last_commit >= COMMIT_INTERVAL) {
+            // Les ajouts des clients sont écrits au même rythme que le reste / 客户端的追加内容与其他修改按相同节奏写入
+            sync_append_buffers(1);
+            commit_session();
+            last_commit = time(NULL);
+        }
+    }
+
+    // Attendre les lectures en cours puis tout écrire / 等待进行中的读请求，然后全部写入
+    while (wait(NULL) > 0) {}
+    sync_append_buffers(1);
+    end_session();
+    for (int i = 0; i < client_count; i++) close(clients[i].fd);
+    close(listener);
+    unlink(socket_path);
+    fprintf(stderr, "Server stopped\n");
+}
+
+/**
+ * @brief Se connecter au serveur d'un volume
+ * @param socket_path Le chemin de la socket
+ * @return La socket connectée, ou -1 en cas d'échec
+ */
+int connect_server(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("Failed to connect to server");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    return fd;
+}
+
+/**
+ * @brief Exécuter une commande sur le serveur et afficher sa sortie
+ * @details Le répertoire courant est conservé côté client et transmis avec chaque requête
+ * @param fd La socket connectée
+ * @param argc Le nombre de mots
+ * @param argv Les mots
+ * @return Le statut de la commande (COMMAND_OK, COMMAND_INVALID...), ou COMMAND_EXIT si la connexion est perdue
+ */
+int remote_command(int fd, int argc, char *argv[]) {
+    if (strcmp(argv[0], "exit") == 0) return COMMAND_EXIT;
+
+    RequestHeader request = { REQUEST_MAGIC, (uint16_t)argc, 0 };
+    char words[MAX_REQUEST_LENGTH];
+    for (int i = -1; i < argc; i++) {
+        const char *word = i < 0 ? current_path : argv[i];
+        size_t len = strlen(word) + 1;
+        if (request.length + len > MAX_REQUEST_LENGTH) return COMMAND_INVALID;
+        memcpy(words + request.length, word, len);
+        request.length += len;
+    }
+
+    ResponseHeader response;
+    if (write_full(fd, &request, sizeof(request)) != 0 || write_full(fd, words, request.length) != 0 ||
+        read_full(fd, &response, sizeof(response)) != 0 || response.magic != RESPONSE_MAGIC) {
+        fprintf(stderr, "Connection to server lost\n");
+        return COMMAND_EXIT;
+    }
+
+    // Recopier la sortie par blocs / 分块复制输出
+    char buffer[4096];
+    uint32_t remaining = response.output_length;
+    while (remaining > 0) {
+        size_t chunk = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+        if (read_full(fd, buffer, chunk) != 0) {
+            fprintf(stderr, "Connection to server lost\n");
+            return COMMAND_EXIT;
+        }
+        fwrite(buffer, 1, chunk, stdout);
+        remaining -= chunk;
+    }
+    if (response.cwd_length >= MAX_PATH_LENGTH || read_full(fd, current_path, response.cwd_length) != 0) {
+        fprintf(stderr, "Connection to server lost\n");
+        return COMMAND_EXIT;
+    }
+    current_path[response.cwd_length] = '\0';
+    return response.status;
+}
@@ -0,0 +1,403 @@
+/**
+* @file snapshot.c
+* @brief Instantanés du volume par copie sur écriture des métadonnées et des pages
+* @author jzy
+* @date 2025-4-16
+*/
+#include "filesystem.h"
+
+extern SuperBlock fs;
+
+#define SNAPSHOT_FILE_FORMAT "virtual_disk.snap.%d"  // Fichier des blocs conservés d'un instantané / 快照保存块的文件
+#define TOTAL_PAGES (MAX_FILES * MAX_FILE_PAGES)
+
+// En-tête du fichier d'un instantané / 快照文件头
+// Le fichier contient ensuite une place pour chaque bloc d'inodes puis de répertoire; seuls les blocs
+// modifiés après la création de l'instantané y sont écrits / 文件之后为每个 inode 块和目录块预留位置；只写入快照创建后被修改的块
+typedef struct {
+    int free_inode_head;                       // Tête de la liste des inodes libres / 空闲 inode 链表头
+    unsigned char block_saved[2 * META_BLOCKS]; // Blocs présents dans le fichier (inodes puis répertoire) / 文件中已有的块（先 inode 后目录）
+    unsigned char pages[(TOTAL_PAGES + 7) / 8]; // Pages retenues par l'instantané / 快照保留的页面
+} SnapshotHeader;
+
+/**
+ * @brief Construire le nom du fichier d'un instantané
+ * @param id L'identifiant de l'instantané
+ * @param file_name Le tampon recevant le nom
+ * @return Aucun
+ */
+static void snapshot_file_name(int id, char *file_name) {
+    sprintf(file_name, SNAPSHOT_FILE_FORMAT, id);
+}
+
+/**
+ * @brief Obtenir la position et la taille d'un bloc de métadonnées
+ * @param block Le numéro du bloc : d'abord les blocs d'inodes, puis ceux du répertoire
+ * @param size Reçoit la taille du bloc en octets
+ * @return La position du bloc dans le fichier de l'instantané
+ */
+static long block_offset(int block, size_t *size) {
+    int index = block % META_BLOCKS;
+    int first = index * META_BLOCK_ENTRIES;
+    int count = MAX_FILES - first < META_BLOCK_ENTRIES ? MAX_FILES - first : META_BLOCK_ENTRIES;
+    if (block < META_BLOCKS) {
+        *size = count * sizeof(Inode);
+        return sizeof(SnapshotHeader) + first * sizeof(Inode);
+    }
+    *size = count * sizeof(DirectoryEntry);
+    return sizeof(SnapshotHeader) + MAX_FILES * sizeof(Inode) + first * sizeof(DirectoryEntry);
+}
+
+/**
+ * @brief Obtenir l'adresse d'un bloc dans des tables d'inodes et de répertoire
+ * @param block Le numéro du bloc
+ * @param inodes La table d'inodes
+ * @param directory La table du répertoire
+ * @return L'adresse du premier octet du bloc
+ */
+static char *block_data(int block, Inode *inodes, DirectoryEntry *directory) {
+    int first = (block % META_BLOCKS) * META_BLOCK_ENTRIES;
+    return block < META_BLOCKS ? (char *)&inodes[first] : (char *)&directory[first];
+}
+
+/**
+ * @brief Lire l'en-tête d'un instantané
+ * @param file Le fichier de l'instantané
+ * @param header Reçoit l'en-tête
+ * @return 1 en cas de succès, 0 sinon
+ */
+static int read_header(FILE *file, SnapshotHeader *header) {
+    fseek(file, 0, SEEK_SET);
+    return fread(header, sizeof(SnapshotHeader), 1, file) == 1;
+}
+
+/**
+ * @brief Écrire l'en-tête d'un instantané
+ * @param file Le fichier de l'instantané
+ * @param header L'en-tête à écrire
+ * @return 1 en cas de succès, 0 sinon
+ */
+static int write_header(FILE *file, const SnapshotHeader *header) {
+    fseek(file, 0, SEEK_SET);
+    return fwrite(header, sizeof(SnapshotHeader), 1, file) == 1;
+}
+
+/**
+ * @brief Ouvrir le fichier d'un instantané
+ * @param id L'identifiant de l'instantané
+ * @param mode Le mode d'ouverture
+ * @return Le fichier ouvert, ou NULL en cas d'échec
+ */
+static FILE *open_snapshot(int id, const char *mode) {
+    char file_name[64];
+    snapshot_file_name(id, file_name);
+    FILE *file = fopen(file_name, mode);
+    if (!file) {
+        command_error("Cannot open snapshot file %s\n", file_name);
+    }
+    return file;
+}
+
+/**
+ * @brief Conserver pour le dernier instantané les blocs de métadonnées qui vont être écrasés
+ * @details Appelée par save_superblock avec les métadonnées telles qu'elles sont sur le disque. Seul
+ *          l'instantané le plus récent a besoin de l'ancienne version : les plus anciens la retrouvent
+ *          chez leurs successeurs.
+ * @param old_inodes La table d'inodes sur le disque
+ * @param old_directory La table du répertoire sur le disque
+ * @return Aucun
+ */
+void snapshot_preserve_metadata(const Inode *old_inodes, const DirectoryEntry *old_directory) {
+    if (fs.snapshot_count == 0) return;
+
+    FILE *file = NULL;
+    SnapshotHeader header;
+    for (int b = 0; b < 2 * META_BLOCKS; b++) {
+        size_t size;
+        long offset = block_offset(b, &size);
+        const char *old_data = block_data(b, (Inode *)old_inodes, (DirectoryEntry *)old_directory);
+        if (memcmp(old_data, block_data(b, fs.inodes, fs.directory), size) == 0) continue;
+
+        // Ouvrir le fichier au premier bloc modifié seulement / 只在第一个被修改的块时打开文件
+        if (!file) {
+            file = open_snapshot(fs.snapshots[fs.snapshot_count - 1].id, "rb+");
+            if (!file) return;
+            if (!read_header(file, &header)) {
+                fclose(file);
+                return;
+            }
+        }
+        if (header.block_saved[b]) continue;
+        fseek(file, offset, SEEK_SET);
+        if (fwrite(old_data, size, 1, file) == 1) {
+            header.block_saved[b] = 1;
+        }
+    }
+    if (file) {
+        write_header(file, &header);
+        fclose(file);
+    }
+}
+
+/**
+ * @brief Chercher un instantané par son nom
+ * @param name Le nom de l'instantané
+ * @return Sa position dans fs.snapshots, ou -1 s'il n'existe pas
+ */
+int find_snapshot(const char *name) {
+    for (int i = 0; i < fs.snapshot_count; i++) {
+        if (strcmp(fs.snapshots[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Marquer les inodes libres d'une table d'inodes en parcourant sa liste libre
+ * @param inodes La table d'inodes
+ * @param head La tête de la liste libre
+ * @param is_free Reçoit 1 pour chaque inode libre
+ * @return Aucun
+ */
+void mark_free_inodes(const Inode *inodes, int head, unsigned char *is_free) {
+    memset(is_free, 0, MAX_FILES);
+    for (int i = head, steps = 0; i >= 0 && i < MAX_FILES && !is_free[i] && steps < MAX_FILES; steps++) {
+        is_free[i] = 1;
+        i = inodes[i].link_count;
+    }
+}
+
+/**
+ * @brief Créer un instantané
+ * @details Seul l'en-tête est écrit : les blocs de métadonnées sont copiés plus tard, quand ils sont
+ *          modifiés, et les pages utilisées sont retenues pour être copiées avant toute écriture.
+ * @param name Le nom de l'instantané
+ * @return Aucun
+ */
+static void snapshot_create(const char *name) {
+    if (find_snapshot(name) != -1) {
+        command_error("Snapshot already exists\n");
+        return;
+    }
+    if (fs.snapshot_count == MAX_SNAPSHOTS) {
+        command_error("Too many snapshots\n");
+        return;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.free_inode_head = fs.free_inode_head;
+    for (int p = 0; p < TOTAL_PAGES; p++) {
+        if (fs.page_table[p].is_used && fs.page_table[p].ref_count > 0) {
+            header.pages[p / 8] |= 1 << (p % 8);
+        }
+    }
+
+    int id = fs.next_snapshot_id;
+    FILE *file = open_snapshot(id, "wb");
+    if (!file) return;
+    int ok = write_header(file, &header);
+    fclose(file);
+    if (!ok) {
+        command_error("Failed to write snapshot\n");
+        return;
+    }
+
+    for (int p = 0; p < TOTAL_PAGES; p++) {
+        if (header.pages[p / 8] & (1 << (p % 8))) pin_page(p);
+    }
+    SnapshotInfo *info = &fs.snapshots[fs.snapshot_count++];
+    info->id = id;
+    strncpy(info->name, name, MAX_FILENAME_LENGTH - 1);
+    info->name[MAX_FILENAME_LENGTH - 1] = '\0';
+    info->ctime = time(NULL);
+    fs.next_snapshot_id++;
+
+    save_superblock();
+    printf("Snapshot '%s' created\n", info->name);
+}
+
+/**
+ * @brief Supprimer un instantané
+ * @details Les blocs qu'il conservait et qui manquent à l'instantané précédent lui sont transmis
+ * @param index La position de l'instantané dans fs.snapshots
+ * @return Aucun
+ */
+static void snapshot_delete(int index) {
+    SnapshotHeader header;
+    FILE *file = open_snapshot(fs.snapshots[index].id, "rb");
+    if (!file) return;
+    if (!read_header(file, &header)) {
+        fclose(file);
+        command_error("Failed to read snapshot\n");
+        return;
+    }
+
+    if (index > 0) {
+        SnapshotHeader previous_header;
+        FILE *previous = open_snapshot(fs.snapshots[index - 1].id, "rb+");
+        if (!previous || !read_header(previous, &previous_header)) {
+            if (previous) fclose(previous);
+            fclose(file);
+            command_error("Failed to read snapshot\n");
+            return;
+        }
+        char block[META_BLOCK_ENTRIES * sizeof(Inode)];
+        for (int b = 0; b < 2 * META_BLOCKS; b++) {
+            if (!header.block_saved[b] || previous_header.block_saved[b]) continue;
+            size_t size;
+            long offset = block_offset(b, &size);
+            fseek(file, offset, SEEK_SET);
+            if (fread(block, size, 1, file) != 1) continue;
+            fseek(previous, offset, SEEK_SET);
+            if (fwrite(block, size, 1, previous) == 1) previous_header.block_saved[b] = 1;
+        }
+        write_header(previous, &previous_header);
+        fclose(previous);
+    }
+    fclose(file);
+
+    char file_name[64];
+    snapshot_file_name(fs.snapshots[index].id, file_name);
+    remove(file_name);
+
+    for (int p = 0; p < TOTAL_PAGES; p++) {
+        if (header.pages[p / 8] & (1 << (p % 8))) unpin_page(p);
+    }
+    char name[MAX_FILENAME_LENGTH];
+    strcpy(name, fs.snapshots[index].name);
+    memmove(&fs.snapshots[index], &fs.snapshots[index + 1], (fs.snapshot_count - index - 1) * sizeof(SnapshotInfo));
+    fs.snapshot_count--;
+
+    save_superblock();
+    printf("Snapshot '%s' deleted\n", name);
+}
+
+/**
+ * @brief Reconstituer les métadonnées d'un instantané
+ * @details Chaque bloc est pris dans l'instantané, sinon dans le premier instantané plus récent qui
+ *          le conserve, sinon dans les métadonnées actuelles.
+ * @param index La position de l'instantané dans fs.snapshots
+ * @param inodes Reçoit la table d'inodes de l'instantané
+ * @param directory Reçoit la table du répertoire de l'instantané
+ * @param free_inode_head Reçoit la tête de la liste des inodes libres de l'instantané
+ * @return 1 en cas de succès, 0 si un fichier d'instantané est illisible
+ */
+int snapshot_metadata(int index, Inode *inodes, DirectoryEntry *directory, int *free_inode_head) {
+    memcpy(inodes, fs.inodes, sizeof(fs.inodes));
+    memcpy(directory, fs.directory, sizeof(fs.directory));
+
+    // Du plus récent au plus ancien, pour que l'instantané demandé ait le dernier mot / 从新到旧，使目标快照的块最终生效
+    SnapshotHeader header;
+    for (int k = fs.snapshot_count - 1; k >= index; k--) {
+        FILE *file = open_snapshot(fs.snapshots[k].id, "rb");
+        if (!file) return 0;
+        if (!read_header(file, &header)) {
+            fclose(file);
+            command_error("Failed to read snapshot\n");
+            return 0;
+        }
+        for (int b = 0; b < 2 * META_BLOCKS; b++) {
+            if (!header.block_saved[b]) continue;
+            size_t size;
+            fseek(file, block_offset(b, &size), SEEK_SET);
+            if (fread(block_data(b, inodes, directory), size, 1, file) != 1) {
+                fclose(file);
+                command_error("Failed to read snapshot\n");
+                return 0;
+            }
+        }
+        fclose(file);
+    }
+    *free_inode_head = header.free_inode_head;
+    return 1;
+}
+
+/**
+ * @brief Ramener le volume à l'état d'un instantané
+ * @details L'instantané est conservé
+ * @param index La position de l'instantané dans fs.snapshots
+ * @return Aucun
+ */
+static void snapshot_restore(int index) {
+    static Inode inodes[MAX_FILES];
+    static DirectoryEntry directory[MAX_FILES];
+    int free_inode_head;
+    if (!snapshot_metadata(index, inodes, directory, &free_inode_head)) return;
+
+    // Relâcher les pages des fichiers actuels / 释放当前文件的页面
+    unsigned char is_free[MAX_FILES];
+    mark_free_inodes(fs.inodes, fs.free_inode_head, is_free);
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (is_free[i] || fs.inodes[i].file_type != FILE_TYPE_REGULAR) continue;
+        for (int j = 0; j < fs.inodes[i].page_count; j++) free_page(fs.inodes[i].pages[j]);
+    }
+
+    // Installer les métadonnées de l'instantané et reprendre ses pages, toujours retenues / 装入快照元数据并重新引用其页面（仍被保留）
+    memcpy(fs.inodes, inodes, sizeof(inodes));
+    memcpy(fs.directory, directory, sizeof(directory));
+    fs.free_inode_head = free_inode_head;
+    mark_free_inodes(fs.inodes, fs.free_inode_head, is_free);
+    for (int i = 0; i < MAX_FILES; i++) {
+        page_cache_invalidate(i);
+        if (is_free[i] || fs.inodes[i].file_type != FILE_TYPE_REGULAR) continue;
+        for (int j = 0; j < fs.inodes[i].page_count; j++) {
+            int page = fs.inodes[i].pages[j];
+            if (page == PAGE_HOLE) continue;
+            fs.page_table[page].is_used = 1;
+            fs.page_table[page].ref_count++;
+            mark_page_dirty(page);
+        }
+    }
+
+    save_superblock();
+    if (get_inode_from_path(current_path) == -1) {
+        strcpy(current_path, "/");
+    }
+    printf("Snapshot '%s' restored\n", fs.snapshots[index].name);
+}
+
+/**
+ * @brief Commande snapshot : créer, lister, supprimer ou restaurer un instantané
+ * @param action "create", "list", "delete" ou "restore"
+ * @param name Le nom de l'instantané (NULL pour list)
+ * @return Aucun
+ */
+void snapshot_command(const char *action, const char *name) {
+    load_superblock();
+    commit_session();  // Les instantanés s'appuient sur l'état du disque / 快照依赖磁盘上的状态
+
+    if (strcmp(action, "list") == 0 && name == NULL) {
+        if (fs.snapshot_count == 0) {
+            printf("No snapshots\n");
+            return;
+        }
+        for (int i = 0; i < fs.snapshot_count; i++) {
+            char time_str[20];
+            strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&fs.snapshots[i].ctime));
+            printf("%-20s %s\n", fs.snapshots[i].name, time_str);
+        }
+        return;
+    }
+
+    if (name == NULL) {
+        command_error("Usage: snapshot create|delete|restore <name>, snapshot list\n");
+        return;
+    }
+    if (strcmp(action, "create") == 0) {
+        snapshot_create(name);
+        return;
+    }
+
+    int index = find_snapshot(name);
+    if (strcmp(action, "delete") == 0 || strcmp(action, "restore") == 0) {
+        if (index == -1) {
+            command_error("Snapshot not found\n");
+        } else if (strcmp(action, "delete") == 0) {
+            snapshot_delete(index);
+        } else {
+            snapshot_restore(index);
+        }
+        return;
+    }
+    command_error("Usage: snapshot create|delete|restore <name>, snapshot list\n");
+}
@@ -6,10 +6,335 @@
 */
 
 #include "filesystem.h"
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 SuperBlock fs;
-#define DISK_FILE "virtual_disk.dat"
-char current_path[MAX_PATH_LENGTH] = "/";
+__thread char current_path[MAX_PATH_LENGTH] = "/";
+int batch_mode = 0;
+int read_only_mount = 0;
+
+// Session : le superbloc reste en mémoire et n'est écrit qu'à la validation / 会话：超级块常驻内存，只在提交时写入
+static int session_active = 0;
+static int session_loaded = 0;
+static int session_dirty = 0;
+
+// Transaction : les commandes entre begin et commit sont validées en une fois / 事务：begin 与 commit 之间的命令一次性提交
+static int transaction_active = 0;
+static int transaction_session = 0;  // La session a été ouverte par begin / 会话由 begin 打开
+
+// Entre processus : un seul rédacteur, les lecteurs partagent l'image publiée / 进程之间：只有一个写者，读者共享已发布的镜像
+static int disk_writer = 0;                 // Ce processus détient le verrou du rédacteur / 本进程持有写者锁
+static unsigned int loaded_generation = 0;  // Génération de l'image en mémoire / 内存中镜像的版本号
+static pthread_mutex_t disk_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Pages modifiées depuis le dernier chargement / 自上次加载以来被修改的页面
+#define PAGE_HEADER_DIRTY 1  // Seul l'en-tête (compteur de références) a changé / 只有页头（引用计数）改变
+#define PAGE_DATA_DIRTY 2    // Le contenu a changé : toute l'entrée est écrite / 内容已改变：写入整个表项
+static unsigned char page_dirty[MAX_FILES * MAX_FILE_PAGES];
+
+/**
+ * @brief Marquer une page comme modifiée, pour qu'elle soit écrite à la prochaine sauvegarde
+ * @param page_number Le numéro de la page modifiée
+ * @return Aucun
+ */
+void mark_page_dirty(int page_number) {
+    page_dirty[page_number] = PAGE_DATA_DIRTY;
+}
+
+/**
+ * @brief Marquer l'en-tête d'une page comme modifié, sans son contenu
+ * @details Un partage (cp, dédup) ne change que le compteur de références : seul l'en-tête de
+ *          l'entrée est écrit, pas les PAGE_SIZE octets de données
+ * @param page_number Le numéro de la page
+ * @return Aucun
+ */
+static void mark_page_header_dirty(int page_number) {
+    if (!page_dirty[page_number]) page_dirty[page_number] = PAGE_HEADER_DIRTY;
+}
+
+// Métadonnées telles qu'elles sont sur le disque, pour repérer les blocs modifiés / 磁盘上的元数据副本，用于找出被修改的块
+static Inode loaded_inodes[MAX_FILES];
+static DirectoryEntry loaded_directory[MAX_FILES];
+
+/**
+ * @brief Mémoriser les métadonnées telles qu'elles sont sur le disque
+ * @return Aucun
+ */
+static void remember_metadata() {
+    memcpy(loaded_inodes, fs.inodes, sizeof(loaded_inodes));
+    memcpy(loaded_directory, fs.directory, sizeof(loaded_directory));
+}
+
+/**
+ * @brief Obtenir la position des données d'une page dans le fichier disque
+ * @param page_number Le numéro de la page
+ * @return La position du premier octet de données de la page
+ */
+long page_disk_offset(int page_number) {
+    return offsetof(SuperBlock, page_table) + (long)page_number * sizeof(PageTableEntry) + offsetof(PageTableEntry, data);
+}
+
+// Pages dont le checksum a déjà été vérifié depuis le chargement / 自加载以来已校验过的页面
+static unsigned char page_verified[MAX_FILES * MAX_FILE_PAGES];
+
+// Des blocs de métadonnées chargés ne correspondent pas à leur checksum / 已加载的元数据块与校验和不符
+static int metadata_mismatch = 0;
+
+/**
+ * @brief Vérifier le checksum d'une page lors de sa première lecture après le chargement
+ * @details Une page modifiée en mémoire n'est pas vérifiée: son checksum sera recalculé à la sauvegarde.
+ *          Une page corrompue est vérifiée à nouveau à chaque lecture. Un trou n'a pas de page à vérifier
+ * @param page_number Le numéro de la page lue (ou PAGE_HOLE)
+ * @return 1 si la page est intègre (ou déjà vérifiée, ou un trou), 0 si elle est corrompue
+ */
+int verify_page_checksum(int page_number) {
+    if (page_number == PAGE_HOLE) return 1;
+    if (page_verified[page_number] || page_dirty[page_number] == PAGE_DATA_DIRTY) return 1;
+
+    if (crc32c(fs.page_table[page_number].data, PAGE_SIZE) != fs.page_table[page_number].checksum) {
+        fprintf(stderr, "Checksum mismatch on page %d\n", page_number);
+        return 0;
+    }
+    page_verified[page_number] = 1;
+    return 1;
+}
+
+/**
+ * @brief Recalculer les checksums des blocs d'inodes et de répertoire
+ * @return Aucun
+ */
+static void update_metadata_checksums() {
+    for (int b = 0; b < META_BLOCKS; b++) {
+        int first = b * META_BLOCK_ENTRIES;
+        int count = MAX_FILES - first < META_BLOCK_ENTRIES ? MAX_FILES - first : META_BLOCK_ENTRIES;
+        fs.inode_checksums[b] = crc32c(&fs.inodes[first], count * sizeof(Inode));
+        fs.directory_checksums[b] = crc32c(&fs.directory[first], count * sizeof(DirectoryEntry));
+    }
+}
+
+/**
+ * @brief Vérifier les checksums des blocs d'inodes et de répertoire lus sur le disque
+ * @details Tant qu'un bloc ne correspond pas, les sauvegardes sont refusées : elles donneraient
+ *          de nouveaux checksums valides aux métadonnées corrompues
+ * @return Aucun
+ */
+static void verify_metadata_checksums() {
+    metadata_mismatch = 0;
+    for (int b = 0; b < META_BLOCKS; b++) {
+        int first = b * META_BLOCK_ENTRIES;
+        int count = MAX_FILES - first < META_BLOCK_ENTRIES ? MAX_FILES - first : META_BLOCK_ENTRIES;
+        if (crc32c(&fs.inodes[first], count * sizeof(Inode)) != fs.inode_checksums[b]) {
+            fprintf(stderr, "Checksum mismatch in inodes %d-%d\n", first, first + count - 1);
+            metadata_mismatch = 1;
+        }
+        if (crc32c(&fs.directory[first], count * sizeof(DirectoryEntry)) != fs.directory_checksums[b]) {
+            fprintf(stderr, "Checksum mismatch in directory entries %d-%d\n", first, first + count - 1);
+            metadata_mismatch = 1;
+        }
+    }
+}
+
+/**
+ * @brief Indiquer si des métadonnées chargées ne correspondent pas à leur checksum
+ * @return 1 si un bloc est corrompu et n'a pas été réparé, 0 sinon
+ */
+int metadata_damaged() {
+    return metadata_mismatch;
+}
+
+/**
+ * @brief Accepter les métadonnées actuelles : la prochaine sauvegarde recalcule leurs checksums
+ * @details Réservé à fsck repair, après avoir remis les métadonnées en cohérence
+ * @return Aucun
+ */
+void accept_metadata() {
+    metadata_mismatch = 0;
+}
+
+/**
+ * @brief Lire la génération de l'image publiée sur le disque
+ * @details L'appelant tient le verrou de l'image
+ * @return La génération, ou 0 s'il n'y a pas de disque
+ */
+unsigned int read_disk_generation() {
+    unsigned int generation = 0;
+    FILE *disk = fopen(DISK_FILE, "rb");
+    if (disk) {
+        if (fseek(disk, offsetof(SuperBlock, generation), SEEK_SET) != 0 ||
+            fread(&generation, sizeof(generation), 1, disk) != 1) {
+            generation = 0;
+        }
+        fclose(disk);
+    }
+    return generation;
+}
+
+// Journal de validation : une transaction y est écrite et synchronisée avant d'être écrite en place / 提交日志：事务先写入日志并同步，再原地写入
+#define JOURNAL_MAGIC "VFSJRNL"   // En-tête / 日志头
+#define JOURNAL_COMMIT "VFSDONE"  // Fin d'un journal complet / 完整日志的结尾
+
+typedef struct {
+    char magic[8];            // JOURNAL_MAGIC, ou JOURNAL_COMMIT à la fin / 开头为 JOURNAL_MAGIC，结尾为 JOURNAL_COMMIT
+    unsigned int records;     // Nombre d'étendues / 区间数量
+    unsigned int generation;  // Génération publiée par la validation / 本次提交发布的版本号
+} JournalHeader;
+
+typedef struct {
+    size_t offset;            // Position dans le fichier disque / 在磁盘文件中的位置
+    size_t length;
+    unsigned int checksum;    // CRC32C des données qui suivent / 随后数据的 CRC32C
+} JournalRecord;
+
+// Étendue du superbloc à écrire / 超级块中要写入的区间
+typedef struct {
+    size_t offset;
+    size_t length;
+} DiskExtent;
+
+static DiskExtent save_extents[MAX_FILES * MAX_FILE_PAGES + 2];
+static int journal_next_save = 0;  // La prochaine sauvegarde passe par le journal / 下一次保存经过日志
+
+/**
+ * @brief Écrire les étendues d'une sauvegarde dans le journal, puis le synchroniser
+ * @param extents Les étendues du superbloc en mémoire
+ * @param count Le nombre d'étendues
+ * @return 0, ou -1 si le journal n'a pas pu être écrit (il est alors supprimé)
+ */
+static int write_journal(const DiskExtent *extents, int count) {
+    FILE *journal = fopen(JOURNAL_FILE, "wb");
+    if (!journal) {
+        perror("Failed to create journal");
+        return -1;
+    }
+    static char buffer[1 << 16];
+    setvbuf(journal, buffer, _IOFBF, sizeof(buffer));
+
+    JournalHeader header = { JOURNAL_MAGIC, (unsigned int)count, fs.generation };
+    int ok = fwrite(&header, sizeof(header), 1, journal) == 1;
+    for (int i = 0; ok && i < count; i++) {
+        const char *data = (const char *)&fs + extents[i].offset;
+        JournalRecord record = { extents[i].offset, extents[i].length, crc32c(data, extents[i].length) };
+        ok = fwrite(&record, sizeof(record), 1, journal) == 1 && fwrite(data, extents[i].length, 1, journal) == 1;
+    }
+    memcpy(header.magic, JOURNAL_COMMIT, sizeof(header.magic));
+    ok = ok && fwrite(&header, sizeof(header), 1, journal) == 1;
+    ok = ok && fflush(journal) == 0 && fsync(fileno(journal)) == 0;
+    if (fclose(journal) != 0) ok = 0;
+
+    // Le nom du journal doit lui aussi survivre à une panne / 日志的目录项也必须在崩溃后保留
+    int dir = open(".", O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+    if (!ok) {
+        perror("Failed to write journal");
+        unlink(JOURNAL_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lire un journal complet
+ * @details Un journal sans marque de fin ou dont une étendue ne correspond pas à son checksum vient
+ *          d'une validation interrompue avant l'écriture en place : il est ignoré
+ * @param size Reçoit la taille du journal
+ * @return Le contenu du journal (à libérer), ou NULL s'il est absent ou incomplet
+ */
+static char *read_journal(size_t *size) {
+    FILE *file = fopen(JOURNAL_FILE, "rb");
+    if (!file) return NULL;
+    char *journal = NULL;
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) >= (long)(2 * sizeof(JournalHeader)) &&
+        fseek(file, 0, SEEK_SET) == 0 && (journal = malloc(length)) != NULL &&
+        fread(journal, length, 1, file) != 1) {
+        free(journal);
+        journal = NULL;
+    }
+    fclose(file);
+    if (journal == NULL) return NULL;
+
+    // Vérifier toutes les étendues avant d'en appliquer une seule / 在应用任何区间之前先校验全部区间
+    JournalHeader header, trailer;
+    memcpy(&header, journal, sizeof(header));
+    memcpy(&trailer, journal + length - sizeof(trailer), sizeof(trailer));
+    int ok = memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) == 0 &&
+             memcmp(trailer.magic, JOURNAL_COMMIT, sizeof(trailer.magic)) == 0 &&
+             trailer.records == header.records && trailer.generation == header.generation;
+    size_t pos = sizeof(header);
+    for (unsigned int i = 0; ok && i < header.records; i++) {
+        JournalRecord record;
+        ok = pos + sizeof(record) <= (size_t)length - sizeof(trailer);
+        if (!ok) break;
+        memcpy(&record, journal + pos, sizeof(record));
+        pos += sizeof(record);
+        ok = record.length <= (size_t)length - sizeof(trailer) - pos &&
+             record.offset <= sizeof(SuperBlock) && record.length <= sizeof(SuperBlock) - record.offset &&
+             crc32c(journal + pos, record.length) == record.checksum;
+        pos += record.length;
+    }
+    if (!ok || pos != (size_t)length - sizeof(trailer)) {
+        free(journal);
+        return NULL;
+    }
+    *size = (size_t)length;
+    return journal;
+}
+
+/**
+ * @brief Appliquer un journal complet au fichier disque ou au superbloc en mémoire
+ * @param journal Le contenu du journal, vérifié par read_journal()
+ * @param disk Le fichier disque, ou NULL pour appliquer au superbloc en mémoire
+ * @return 0, ou -1 si l'écriture sur le disque a échoué
+ */
+static int apply_journal(const char *journal, FILE *disk) {
+    JournalHeader header;
+    memcpy(&header, journal, sizeof(header));
+    size_t pos = sizeof(header);
+    int ok = 1;
+    for (unsigned int i = 0; ok && i < header.records; i++) {
+        JournalRecord record;
+        memcpy(&record, journal + pos, sizeof(record));
+        pos += sizeof(record);
+        if (disk == NULL) {
+            memcpy((char *)&fs + record.offset, journal + pos, record.length);
+        } else {
+            ok = fseek(disk, record.offset, SEEK_SET) == 0 && fwrite(journal + pos, record.length, 1, disk) == 1;
+        }
+        pos += record.length;
+    }
+    if (disk != NULL) ok = ok && fflush(disk) == 0 && fsync(fileno(disk)) == 0;
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Terminer une validation interrompue par une panne, avant de lire le disque
+ * @details Un journal complet est rejoué sur le fichier disque puis supprimé ; un journal incomplet
+ *          est supprimé, car rien n'avait encore été écrit en place
+ * @return Aucun
+ */
+static void recover_journal() {
+    if (access(JOURNAL_FILE, F_OK) != 0) return;
+    // Un rédacteur en cours de validation garde le verrou jusqu'à la suppression du journal / 正在提交的写者持有锁直到删除日志
+    lock_disk_image(1);
+    size_t size;
+    char *journal = read_journal(&size);
+    int ok = 1;
+    if (journal != NULL) {
+        FILE *disk = fopen(DISK_FILE, "rb+");
+        ok = disk != NULL && apply_journal(journal, disk) == 0;
+        if (disk) fclose(disk);
+        if (ok) fprintf(stderr, "Recovered an interrupted commit from the journal\n");
+        else perror("Failed to replay journal");
+        free(journal);
+    }
+    if (ok) unlink(JOURNAL_FILE);
+    unlock_disk_image();
+}
 
 // Initialisation du système de fichiers / 文件系统初始化
 // Fonction auxiliaire pour écrire la structure dans le fichier / 将结构体写入文件的辅助函数
@@ -29,7 +354,14 @@ size_t write_superblock(FILE* disk) {
  * @return Aucun
  */
 void format_partition() {
+    // La génération continue celle de l'ancien volume : les lecteurs verront le changement / 版本号延续旧卷，读者能发现变化
+    lock_disk_image(0);
+    unsigned int generation = read_disk_generation() + 1;
+    unlock_disk_image();
+
     // Créer ou écraser le fichier disque / 创建或覆盖磁盘文件
+    lock_disk_image(1);
+    unlink(JOURNAL_FILE);  // Un ancien journal ne s'applique pas au nouveau volume / 旧日志不适用于新卷
     FILE* disk = fopen(DISK_FILE, "wb+");
     if (!disk) {
         perror("Failed to create virtual disk");
@@ -57,6 +389,7 @@ void format_partition() {
         }
     }
     fs.free_page_head = 0;
+    fs.generation = generation;
 
     // Créer le répertoire racine / 创建根目录
     int root_inode = allocate_inode();
@@ -80,6 +413,10 @@ void format_partition() {
         fs.directory[i].name[0] = '\0';
     }
 
+    update_metadata_checksums();
+    remember_metadata();
+    metadata_mismatch = 0;
+
     // Écrire le superbloc initialisé sur le disque / 将初始化好的超级块写入磁盘
     if (write_superblock(disk) != 1) {
         fprintf(stderr, "Failed to write superblock\n");
@@ -88,46 +425,316 @@ void format_partition() {
     }
 
     fclose(disk);
+    unlock_disk_image();
+    loaded_generation = generation;
+    memset(page_dirty, 0, sizeof(page_dirty));
+    session_loaded = session_active;
+    session_dirty = 0;
     printf("Virtual disk formatted successfully\n");
     strcpy(current_path, "/");
 }
 
-// Charger le superbloc du disque en mémoire / 从磁盘加载超级块到内存
 /**
- * @brief Charger le superbloc depuis le disque en mémoire
- * @return Aucun
+ * @brief Charger le superbloc depuis le disque en mémoire, sans quitter le programme en cas d'échec
+ * @details Dans une session, seul le premier appel lit le disque. Utilisée par la bibliothèque (vfs_mount)
+ * @return 0, ou -1 si le fichier disque ne peut pas être ouvert ou lu
  */
-void load_superblock() {
-    FILE* disk = fopen(DISK_FILE, "rb+");
+int read_superblock() {
+    if (session_loaded) return 0;
+    if (!read_only_mount) recover_journal();
+    // Les lecteurs ne s'attendent pas entre eux, seulement pendant une publication / 读者之间互不等待，只等待发布
+    lock_disk_image(0);
+    FILE* disk = fopen(DISK_FILE, "rb");
     if (!disk) {
         perror("Failed to open virtual disk");
-        exit(EXIT_FAILURE);
+        unlock_disk_image();
+        return -1;
     }
-    
+
     if (fread(&fs, sizeof(SuperBlock), 1, disk) != 1) {
         fprintf(stderr, "Failed to read superblock\n");
         fclose(disk);
-        exit(EXIT_FAILURE);
+        unlock_disk_image();
+        return -1;
+    }
+    // Un montage en lecture seule ne peut pas rejouer le journal sur le disque : il l'applique en mémoire / 只读挂载无法在磁盘上重放日志：在内存中应用
+    if (read_only_mount) {
+        size_t size;
+        char *journal = read_journal(&size);
+        if (journal != NULL) {
+            apply_journal(journal, NULL);
+            free(journal);
+        }
     }
     fclose(disk);
+    unlock_disk_image();
+
+    // Une image republiée par un autre processus rend les pages en cache périmées / 其他进程重新发布的镜像使缓存页失效
+    if (fs.generation != loaded_generation) {
+        for (int i = 0; i < MAX_FILES; i++) page_cache_invalidate(i);
+        loaded_generation = fs.generation;
+    }
+    memset(page_dirty, 0, sizeof(page_dirty));
+    memset(page_verified, 0, sizeof(page_verified));
+    remember_metadata();
+
+    // Les pages sont vérifiées à leur première lecture, les métadonnées tout de suite / 页面在首次读取时校验，元数据立即校验
+    verify_metadata_checksums();
+    session_loaded = session_active;
+    return 0;
+}
+
+// Charger le superbloc du disque en mémoire / 从磁盘加载超级块到内存
+/**
+ * @brief Charger le superbloc depuis le disque en mémoire
+ * @details Le shell ne peut pas continuer sans image : il s'arrête si la lecture échoue
+ * @return Aucun
+ */
+void load_superblock() {
+    if (read_superblock() != 0) exit(EXIT_FAILURE);
 }
 
 // Sauvegarder le superbloc de la mémoire sur le disque / 将内存中的超级块保存到磁盘
 /**
  * @brief Sauvegarder le superbloc de la mémoire sur le disque
- * @return Aucun
+ * @details Seules les métadonnées et les pages marquées comme modifiées sont écrites.
+ *          Dans une session, l'écriture est reportée à commit_session(). Seul le processus
+ *          rédacteur écrit : ailleurs (lectures, montage en lecture seule), les dates d'accès
+ *          restent en mémoire. Rien n'est écrit tant que des métadonnées corrompues n'ont pas été
+ *          réparées par fsck repair. Après un échec, l'image en mémoire est conservée et les pages
+ *          restent marquées : la sauvegarde suivante réessaie
+ * @return 0, ou -1 si rien n'a pu être écrit (métadonnées corrompues, erreur d'entrée/sortie)
  */
-void save_superblock() {
+int save_superblock() {
+    if (read_only_mount || !disk_writer) return 0;
+    if (metadata_mismatch && !session_active) {
+        fprintf(stderr, "Metadata checksum mismatch, changes not saved: run 'fsck repair'\n");
+        return -1;
+    }
+    if (session_active) {
+        // Lecteurs parallèles : ne rien écrire si le drapeau est déjà levé / 并行读者：标志已置位时不写入
+        if (!__atomic_load_n(&session_dirty, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&session_dirty, 1, __ATOMIC_RELAXED);
+        }
+        return 0;
+    }
+    lock_disk_image(1);
     FILE* disk = fopen(DISK_FILE, "rb+");
     if (!disk) {
         perror("Failed to open virtual disk");
-        exit(EXIT_FAILURE);
+        unlock_disk_image();
+        return -1;
     }
-    
-    if (fwrite(&fs, sizeof(SuperBlock), 1, disk) != 1) {
+
+    // Les tables d'inodes et de répertoires / inode 表和目录表
+    size_t pages_offset = offsetof(SuperBlock, page_table);
+    size_t tail_offset = offsetof(SuperBlock, free_inode_head);
+    // Les blocs modifiés sont d'abord conservés pour le dernier instantané / 被修改的块先为最新快照保存
+    snapshot_preserve_metadata(loaded_inodes, loaded_directory);
+    update_metadata_checksums();
+    int count = 0;
+    save_extents[count++] = (DiskExtent){ 0, pages_offset };
+
+    // Uniquement les pages modifiées, avec leur nouveau checksum ; l'en-tête seul si le contenu n'a pas changé / 只写被修改的页面及其新的校验和；内容未变时只写页头
+    for (int i = 0; i < MAX_FILES * MAX_FILE_PAGES; i++) {
+        if (!page_dirty[i]) continue;
+        PageTableEntry *entry = &fs.page_table[i];
+        size_t length = offsetof(PageTableEntry, data);
+        if (page_dirty[i] == PAGE_DATA_DIRTY) {
+            entry->checksum = entry->is_used ? crc32c(entry->data, PAGE_SIZE) : 0;
+            page_verified[i] = 1;
+            length = sizeof(PageTableEntry);
+        }
+        save_extents[count++] = (DiskExtent){ pages_offset + (size_t)i * sizeof(PageTableEntry), length };
+    }
+
+    // Les têtes des listes libres, puis la nouvelle génération qui publie l'image / 空闲链表头，最后是发布镜像的新版本号
+    fs.generation++;
+    save_extents[count++] = (DiskExtent){ tail_offset, sizeof(SuperBlock) - tail_offset };
+
+    // Une transaction est d'abord rendue durable dans le journal : une panne pendant l'écriture en place
+    // est réparée au prochain chargement / 事务先在日志中持久化：原地写入时的崩溃在下次加载时修复
+    int journaled = journal_next_save;
+    int ok = !journaled || write_journal(save_extents, count) == 0;
+    for (int i = 0; ok && i < count; i++) {
+        ok = fseek(disk, save_extents[i].offset, SEEK_SET) == 0 &&
+             fwrite((char *)&fs + save_extents[i].offset, save_extents[i].length, 1, disk) == 1;
+    }
+    if (journaled && ok) {
+        ok = fflush(disk) == 0 && fsync(fileno(disk)) == 0;
+        if (ok) unlink(JOURNAL_FILE);
+    }
+    if (ok) {
+        remember_metadata();
+        memset(page_dirty, 0, sizeof(page_dirty));
+        loaded_generation = fs.generation;
+    } else {
+        fs.generation--;
         fprintf(stderr, "Failed to write superblock\n");
     }
     fclose(disk);
+    unlock_disk_image();
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Commencer une session : le superbloc est chargé une seule fois et les sauvegardes sont regroupées
+ * @return Aucun
+ */
+void begin_session() {
+    session_active = 1;
+    session_loaded = 0;
+    session_dirty = 0;
+}
+
+/**
+ * @brief Écrire sur le disque les modifications faites depuis le début de la session ou la dernière validation
+ * @details Appelée aussi avant les commandes qui lisent directement le fichier disque ou les instantanés.
+ *          Sans effet pendant une transaction : seul commit_transaction() écrit. Après un échec, les
+ *          modifications restent en attente
+ * @return 0, ou -1 si l'écriture a échoué
+ */
+int commit_session() {
+    if (!session_active || !session_dirty || transaction_active) return 0;
+    session_active = 0;
+    int status = save_superblock();
+    session_active = 1;
+    if (status == 0) session_dirty = 0;
+    return status;
+}
+
+/**
+ * @brief Valider les modifications en attente et terminer la session
+ * @return 0, ou -1 si l'écriture a échoué (les modifications sont perdues)
+ */
+int end_session() {
+    int status = commit_session();
+    session_active = 0;
+    session_loaded = 0;
+    release_disk_writer();
+    return status;
+}
+
+/**
+ * @brief Commencer une transaction : les modifications restent en mémoire jusqu'à commit_transaction()
+ * @details Hors session (mode interactif), une session est ouverte pour la durée de la transaction ;
+ *          dans une session, les modifications déjà faites sont d'abord validées
+ * @return 0, ou -1 si une transaction est déjà en cours
+ */
+int begin_transaction() {
+    if (transaction_active) return -1;
+    transaction_session = !session_active;
+    if (transaction_session) begin_session();
+    else commit_session();
+    transaction_active = 1;
+    return 0;
+}
+
+/**
+ * @brief Valider une transaction en une seule sauvegarde atomique
+ * @details La sauvegarde passe par le journal (JOURNAL_FILE), synchronisé avant l'écriture en place :
+ *          après une panne, le prochain chargement rejoue ou ignore toute la transaction
+ * @return 0, -1 s'il n'y a pas de transaction en cours, ou -2 si l'écriture a échoué (la transaction reste ouverte)
+ */
+int commit_transaction() {
+    if (!transaction_active) return -1;
+    transaction_active = 0;
+    journal_next_save = 1;
+    int status = commit_session();
+    journal_next_save = 0;
+    if (status != 0) {
+        // La transaction reste ouverte : elle peut être validée à nouveau ou annulée / 事务保持打开：可以重新提交或取消
+        transaction_active = 1;
+        return -2;
+    }
+    if (transaction_session) end_session();
+    return 0;
+}
+
+/**
+ * @brief Abandonner les modifications en mémoire qui n'ont pas encore été écrites
+ * @details L'image est rechargée depuis le disque au prochain load_superblock()
+ * @return Aucun
+ */
+void discard_changes() {
+    session_dirty = 0;
+    session_loaded = 0;
+    memset(page_dirty, 0, sizeof(page_dirty));
+    // Les pages décompressées en cache peuvent venir des modifications abandonnées / 缓存中的解压页面可能来自被放弃的修改
+    for (int i = 0; i < MAX_FILES; i++) page_cache_invalidate(i);
+}
+
+/**
+ * @brief Annuler une transaction : l'image est rechargée depuis le disque au prochain accès
+ * @return 0, ou -1 s'il n'y a pas de transaction en cours
+ */
+int abort_transaction() {
+    if (!transaction_active) return -1;
+    transaction_active = 0;
+    discard_changes();
+    if (transaction_session) end_session();
+    return 0;
+}
+
+/**
+ * @brief Indiquer si une transaction est en cours
+ * @return 1 si une transaction est en cours, 0 sinon
+ */
+int in_transaction() {
+    return transaction_active;
+}
+
+/**
+ * @brief Dans une session, recharger l'image au prochain load_superblock si un autre processus l'a republiée
+ * @details Coûte la lecture de la génération ; sans effet pour le rédacteur, dont l'image fait foi
+ * @return Aucun
+ */
+void refresh_session() {
+    if (!session_loaded || disk_writer || locking_enabled) return;
+    lock_disk_image(0);
+    if (read_disk_generation() != loaded_generation) session_loaded = 0;
+    unlock_disk_image();
+}
+
+/**
+ * @brief Devenir le processus rédacteur avant de modifier le volume
+ * @details Attend le rédacteur actuel, puis recharge l'image s'il l'a republiée entre-temps.
+ *          Hors session, le rôle est rendu à la fin de la commande ; dans une session, à sa fin
+ * @return Aucun
+ */
+void acquire_disk_writer() {
+    if (read_only_mount) return;
+    pthread_mutex_lock(&disk_writer_lock);
+    if (!disk_writer) {
+        lock_disk_writer();
+        refresh_session();
+        disk_writer = 1;
+    }
+    pthread_mutex_unlock(&disk_writer_lock);
+}
+
+/**
+ * @brief Rendre le rôle de rédacteur, hors session
+ * @return Aucun
+ */
+void release_disk_writer() {
+    if (session_active) return;
+    pthread_mutex_lock(&disk_writer_lock);
+    if (disk_writer) {
+        unlock_disk_writer();
+        disk_writer = 0;
+    }
+    pthread_mutex_unlock(&disk_writer_lock);
+}
+
+/**
+ * @brief Mettre à jour la date d'accès d'un inode
+ * @details Les lecteurs ne tiennent qu'un verrou partagé : l'écriture est atomique et la dernière gagne
+ * @param inode L'inode lu
+ * @return Aucun
+ */
+void touch_access_time(Inode *inode) {
+    __atomic_store_n(&inode->atime, time(NULL), __ATOMIC_RELAXED);
 }
 
 // Fonctions d'allocation des ressources / 资源分配函数
@@ -136,10 +743,15 @@ void save_superblock() {
  * @return Le numéro de l'inode alloué, ou -1 en cas d'échec
  */
 int allocate_inode() {
-    if (fs.free_inode_head == -1) return -1; // Pas d'inode libre / 没有空闲inode
+    lock_inode_allocator();
+    if (fs.free_inode_head == -1) { // Pas d'inode libre / 没有空闲inode
+        unlock_inode_allocator();
+        return -1;
+    }
     
     int allocated = fs.free_inode_head;
     fs.free_inode_head = fs.inodes[allocated].link_count; // Mettre à jour la tête de liste / 更新链表头
+    unlock_inode_allocator();
     
     // Initialiser l'inode / 初始化inode
     memset(&fs.inodes[allocated], 0, sizeof(Inode));
@@ -154,8 +766,11 @@ int allocate_inode() {
  * @return Aucun
  */
 void free_inode(int inode_number) {
+    lock_inode_allocator();
+    fs.inodes[inode_number].file_type = 0;  // Un inode libre n'a pas de type / 空闲 inode 没有类型
     fs.inodes[inode_number].link_count = fs.free_inode_head;
     fs.free_inode_head = inode_number;
+    unlock_inode_allocator();
 }
 
 /**
@@ -163,23 +778,124 @@ void free_inode(int inode_number) {
  * @return Le numéro de la page allouée, ou -1 en cas d'échec
  */
 int allocate_page() {
-    if (fs.free_page_head == -1) return -1;
+    lock_pages();
+    if (fs.free_page_head == -1) {
+        unlock_pages();
+        return -1;
+    }
     
     int allocated = fs.free_page_head;
     fs.free_page_head = *((int*)fs.page_table[allocated].data); // Obtenir la prochaine page libre / 获取下一个空闲页
     fs.page_table[allocated].is_used = 1;
+    fs.page_table[allocated].ref_count = 1;
+    mark_page_dirty(allocated);
+    unlock_pages();
     return allocated;
 }
 
 /**
- * @brief Libérer une page
+ * @brief Libérer une référence à une page
+ * @details La page ne retourne dans la liste libre que lorsque sa dernière référence est libérée
  * @param page_number Le numéro de la page à libérer
  * @return Aucun
  */
 void free_page(int page_number) {
+    if (page_number == PAGE_HOLE) return;
+    lock_pages();
+    mark_page_header_dirty(page_number);
+    if (--fs.page_table[page_number].ref_count > 0 || fs.snapshot_pins[page_number] > 0) {
+        unlock_pages();
+        return;  // Encore utilisée par un fichier ou un instantané / 仍被文件或快照使用
+    }
+
+    // Le chaînage de la liste libre est écrit dans les données / 空闲链表指针写在数据中
+    mark_page_dirty(page_number);
+    *((int*)fs.page_table[page_number].data) = fs.free_page_head;
+    fs.free_page_head = page_number;
+    fs.page_table[page_number].is_used = 0;
+    fs.page_table[page_number].ref_count = 0;
+    unlock_pages();
+}
+
+/**
+ * @brief Ajouter une référence à une page, pour la partager entre plusieurs fichiers
+ * @param page_number Le numéro de la page à partager
+ * @return Aucun
+ */
+void share_page(int page_number) {
+    if (page_number == PAGE_HOLE) return;
+    lock_pages();
+    fs.page_table[page_number].ref_count++;
+    mark_page_header_dirty(page_number);
+    unlock_pages();
+}
+
+/**
+ * @brief Indiquer si une page est partagée avec un autre fichier ou un instantané
+ * @param page_number Le numéro de la page
+ * @return 1 si la page doit être copiée avant d'être modifiée, 0 sinon
+ */
+int page_is_shared(int page_number) {
+    if (page_number == PAGE_HOLE) return 0;
+    return fs.page_table[page_number].ref_count + fs.snapshot_pins[page_number] > 1;
+}
+
+/**
+ * @brief Retenir une page pour un instantané
+ * @param page_number Le numéro de la page
+ * @return Aucun
+ */
+void pin_page(int page_number) {
+    lock_pages();
+    fs.snapshot_pins[page_number]++;
+    unlock_pages();
+}
+
+/**
+ * @brief Relâcher une page retenue par un instantané
+ * @details La page retourne dans la liste libre si plus aucun fichier ni instantané ne l'utilise
+ * @param page_number Le numéro de la page
+ * @return Aucun
+ */
+void unpin_page(int page_number) {
+    lock_pages();
+    if (--fs.snapshot_pins[page_number] > 0 || fs.page_table[page_number].ref_count > 0) {
+        unlock_pages();
+        return;
+    }
     *((int*)fs.page_table[page_number].data) = fs.free_page_head;
     fs.free_page_head = page_number;
     fs.page_table[page_number].is_used = 0;
+    mark_page_dirty(page_number);
+    unlock_pages();
+}
+
+/**
+ * @brief Obtenir une page modifiable (copie sur écriture)
+ * @details Une page partagée est copiée dans une nouvelle page, et la référence à l'ancienne est libérée ;
+ *          un trou est remplacé par une nouvelle page remplie de zéros
+ * @param page_number Le numéro de la page à modifier (ou PAGE_HOLE)
+ * @return Le numéro de la page à utiliser pour l'écriture, ou -1 s'il n'y a plus de page libre
+ */
+int unshare_page(int page_number) {
+    if (page_number == PAGE_HOLE) {
+        int page = allocate_page();
+        if (page != -1) memset(fs.page_table[page].data, 0, PAGE_SIZE);
+        return page;
+    }
+    lock_pages();
+    if (!page_is_shared(page_number)) {
+        unlock_pages();
+        return page_number;
+    }
+
+    int copy = allocate_page();
+    if (copy != -1) {
+        memcpy(fs.page_table[copy].data, fs.page_table[page_number].data, PAGE_SIZE);
+        free_page(page_number);
+    }
+    unlock_pages();
+    return copy;
 }
 
 // Obtenir le numéro d'inode à partir du chemin / 通过路径获取对应的inode编号
@@ -240,11 +956,12 @@ int get_inode_from_path(const char *path) {
 
 // Obtenir le numéro d'inode du répertoire parent à partir du chemin / 通过路径获取父目录的inode编号
 /**
- * @brief Obtenir le numéro d'inode du répertoire parent à partir d'un chemin
+ * @brief Résoudre le répertoire parent d'un chemin
  * @param path Le chemin à résoudre
+ * @param verbose 1 pour afficher la cause d'un échec, 0 pour rester silencieux (libvfs)
  * @return Le numéro d'inode du répertoire parent, ou -1 si non trouvé
  */
-int get_parent_directory_inode(const char *path) {
+static int resolve_parent_directory(const char *path, int verbose) {
     char normalized_path[MAX_PATH_LENGTH];
     
     // Traiter le chemin relatif / 处理相对路径
@@ -267,7 +984,7 @@ int get_parent_directory_inode(const char *path) {
     
     char *last_slash = strrchr(normalized_path, '/');
     if (!last_slash) {
-        printf("Invalid path: %s\n", path);
+        if (verbose) command_error("Invalid path: %s\n", path);
         return -1;
     }
     
@@ -277,12 +994,155 @@ int get_parent_directory_inode(const char *path) {
     parent_path[last_slash - normalized_path + 1] = '\0';
     int parent_inode = get_inode_from_path(parent_path);
     
-    if (parent_inode == -1) {
-        printf("Parent path invalid: %s\n", parent_path);
+    if (parent_inode == -1 && verbose) {
+        command_error("Parent path invalid: %s\n", parent_path);
     }
     return parent_inode;
 }
 
+/**
+ * @brief Obtenir le numéro d'inode du répertoire parent à partir d'un chemin
+ * @param path Le chemin à résoudre
+ * @return Le numéro d'inode du répertoire parent, ou -1 si non trouvé
+ */
+int get_parent_directory_inode(const char *path) {
+    return resolve_parent_directory(path, 1);
+}
+
+/**
+ * @brief Obtenir le numéro d'inode du répertoire parent sans rien afficher
+ * @param path Le chemin à résoudre
+ * @return Le numéro d'inode du répertoire parent, ou -1 si non trouvé
+ */
+int find_parent_directory_inode(const char *path) {
+    return resolve_parent_directory(path, 0);
+}
+
+/**
+ * @brief Construire le chemin absolu d'un chemin, sans barre oblique finale
+ * @param path Le chemin, absolu ou relatif au répertoire courant
+ * @param absolute Reçoit le chemin absolu (MAX_PATH_LENGTH octets)
+ * @return 0, ou VFS_ERR_INVALID si le chemin absolu dépasse MAX_PATH_LENGTH
+ */
+int absolute_path(const char *path, char *absolute) {
+    int written;
+    if (path[0] == '/') {
+        written = snprintf(absolute, MAX_PATH_LENGTH, "%s", path);
+    } else if (strcmp(current_path, "/") == 0) {
+        written = snprintf(absolute, MAX_PATH_LENGTH, "/%s", path);
+    } else {
+        written = snprintf(absolute, MAX_PATH_LENGTH, "%s/%s", current_path, path);
+    }
+    if (written < 0 || written >= MAX_PATH_LENGTH) return VFS_ERR_INVALID;
+    size_t len = strlen(absolute);
+    while (len > 1 && absolute[len - 1] == '/') {
+        absolute[--len] = '\0';
+    }
+    return 0;
+}
+
+// Répertoires déjà résolus pendant une opération groupée / 批量操作期间已解析的目录
+#define DIRECTORY_CACHE_SLOTS 512  // Puissance de 2 / 2 的幂
+
+struct DirectoryCache {
+    int count;
+    struct {
+        int inode;                    // -1 si l'emplacement est libre / 空槽为 -1
+        char path[MAX_PATH_LENGTH];   // Chemin absolu du répertoire / 目录的绝对路径
+    } slots[DIRECTORY_CACHE_SLOTS];
+};
+
+/**
+ * @brief Créer un cache de répertoires vide, valable tant que l'arborescence n'est modifiée que par son utilisateur
+ * @return Le cache, ou NULL si la mémoire manque
+ */
+DirectoryCache *directory_cache_new() {
+    DirectoryCache *cache = malloc(sizeof(DirectoryCache));
+    if (cache == NULL) return NULL;
+    cache->count = 0;
+    for (int i = 0; i < DIRECTORY_CACHE_SLOTS; i++) {
+        cache->slots[i].inode = -1;
+    }
+    return cache;
+}
+
+/**
+ * @brief Libérer un cache de répertoires
+ * @param cache Le cache
+ * @return Aucun
+ */
+void directory_cache_free(DirectoryCache *cache) {
+    free(cache);
+}
+
+/**
+ * @brief Trouver l'emplacement d'un chemin dans le cache (hachage FNV-1a, sondage linéaire)
+ * @param cache Le cache
+ * @param path Le chemin absolu
+ * @return L'emplacement du chemin, ou l'emplacement libre où l'insérer
+ */
+static int directory_cache_slot(const DirectoryCache *cache, const char *path) {
+    unsigned int hash = 2166136261u;
+    for (const char *p = path; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    int slot = hash & (DIRECTORY_CACHE_SLOTS - 1);
+    while (cache->slots[slot].inode != -1 && strcmp(cache->slots[slot].path, path) != 0) {
+        slot = (slot + 1) & (DIRECTORY_CACHE_SLOTS - 1);
+    }
+    return slot;
+}
+
+/**
+ * @brief Résoudre un répertoire en réutilisant les préfixes déjà résolus
+ * @details Seul le dernier composant absent du cache est recherché dans son parent ; avec created,
+ *          les répertoires manquants sont créés (mkdir -p)
+ * @param cache Le cache
+ * @param path Le chemin absolu du répertoire, sans barre oblique finale
+ * @param created NULL pour ne rien créer, sinon compteur des répertoires créés
+ * @return Le numéro d'inode du répertoire, ou VFS_ERR_NOT_FOUND, VFS_ERR_NOT_DIR, VFS_ERR_PERMISSION, VFS_ERR_NO_SPACE
+ */
+int resolve_directory_cached(DirectoryCache *cache, const char *path, int *created) {
+    if (path[0] == '\0' || strcmp(path, "/") == 0) return fs.directory[0].inode_number;
+
+    int slot = directory_cache_slot(cache, path);
+    if (cache->slots[slot].inode != -1) return cache->slots[slot].inode;
+
+    // Résoudre d'abord le parent / 先解析父目录
+    const char *last_slash = strrchr(path, '/');
+    if (last_slash == NULL) return VFS_ERR_NOT_FOUND;
+    char parent_path[MAX_PATH_LENGTH];
+    size_t parent_len = last_slash - path;
+    memcpy(parent_path, path, parent_len);
+    parent_path[parent_len] = '\0';
+    int parent_inode = resolve_directory_cached(cache, parent_path, created);
+    if (parent_inode < 0) return parent_inode;
+
+    const char *name = last_slash + 1;
+    int inode_number;
+    if (name[0] == '\0' || strcmp(name, ".") == 0) {
+        inode_number = parent_inode;
+    } else {
+        inode_number = find_in_directory(parent_inode, name);
+        if (inode_number == -1 && created) {
+            inode_number = add_directory_at(parent_inode, name);
+            if (inode_number < 0) return inode_number;
+            (*created)++;
+        }
+    }
+    if (inode_number == -1) return VFS_ERR_NOT_FOUND;
+    if (fs.inodes[inode_number].file_type != FILE_TYPE_DIR) return VFS_ERR_NOT_DIR;
+
+    // Garder une place libre pour que le sondage s'arrête / 保留空槽，保证探测能终止
+    if (cache->count < DIRECTORY_CACHE_SLOTS / 2) {
+        slot = directory_cache_slot(cache, path);
+        cache->slots[slot].inode = inode_number;
+        strcpy(cache->slots[slot].path, path);
+        cache->count++;
+    }
+    return inode_number;
+}
+
 /**
  * @brief Créer une entrée de répertoire
  * @param name Le nom de l'entrée
@@ -309,11 +1169,13 @@ void create_directory_entry(const char *name, int parent_inode) {
  * @return Aucun
  */
 void add_directory_entry(int parent_inode, const char *name, int target_inode) {
+    lock_directory_slots();
     for (int i = 0; i < MAX_FILES; i++) {
         if (fs.directory[i].inode_number == -1) { // Entrée libre / 空闲条目
             strncpy(fs.directory[i].name, name, MAX_FILENAME_LENGTH);
             fs.directory[i].parent_inode = parent_inode;
             fs.directory[i].inode_number = target_inode;
+            unlock_directory_slots();
 
             // 更新父目录大小及修改时间
             if (parent_inode >= 0 && parent_inode < MAX_FILES) {
@@ -324,8 +1186,9 @@ void add_directory_entry(int parent_inode, const char *name, int target_inode) {
             return;
         }
     }
+    unlock_directory_slots();
     
-    printf("Directory is full\n");
+    command_error("Directory is full\n");
 }
 
 // Supprimer l'entrée de répertoire / 删除目录项
@@ -347,9 +1210,11 @@ void remove_directory_entry(const char *name, int parent_inode) {
             }
 
             // Vider l'entrée de répertoire / 清空目录项
+            lock_directory_slots();
             fs.directory[i].inode_number = -1;
             fs.directory[i].parent_inode = -1;
             fs.directory[i].name[0] = '\0';
+            unlock_directory_slots();
             return;
         }
     }
@@ -364,7 +1229,7 @@ void remove_directory_entry(const char *name, int parent_inode) {
 int get_file_size(int inode_number) {
     // 检查inode编号有效性
     if (inode_number < 0 || inode_number >= MAX_FILES) {
-        printf("Invalid inode number\n");
+        command_error("Invalid inode number\n");
         return -1;
     }
     
@@ -372,7 +1237,7 @@ int get_file_size(int inode_number) {
     
     // 验证inode是否有效（通过inode编号匹配）
     if (target->inode_number != inode_number) {
-        printf("File does not exist\n");
+        command_error("File does not exist\n");
         return -1;
     }
     
@@ -382,24 +1247,18 @@ int get_file_size(int inode_number) {
 
 // 计算目录大小包括元数据
 /**
- * @brief Obtenir la taille d'un répertoire (y compris les métadonnées)
+ * @brief Obtenir la taille d'un répertoire (y compris les métadonnées), sans affichage
  * @param inode_number Le numéro d'inode du répertoire
- * @return La taille du répertoire en octets, ou -1 en cas d'erreur
+ * @return La taille du répertoire en octets, ou VFS_ERR_INVALID, VFS_ERR_NOT_DIR
  */
 int get_dir_size(int inode_number) {
     // 检查inode有效性
-    if (inode_number < 0 || inode_number >= MAX_FILES) {
-        printf("Invalid inode number\n");
-        return -1;
-    }
+    if (inode_number < 0 || inode_number >= MAX_FILES) return VFS_ERR_INVALID;
     
     Inode *dir_inode = &fs.inodes[inode_number];
     
     // 验证是否为目录
-    if (dir_inode->file_type != FILE_TYPE_DIR) {
-        printf("Not a directory\n");
-        return -1;
-    }
+    if (dir_inode->file_type != FILE_TYPE_DIR) return VFS_ERR_NOT_DIR;
     
     int total_size = 0;
     
@@ -416,7 +1275,7 @@ int get_dir_size(int inode_number) {
                 strcmp(entry->name, ".") != 0 && 
                 strcmp(entry->name, "..") != 0) {
                 int subdir_size = get_dir_size(entry->inode_number);
-                if (subdir_size == -1) return -1;
+                if (subdir_size < 0) return subdir_size;
                 total_size += subdir_size;
             }
             
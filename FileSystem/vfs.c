@@ -0,0 +1,404 @@
+/**
+* @file vfs.c
+* @brief API C du système de fichiers virtuel (libvfs) : codes de retour et résultats structurés
+* @details Le volume monté reste en mémoire dans une session ; chaque appel prend les verrous de
+*          lock.c, et les lectures de métadonnées (vfs_stat, vfs_readdir) se font sans verrou
+* @author jzy
+* @date 2025-4-22
+*/
+#include "filesystem.h"
+#include <pthread.h>
+#include <sys/stat.h>
+
+extern SuperBlock fs;
+
+#define MAX_FILE_SIZE ((size_t)MAX_FILE_PAGES * PAGE_SIZE)
+
+// Fichier ouvert / 打开的文件
+typedef struct {
+    int in_use;
+    int inode;
+    time_t ctime;     // Date de création de l'inode, pour reconnaître un inode réutilisé / inode 创建时间，用于识别被重用的 inode
+    int mode;         // VFS_READ, VFS_WRITE, VFS_APPEND
+    size_t offset;    // Position courante / 当前位置
+} VfsHandle;
+
+static VfsHandle handles[VFS_MAX_OPEN];
+static pthread_mutex_t handle_lock = PTHREAD_MUTEX_INITIALIZER;
+static int mounted = 0;
+
+/**
+ * @brief Monter le volume : charger le superbloc une fois et activer les verrous
+ * @return VFS_OK, ou VFS_ERR_NOT_MOUNTED si le disque n'est pas formaté, VFS_ERR_IO s'il ne peut pas être lu
+ */
+int vfs_mount(void) {
+    struct stat st;
+    if (stat(DISK_FILE, &st) != 0 || (size_t)st.st_size < sizeof(SuperBlock)) return VFS_ERR_NOT_MOUNTED;
+
+    int status = VFS_OK;
+    lock_volume(1);
+    if (!mounted) {
+        begin_session();
+        acquire_disk_writer();
+        if (read_superblock() != 0) {
+            end_session();
+            status = VFS_ERR_IO;
+        } else {
+            locking_enabled = 1;
+            mounted = 1;
+        }
+    }
+    unlock_volume();
+    return status;
+}
+
+/**
+ * @brief Démonter le volume : écrire les modifications et fermer tous les descripteurs
+ * @return VFS_OK, ou VFS_ERR_NOT_MOUNTED, VFS_ERR_CORRUPT (métadonnées corrompues : rien n'est écrit),
+ *         VFS_ERR_IO (écriture impossible : le volume est démonté quand même)
+ */
+int vfs_unmount(void) {
+    lock_volume(1);
+    if (!mounted) {
+        unlock_volume();
+        return VFS_ERR_NOT_MOUNTED;
+    }
+    int status = metadata_damaged() ? VFS_ERR_CORRUPT : VFS_OK;
+    if (end_session() != 0 && status == VFS_OK) status = VFS_ERR_IO;
+    locking_enabled = 0;
+    mounted = 0;
+    pthread_mutex_lock(&handle_lock);
+    memset(handles, 0, sizeof(handles));
+    pthread_mutex_unlock(&handle_lock);
+    unlock_volume();
+    return status;
+}
+
+/**
+ * @brief Écrire sur le disque les modifications en attente
+ * @return VFS_OK, ou VFS_ERR_NOT_MOUNTED, VFS_ERR_CORRUPT (métadonnées corrompues : rien n'est écrit),
+ *         VFS_ERR_IO (écriture impossible : les modifications restent en attente)
+ */
+int vfs_sync(void) {
+    if (!mounted) return VFS_ERR_NOT_MOUNTED;
+    lock_volume(1);
+    int status = metadata_damaged() ? VFS_ERR_CORRUPT : VFS_OK;
+    if (commit_session() != 0 && status == VFS_OK) status = VFS_ERR_IO;
+    unlock_volume();
+    return status;
+}
+
+/**
+ * @brief Obtenir les informations d'un fichier ou répertoire (les liens sont suivis)
+ * @param path Le chemin
+ * @param st Reçoit les informations
+ * @return VFS_OK, ou VFS_ERR_NOT_FOUND, VFS_ERR_INVALID, VFS_ERR_NOT_MOUNTED
+ */
+int vfs_stat(const char *path, VfsStat *st) {
+    if (!mounted) return VFS_ERR_NOT_MOUNTED;
+
+    int status;
+    unsigned int token;
+    do {
+        token = namespace_read_begin();
+        status = lookup_path(path);
+        if (status < 0) continue;
+
+        int inode_number = status;
+        unsigned int inode_token;
+        do {
+            inode_token = inode_read_begin(inode_number);
+            const Inode *inode = &fs.inodes[inode_number];
+            st->inode = inode_number;
+            st->type = inode->file_type;
+            st->permissions = inode->permissions;
+            st->links = inode->link_count;
+            st->size = inode->size;
+            st->ctime = inode->ctime;
+            st->mtime = inode->mtime;
+            st->atime = inode->atime;
+        } while (inode_read_retry(inode_number, inode_token));
+    } while (namespace_read_retry(token));
+    return status < 0 ? status : VFS_OK;
+}
+
+/**
+ * @brief Lire les entrées d'un répertoire, sans '.' ni '..'
+ * @param path Le chemin du répertoire
+ * @param entries Reçoit les entrées, dans l'ordre de la table des répertoires
+ * @param max_entries La taille du tableau
+ * @return Le nombre d'entrées lues (au plus max_entries), ou VFS_ERR_NOT_FOUND, VFS_ERR_NOT_DIR,
+ *         VFS_ERR_PERMISSION, VFS_ERR_INVALID, VFS_ERR_NOT_MOUNTED
+ */
+int vfs_readdir(const char *path, VfsDirent *entries, int max_entries) {
+    if (!mounted) return VFS_ERR_NOT_MOUNTED;
+    if (max_entries < 0) return VFS_ERR_INVALID;
+
+    int count;
+    unsigned int token;
+    do {
+        token = namespace_read_begin();
+        int dir_inode = lookup_path(path);
+        if (dir_inode < 0) {
+            count = dir_inode;
+        } else if (fs.inodes[dir_inode].file_type != FILE_TYPE_DIR) {
+            count = VFS_ERR_NOT_DIR;
+        } else if (!check_directory_permission(dir_inode, PERM_READ)) {
+            count = VFS_ERR_PERMISSION;
+        } else {
+            count = 0;
+            for (int i = 0; i < MAX_FILES && count < max_entries; i++) {
+                const DirectoryEntry *dirent = &fs.directory[i];
+                int target = dirent->inode_number;
+                if (dirent->parent_inode != dir_inode || target < 0 || target >= MAX_FILES ||
+                    dirent->name[0] == '\0' || strcmp(dirent->name, ".") == 0 || strcmp(dirent->name, "..") == 0) {
+                    continue;
+                }
+                VfsDirent *entry = &entries[count++];
+                strncpy(entry->name, dirent->name, VFS_NAME_MAX - 1);
+                entry->name[VFS_NAME_MAX - 1] = '\0';
+                entry->inode = target;
+                entry->type = fs.inodes[target].file_type;
+            }
+        }
+    } while (namespace_read_retry(token));
+    return count;
+}
+
+/**
+ * @brief Créer un répertoire
+ * @param path Le chemin du nouveau répertoire
+ * @return VFS_OK, ou VFS_ERR_NOT_FOUND, VFS_ERR_PERMISSION, VFS_ERR_EXISTS, VFS_ERR_NO_SPACE, VFS_ERR_NOT_MOUNTED
+ */
+int vfs_mkdir(const char *path) {
+    if (!mounted) return VFS_ERR_NOT_MOUNTED;
+
+    lock_volume(1);
+    namespace_write_begin();
+    int status = add_directory(path);
+    if (status >= 0) save_superblock();
+    namespace_write_end();
+    unlock_volume();
+    return status < 0 ? status : VFS_OK;
+}
+
+/**
+ * @brief Ouvrir un fichier régulier
+ * @details VFS_CREATE et VFS_TRUNCATE modifient le volume et prennent son verrou exclusif
+ * @param path Le chemin du fichier
+ * @param mode VFS_READ et/ou VFS_WRITE, éventuellement VFS_CREATE, VFS_TRUNCATE, VFS_APPEND
+ * @return Un descripteur (>= 0), ou VFS_ERR_NOT_FOUND, VFS_ERR_IS_DIR, VFS_ERR_PERMISSION,
+ *         VFS_ERR_NO_SPACE, VFS_ERR_TOO_MANY, VFS_ERR_INVALID, VFS_ERR_NOT_MOUNTED
+ */
+int vfs_open(const char *path, int mode) {
+    if (!mounted) return VFS_ERR_NOT_MOUNTED;
+    if (!(mode & (VFS_READ | VFS_WRITE)) || ((mode & VFS_TRUNCATE) && !(mode & VFS_WRITE))) {
+        return VFS_ERR_INVALID;
+    }
+
+    int exclusive = (mode & (VFS_CREATE | VFS_TRUNCATE)) != 0;
+    LockSet locks;
+    lock_set_init(&locks);
+    lock_volume(exclusive);
+    if (exclusive) namespace_write_begin();
+
+    int status = lookup_path(path);
+    if (status == VFS_ERR_NOT_FOUND && (mode & VFS_CREATE)) {
+        status = add_regular_file(path);
+    }
+    if (!exclusive && status >= 0) {
+        lock_set_add(&locks, status, 0);
+        lock_set_acquire(&locks);
+    }
+
+    if (status >= 0) {
+        int inode_number = status;
+        Inode *inode = &fs.inodes[inode_number];
+        if (inode->file_type != FILE_TYPE_REGULAR) {
+            status = VFS_ERR_IS_DIR;
+        } else if (((mode & VFS_READ) && !check_file_permission(inode_number, PERM_READ)) ||
+                   ((mode & VFS_WRITE) && !check_file_permission(inode_number, PERM_WRITE))) {
+            status = VFS_ERR_PERMISSION;
+        } else if ((mode & VFS_TRUNCATE) && inode->size > 0 && set_file_contents(inode, "", 0) != 0) {
+            status = VFS_ERR_NO_SPACE;
+        }
+
+        // Réserver un descripteur / 分配描述符
+        if (status >= 0) {
+            pthread_mutex_lock(&handle_lock);
+            status = VFS_ERR_TOO_MANY;
+            for (int fd = 0; fd < VFS_MAX_OPEN; fd++) {
+                if (!handles[fd].in_use) {
+                    handles[fd].in_use = 1;
+                    handles[fd].inode = inode_number;
+                    handles[fd].ctime = inode->ctime;
+                    handles[fd].mode = mode & (VFS_READ | VFS_WRITE | VFS_APPEND);
+                    handles[fd].offset = 0;
+                    status = fd;
+                    break;
+                }
+            }
+            pthread_mutex_unlock(&handle_lock);
+        }
+    }
+
+    if (exclusive) {
+        save_superblock();
+        namespace_write_end();
+    } else {
+        lock_set_release(&locks);
+    }
+    unlock_volume();
+    return status;
+}
+
+/**
+ * @brief Fermer un descripteur
+ * @param fd Le descripteur
+ * @return VFS_OK, ou VFS_ERR_BAD_HANDLE
+ */
+int vfs_close(int fd) {
+    if (fd < 0 || fd >= VFS_MAX_OPEN) return VFS_ERR_BAD_HANDLE;
+    pthread_mutex_lock(&handle_lock);
+    int status = handles[fd].in_use ? VFS_OK : VFS_ERR_BAD_HANDLE;
+    handles[fd].in_use = 0;
+    pthread_mutex_unlock(&handle_lock);
+    return status;
+}
+
+/**
+ * @brief Verrouiller l'inode d'un descripteur
+ * @details Le verrou partagé du volume empêche la suppression du fichier pendant l'accès
+ * @param fd Le descripteur
+ * @param mode Le mode requis (VFS_READ ou VFS_WRITE)
+ * @param locks Reçoit le verrou pris
+ * @return Le descripteur verrouillé, ou NULL s'il est invalide (aucun verrou n'est alors pris)
+ */
+static VfsHandle *lock_handle(int fd, int mode, LockSet *locks) {
+    if (!mounted || fd < 0 || fd >= VFS_MAX_OPEN || !handles[fd].in_use || !(handles[fd].mode & mode)) {
+        return NULL;
+    }
+    VfsHandle *handle = &handles[fd];
+    lock_volume(0);
+    lock_set_init(locks);
+    lock_set_add(locks, handle->inode, mode == VFS_WRITE);
+    lock_set_acquire(locks);
+
+    // Le fichier a pu être supprimé depuis l'ouverture / 文件可能在打开后已被删除
+    const Inode *inode = &fs.inodes[handle->inode];
+    if (inode->file_type != FILE_TYPE_REGULAR || inode->ctime != handle->ctime) {
+        lock_set_release(locks);
+        unlock_volume();
+        return NULL;
+    }
+    return handle;
+}
+
+/**
+ * @brief Relâcher les verrous pris par lock_handle
+ * @param locks Les verrous
+ * @return Aucun
+ */
+static void unlock_handle(LockSet *locks) {
+    lock_set_release(locks);
+    unlock_volume();
+}
+
+/**
+ * @brief Lire un fichier ouvert à partir de la position courante
+ * @param fd Le descripteur (ouvert avec VFS_READ)
+ * @param buffer Reçoit les données
+ * @param len Le nombre d'octets demandés
+ * @return Le nombre d'octets lus (0 à la fin du fichier), ou VFS_ERR_BAD_HANDLE, VFS_ERR_CORRUPT
+ */
+long vfs_read(int fd, void *buffer, size_t len) {
+    LockSet locks;
+    VfsHandle *handle = lock_handle(fd, VFS_READ, &locks);
+    if (handle == NULL) return VFS_ERR_BAD_HANDLE;
+
+    Inode *inode = &fs.inodes[handle->inode];
+    size_t start = handle->offset < inode->size ? handle->offset : inode->size;
+    size_t count = inode->size - start < len ? inode->size - start : len;
+    long result = VFS_ERR_CORRUPT;
+    if (read_file_data(inode, start, start + count, buffer) == 0) {
+        handle->offset = start + count;
+        touch_access_time(inode);
+        result = (long)count;
+    }
+
+    unlock_handle(&locks);
+    return result;
+}
+
+/**
+ * @brief Écrire dans un fichier ouvert à la position courante (ou à la fin avec VFS_APPEND)
+ * @details Seules les pages couvertes par l'écriture sont modifiées, un saut au-delà de la fin
+ *          laisse un trou
+ * @param fd Le descripteur (ouvert avec VFS_WRITE)
+ * @param buffer Les données
+ * @param len Le nombre d'octets
+ * @return Le nombre d'octets écrits, ou VFS_ERR_BAD_HANDLE, VFS_ERR_TOO_LARGE, VFS_ERR_NO_SPACE, VFS_ERR_CORRUPT
+ */
+long vfs_write(int fd, const void *buffer, size_t len) {
+    LockSet locks;
+    VfsHandle *handle = lock_handle(fd, VFS_WRITE, &locks);
+    if (handle == NULL) return VFS_ERR_BAD_HANDLE;
+
+    Inode *inode = &fs.inodes[handle->inode];
+    size_t start = (handle->mode & VFS_APPEND) ? inode->size : handle->offset;
+    long result;
+    if (start > MAX_FILE_SIZE || len > MAX_FILE_SIZE - start) {
+        result = VFS_ERR_TOO_LARGE;
+    } else {
+        int status = write_file_data(inode, start, buffer, len);
+        if (status == -1) {
+            result = VFS_ERR_NO_SPACE;
+        } else if (status == -2) {
+            // Ne pas donner un nouveau checksum à des données corrompues / 不要给损坏的数据新的校验和
+            result = VFS_ERR_CORRUPT;
+        } else {
+            handle->offset = start + len;
+            save_superblock();
+            result = (long)len;
+        }
+    }
+    unlock_handle(&locks);
+    return result;
+}
+
+/**
+ * @brief Changer la position courante d'un descripteur
+ * @param fd Le descripteur
+ * @param offset La nouvelle position depuis le début du fichier
+ * @return La nouvelle position, ou VFS_ERR_BAD_HANDLE, VFS_ERR_INVALID
+ */
+long vfs_seek(int fd, long offset) {
+    if (fd < 0 || fd >= VFS_MAX_OPEN || !handles[fd].in_use) return VFS_ERR_BAD_HANDLE;
+    if (offset < 0) return VFS_ERR_INVALID;
+    handles[fd].offset = (size_t)offset;
+    return offset;
+}
+
+/**
+ * @brief Obtenir le message correspondant à un code de retour
+ * @param status Le code de retour
+ * @return Le message
+ */
+const char *vfs_strerror(int status) {
+    switch (status) {
+        case VFS_ERR_NOT_FOUND: return "File or directory not found";
+        case VFS_ERR_EXISTS: return "File already exists";
+        case VFS_ERR_NOT_DIR: return "Not a directory";
+        case VFS_ERR_IS_DIR: return "Not a regular file";
+        case VFS_ERR_PERMISSION: return "Permission denied";
+        case VFS_ERR_NO_SPACE: return "No free space";
+        case VFS_ERR_TOO_LARGE: return "File size exceeds maximum limit";
+        case VFS_ERR_INVALID: return "Invalid argument";
+        case VFS_ERR_NOT_MOUNTED: return "File system is not initialized";
+        case VFS_ERR_BAD_HANDLE: return "Bad file descriptor";
+        case VFS_ERR_TOO_MANY: return "Too many open files";
+        case VFS_ERR_CORRUPT: return "Checksum mismatch, run 'fsck repair'";
+        case VFS_ERR_IO: return "Virtual disk I/O error";
+        default: return status >= 0 ? "Success" : "Unknown error";
+    }
+}
@@ -0,0 +1,80 @@
+/**
+* @file vfs.h
+* @brief API C du système de fichiers virtuel (libvfs), sans sortie texte
+* @details Toutes les fonctions renvoient VFS_OK (ou une valeur positive) en cas de succès et un
+*          code VFS_ERR_* négatif sinon. Le volume est monté une fois par processus ; les appels
+*          peuvent ensuite être faits depuis plusieurs threads.
+* @author jzy
+* @date 2025-4-22
+*/
+#ifndef VFS_H
+#define VFS_H
+
+#include <stddef.h>
+#include <time.h>
+
+// Codes de retour / 返回码
+#define VFS_OK 0
+#define VFS_ERR_NOT_FOUND -1      // Fichier ou répertoire parent introuvable / 文件或父目录不存在
+#define VFS_ERR_EXISTS -2         // Le nom existe déjà / 名称已存在
+#define VFS_ERR_NOT_DIR -3        // Un répertoire était attendu / 需要目录
+#define VFS_ERR_IS_DIR -4         // Un fichier régulier était attendu / 需要普通文件
+#define VFS_ERR_PERMISSION -5     // Permission refusée / 权限不足
+#define VFS_ERR_NO_SPACE -6       // Plus d'inode, de page ou d'entrée libre / 没有空闲 inode、页面或目录项
+#define VFS_ERR_TOO_LARGE -7      // Taille maximale d'un fichier dépassée / 超过文件最大大小
+#define VFS_ERR_INVALID -8        // Argument invalide / 参数无效
+#define VFS_ERR_NOT_MOUNTED -9    // Volume non monté ou non formaté / 卷未挂载或未格式化
+#define VFS_ERR_BAD_HANDLE -10    // Descripteur invalide ou fichier supprimé / 描述符无效或文件已删除
+#define VFS_ERR_TOO_MANY -11      // Trop de fichiers ouverts / 打开的文件过多
+#define VFS_ERR_CORRUPT -12       // Données ou métadonnées qui ne correspondent pas à leur checksum / 数据或元数据与校验和不符
+#define VFS_ERR_IO -13            // Le fichier disque ne peut pas être lu ou écrit / 磁盘文件无法读取或写入
+
+// Modes d'ouverture / 打开模式
+#define VFS_READ 1
+#define VFS_WRITE 2
+#define VFS_CREATE 4              // Créer le fichier s'il n'existe pas / 文件不存在时创建
+#define VFS_TRUNCATE 8            // Vider le fichier à l'ouverture / 打开时清空文件
+#define VFS_APPEND 16             // Chaque écriture se fait à la fin / 每次写入都在末尾
+
+// Types et permissions, identiques à ceux du volume / 类型和权限，与卷内一致
+#define VFS_TYPE_FILE 1
+#define VFS_TYPE_DIR 2
+#define VFS_TYPE_SYMLINK 3
+#define VFS_PERM_READ 4
+#define VFS_PERM_WRITE 2
+#define VFS_PERM_EXECUTE 1
+
+#define VFS_NAME_MAX 256          // Taille d'un nom, '\0' compris / 名称长度（含 '\0'）
+#define VFS_MAX_OPEN 64           // Fichiers ouverts simultanément / 同时打开的文件数
+
+// Informations sur un fichier / 文件信息
+typedef struct {
+    int inode;
+    int type;                     // VFS_TYPE_*
+    int permissions;              // VFS_PERM_*
+    int links;                    // Liens durs supplémentaires / 额外的硬链接数
+    size_t size;
+    time_t ctime, mtime, atime;
+} VfsStat;
+
+// Entrée de répertoire / 目录项
+typedef struct {
+    char name[VFS_NAME_MAX];
+    int inode;
+    int type;                     // VFS_TYPE_*
+} VfsDirent;
+
+int vfs_mount(void); // Charger le volume et activer les verrous / 加载卷并启用锁
+int vfs_unmount(void); // Écrire les modifications et démonter / 写回修改并卸载
+int vfs_sync(void); // Écrire les modifications en attente / 写回待提交的修改
+int vfs_stat(const char *path, VfsStat *st); // Informations sur un chemin (liens suivis) / 路径信息（跟随链接）
+int vfs_readdir(const char *path, VfsDirent *entries, int max_entries); // Lire un répertoire, renvoie le nombre d'entrées / 读取目录，返回条目数
+int vfs_mkdir(const char *path); // Créer un répertoire / 创建目录
+int vfs_open(const char *path, int mode); // Ouvrir un fichier, renvoie un descripteur / 打开文件，返回描述符
+int vfs_close(int fd); // Fermer un descripteur / 关闭描述符
+long vfs_read(int fd, void *buffer, size_t len); // Lire à la position courante / 从当前位置读取
+long vfs_write(int fd, const void *buffer, size_t len); // Écrire à la position courante / 在当前位置写入
+long vfs_seek(int fd, long offset); // Changer la position courante / 修改当前位置
+const char *vfs_strerror(int status); // Message d'un code de retour / 返回码对应的消息
+
+#endif // VFS_H